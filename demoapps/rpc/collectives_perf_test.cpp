@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+/*
+ * Compares the flat tree, recursive doubling and ring collectives
+ * of dc_dist_object, and all_reduce_dense() against all_reduce() on the
+ * same dense vectors. Meant to be run with many ranks on one host, e.g.
+ *   mpiexec -n 64 ./collectives_perf_test
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <graphlab/util/timer.hpp>
+#include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/rpc/dc_dist_object.hpp>
+#include <graphlab/rpc/dc_init_from_mpi.hpp>
+using namespace graphlab;
+
+/// A dense payload of doubles which sums elementwise
+struct dense_payload {
+  std::vector<double> values;
+  dense_payload& operator+=(const dense_payload& other) {
+    if (values.size() < other.values.size()) values.resize(other.values.size());
+    for (size_t i = 0;i < other.values.size(); ++i) values[i] += other.values[i];
+    return *this;
+  }
+  void save(oarchive& oarc) const {
+    oarc << values;
+  }
+  void load(iarchive& iarc) {
+    iarc >> values;
+  }
+};
+
+struct collectives_test {
+  dc_dist_object<collectives_test> rmi;
+  collectives_test(distributed_control &dc):rmi(dc, this) {
+    rmi.barrier();
+  }
+
+  double time_barrier(size_t iterations) {
+    rmi.barrier();
+    timer ti;
+    ti.start();
+    for (size_t i = 0;i < iterations; ++i) rmi.barrier();
+    return ti.current_time() / iterations;
+  }
+
+  double time_all_reduce(size_t length, size_t iterations) {
+    rmi.barrier();
+    timer ti;
+    ti.start();
+    for (size_t i = 0;i < iterations; ++i) {
+      dense_payload p;
+      p.values.resize(length, rmi.procid());
+      rmi.all_reduce(p);
+      if (i == 0) {
+        double expected = (rmi.numprocs() - 1) * rmi.numprocs() / 2.0;
+        ASSERT_EQ(p.values[0], expected);
+      }
+    }
+    return ti.current_time() / iterations;
+  }
+
+  double time_all_reduce_dense(size_t length, size_t iterations) {
+    rmi.barrier();
+    timer ti;
+    ti.start();
+    for (size_t i = 0;i < iterations; ++i) {
+      std::vector<double> values(length, rmi.procid());
+      rmi.all_reduce_dense(values);
+      if (i == 0) {
+        double expected = (rmi.numprocs() - 1) * rmi.numprocs() / 2.0;
+        ASSERT_EQ(values[0], expected);
+        ASSERT_EQ(values[length - 1], expected);
+      }
+    }
+    return ti.current_time() / iterations;
+  }
+
+  double time_all_gather(size_t length, size_t iterations) {
+    rmi.barrier();
+    timer ti;
+    ti.start();
+    for (size_t i = 0;i < iterations; ++i) {
+      std::vector<std::vector<double> > data(rmi.numprocs());
+      data[rmi.procid()].resize(length, rmi.procid());
+      rmi.all_gather(data);
+      if (i == 0) {
+        for (size_t j = 0;j < data.size(); ++j) {
+          ASSERT_EQ(data[j].size(), length);
+          ASSERT_EQ(data[j][0], (double)j);
+        }
+      }
+    }
+    return ti.current_time() / iterations;
+  }
+
+  double time_broadcast(size_t length, size_t iterations) {
+    rmi.barrier();
+    timer ti;
+    ti.start();
+    for (size_t i = 0;i < iterations; ++i) {
+      std::vector<double> data;
+      if (rmi.procid() == 0) data.resize(length, 1.0);
+      rmi.broadcast(data, rmi.procid() == 0);
+      if (i == 0) ASSERT_EQ(data.size(), length);
+    }
+    return ti.current_time() / iterations;
+  }
+
+  void run(dc_collective_type alg, const char* name) {
+    rmi.barrier();
+    rmi.set_collective_algorithm(alg);
+    const size_t lengths[] = {1, 128, 8192, 131072, 1048576};
+    const size_t numlengths = sizeof(lengths) / sizeof(size_t);
+    double barrier_time = time_barrier(100);
+    if (rmi.procid() == 0) {
+      std::cout << name << " barrier: " << barrier_time * 1e6 << " us\n";
+      std::cout << std::setw(12) << "doubles"
+                << std::setw(16) << "all_reduce(us)"
+                << std::setw(16) << "dense(us)"
+                << std::setw(16) << "all_gather(us)"
+                << std::setw(16) << "broadcast(us)" << "\n";
+    }
+    for (size_t i = 0;i < numlengths; ++i) {
+      // keep the total volume roughly constant across sizes
+      size_t iterations = std::max<size_t>(3, 1000 / (1 + lengths[i] / 1024));
+      double reduce_time = time_all_reduce(lengths[i], iterations);
+      double dense_time = time_all_reduce_dense(lengths[i], iterations);
+      // the all gather result grows with numprocs. Skip the largest size
+      double gather_time = lengths[i] * rmi.numprocs() <= (1 << 24) ?
+                            time_all_gather(lengths[i], iterations) : 0;
+      double bcast_time = time_broadcast(lengths[i], iterations);
+      if (rmi.procid() == 0) {
+        std::cout << std::setw(12) << lengths[i]
+                  << std::setw(16) << reduce_time * 1e6
+                  << std::setw(16) << dense_time * 1e6
+                  << std::setw(16) << gather_time * 1e6
+                  << std::setw(16) << bcast_time * 1e6 << "\n";
+      }
+    }
+    rmi.set_collective_algorithm(COLLECTIVE_AUTO);
+    rmi.barrier();
+  }
+};
+
+int main(int argc, char** argv) {
+  mpi_tools::init(argc, argv);
+  distributed_control dc;
+  collectives_test ct(dc);
+  if (dc.procid() == 0) {
+    std::cout << "Collectives over " << dc.numprocs() << " processes\n\n";
+  }
+  ct.run(COLLECTIVE_FLAT_TREE, "flat tree");
+  ct.run(COLLECTIVE_RECURSIVE_DOUBLING, "recursive doubling");
+  ct.run(COLLECTIVE_RING, "ring");
+  ct.run(COLLECTIVE_AUTO, "auto");
+  dc.barrier();
+  mpi_tools::finalize();
+}
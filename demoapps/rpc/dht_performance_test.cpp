@@ -22,6 +22,8 @@
 
 
 #include <iostream>
+#include <iomanip>
+#include <boost/bind.hpp>
 #include <graphlab/util/timer.hpp>
 #include <graphlab/util/mpi_tools.hpp>
 #include <graphlab/util/generics/any.hpp>
@@ -29,6 +31,7 @@
 #include <graphlab/rpc/dc_init_from_mpi.hpp>    
 #include <graphlab/rpc/dht.hpp>
 #include <graphlab/logger/logger.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
 using namespace graphlab;
 
 std::string randstring(size_t len) {
@@ -42,6 +45,73 @@ std::string randstring(size_t len) {
   return str;
 }
 
+/**
+ * Reads keys [begin, end) from the dht in batches of batchsize.
+ * A batch size of 1 uses the single key get().
+ */
+void batched_reader(const dht<size_t, size_t>* intdht,
+                    size_t begin, size_t end, size_t batchsize) {
+  std::vector<size_t> keys;
+  for (size_t i = begin; i < end; i += batchsize) {
+    size_t last = std::min(i + batchsize, end);
+    if (batchsize == 1) {
+      std::pair<bool, size_t> ret = intdht->get(i);
+      ASSERT_TRUE(ret.first && ret.second == i);
+      continue;
+    }
+    keys.clear();
+    for (size_t j = i;j < last; ++j) keys.push_back(j);
+    std::vector<std::pair<bool, size_t> > ret = intdht->multi_get(keys);
+    for (size_t j = 0;j < ret.size(); ++j) {
+      ASSERT_TRUE(ret[j].first && ret[j].second == keys[j]);
+    }
+  }
+}
+
+/**
+ * Measures the get throughput of machine 0 over integer keys at varying
+ * batch sizes and numbers of threads.
+ */
+void batched_benchmark(distributed_control& dc) {
+  dht<size_t, size_t> intdht(dc);
+  const size_t NUMKEYS = 100000;
+  // every machine fills in its share of the keys with multi_set
+  std::vector<size_t> keys;
+  for (size_t i = dc.procid();i < NUMKEYS; i += dc.numprocs()) keys.push_back(i);
+  intdht.multi_set(keys, keys);
+  dc.full_barrier();
+
+  const size_t batchsizes[4] = {1, 16, 256, 4096};
+  const size_t nthreads[4] = {1, 2, 4, 8};
+  if (dc.procid() == 0) {
+    std::cout << "Batched gets of " << NUMKEYS << " integer keys (ops/s)\n";
+    std::cout << std::setw(8) << "batch";
+    for (size_t t = 0;t < 4; ++t) {
+      std::cout << std::setw(10) << nthreads[t] << "thr";
+    }
+    std::cout << std::endl;
+    for (size_t b = 0;b < 4; ++b) {
+      std::cout << std::setw(8) << batchsizes[b];
+      for (size_t t = 0;t < 4; ++t) {
+        timer ti;
+        ti.start();
+        thread_group group;
+        for (size_t i = 0;i < nthreads[t]; ++i) {
+          group.launch(boost::bind(batched_reader, &intdht,
+                                   NUMKEYS * i / nthreads[t],
+                                   NUMKEYS * (i + 1) / nthreads[t],
+                                   batchsizes[b]));
+        }
+        group.join();
+        std::cout << std::setw(13) << size_t(NUMKEYS / ti.current_time());
+        std::cout.flush();
+      }
+      std::cout << std::endl;
+    }
+  }
+  dc.barrier();
+}
+
 int main(int argc, char ** argv) {
   mpi_tools::init(argc, argv);
   distributed_control dc;
@@ -119,5 +189,6 @@ int main(int argc, char ** argv) {
   }
   dc.barrier();
   testdht.print_stats();
+  batched_benchmark(dc);
   mpi_tools::finalize();
 }
@@ -36,6 +36,7 @@
 #include <graphlab/vertex_program/icontext.hpp>
 #include <graphlab/graph/distributed_graph.hpp>
 #include <graphlab/util/generics/conditional_addition_wrapper.hpp>
+#include <graphlab/util/generics/dense_reduction_traits.hpp>
 #include <graphlab/util/generics/test_function_or_functor_type.hpp>
 
 #include <graphlab/util/generics/any.hpp>
@@ -142,8 +143,37 @@ namespace graphlab {
       /** \brief Calls the finalize operation on internal accumulator */
       virtual void finalize(icontext_type&) = 0;
 
+      /** \brief If the accumulator is dense (see dense_reduction_traits),
+                 sums it over all machines in place and returns true.
+                 Returns false otherwise. Must be called on all machines. */
+      virtual bool all_reduce_dense(dc_dist_object<distributed_aggregator>&) = 0;
+
       virtual ~imap_reduce_base() { }
     };
+
+    /**
+     * \internal
+     * Picks between dc_dist_object::all_reduce_dense() for dense
+     * accumulators and the generic gather / broadcast in aggregate_now().
+     */
+    template <typename ReductionType, bool IsDense>
+    struct dense_all_reduce_selector {
+      static bool exec(dc_dist_object<distributed_aggregator>&,
+                       conditional_addition_wrapper<ReductionType>&) {
+        return false;
+      }
+    };
+
+    template <typename ReductionType>
+    struct dense_all_reduce_selector<ReductionType, true> {
+      static bool exec(dc_dist_object<distributed_aggregator>& rmi,
+                       conditional_addition_wrapper<ReductionType>& acc) {
+        // machines without a value contribute the zero initialized T()
+        rmi.all_reduce_dense(acc.value);
+        acc.has_value = true;
+        return true;
+      }
+    };
     
     template <typename ReductionType>
     struct default_map_types{
@@ -269,6 +299,11 @@ namespace graphlab {
       void finalize(icontext_type& context) {
         finalize_function(context, acc.value);
       }
+
+      bool all_reduce_dense(dc_dist_object<distributed_aggregator>& rmi) {
+        return dense_all_reduce_selector<ReductionType,
+            dense_reduction_traits<ReductionType>::is_dense>::exec(rmi, acc);
+      }
       
       imap_reduce_base* clone_empty() const {
         map_reduce_type* copy;
@@ -562,29 +597,32 @@ namespace graphlab {
         delete localmr;
       }
       
-      std::vector<any> gathervec(rmi.numprocs());
-      gathervec[rmi.procid()] = mr->get_accumulator();
-      
-      rmi.gather(gathervec, 0);
-      
-      if (rmi.procid() == 0) {
-        // machine 0 aggregates the accumulators
-        // sums them together and broadcasts it
-        for (procid_t i = 1; i < rmi.numprocs(); ++i) {
-          mr->add_accumulator_any(gathervec[i]);
+      // dense accumulators are summed in place over all machines.
+      // Everything else goes through machine 0.
+      if (!mr->all_reduce_dense(rmi)) {
+        std::vector<any> gathervec(rmi.numprocs());
+        gathervec[rmi.procid()] = mr->get_accumulator();
+
+        rmi.gather(gathervec, 0);
+
+        if (rmi.procid() == 0) {
+          // machine 0 aggregates the accumulators
+          // sums them together and broadcasts it
+          for (procid_t i = 1; i < rmi.numprocs(); ++i) {
+            mr->add_accumulator_any(gathervec[i]);
+          }
+          any val = mr->get_accumulator();
+          rmi.broadcast(val, true);
+        }
+        else {
+          // all other machines wait for the broadcast value
+          any val;
+          rmi.broadcast(val, false);
+          mr->set_accumulator_any(val);
         }
-        any val = mr->get_accumulator();
-        rmi.broadcast(val, true);
-      }
-      else {
-        // all other machines wait for the broadcast value
-        any val;
-        rmi.broadcast(val, false);
-        mr->set_accumulator_any(val);
       }
       mr->finalize(*context);
       mr->clear_accumulator();
-      gathervec.clear();
       return true;
     }
     
@@ -200,6 +200,25 @@ namespace graphlab {
    * increases in throughput at a consistency penalty.
    * \li \b nfibers (default: 10000) Number of fibers to use
    * \li \b stacksize (default: 16384) Stacksize of each fiber.
+   * \li \b optimistic_locking (default: true) Only used when factorized is
+   * false. A vertex with no mirrors first tries to take its neighborhood
+   * locks directly, without waiting on any neighbor, and only falls back
+   * to the distributed Chandy-Misra protocol if that fails. The number of
+   * locks taken each way and the time spent waiting on the distributed
+   * protocol are reported in the distributed event log.
+   * \li \b transactional (default: false) Only used when factorized is false.
+   * A vertex with no mirrors runs init and gather without holding its
+   * neighborhood, then takes the neighborhood without waiting and checks
+   * that no neighbor completed an update in the meantime. Apply and scatter
+   * run only if that check passes. Otherwise the read phase is retried, or
+   * the vertex falls back to locking if a neighbor is still running.
+   * Neighbors are not locked out for the duration of a long gather, which
+   * helps when conflicts are rare. With use_cache, the read phase always
+   * gathers over the edges, and caches the result only once the check
+   * passes. Commits, conflicts and fallbacks are reported at the end of
+   * start().
+   * \li \b transaction_retries (default: 3) Number of conflicting attempts
+   * after which a transactional vertex falls back to locking.
    */
   template<typename VertexProgram>
   class async_consistent_engine: public iengine<VertexProgram> {
@@ -349,6 +368,13 @@ namespace graphlab {
      */
     dense_bitset has_cache;
 
+    /**
+     * \brief Locks for the gather caches.  These are separate from the
+     * vertex locks, which are held while a scatter posts a delta to
+     * (or clears) the cache of the other vertex of the edge.
+     */
+    std::vector<simple_spinlock> cachelocks;
+
     bool use_cache;
 
     /// Engine threads.
@@ -399,6 +425,19 @@ namespace graphlab {
     /// engine option. Sets to true if factorized consistency is used
     bool factorized_consistency;
 
+    /// engine option. Try local lock acquisition before the distributed one
+    bool optimistic_locking;
+
+    /// engine option. Run the read phase of mirrorless vertices optimistically
+    bool transactional;
+
+    /// engine option. Conflicts before a transaction falls back to locking
+    size_t transaction_retries;
+
+    atomic<uint64_t> transactions_committed;
+    atomic<uint64_t> transaction_conflicts;
+    atomic<uint64_t> transaction_fallbacks;
+
     bool endgame_mode;
 
     /// Time when engine is started
@@ -414,6 +453,13 @@ namespace graphlab {
 
     std::vector<mutex> aggregation_lock;
     std::vector<std::deque<std::string> > aggregation_queue;
+
+    DECLARE_EVENT(EVENT_UPDATES);
+    DECLARE_EVENT(EVENT_OPTIMISTIC_LOCKS);
+    DECLARE_EVENT(EVENT_DISTRIBUTED_LOCKS);
+    DECLARE_EVENT(EVENT_LOCK_WAIT);
+    DECLARE_EVENT(EVENT_TRANSACTIONS);
+    DECLARE_EVENT(EVENT_TRANSACTION_CONFLICTS);
   public:
 
     /**
@@ -447,6 +493,9 @@ namespace graphlab {
       stacksize = 16384;
       use_cache = false;
       factorized_consistency = true;
+      optimistic_locking = true;
+      transactional = false;
+      transaction_retries = 3;
       track_task_time = false;
       timed_termination = (size_t)(-1);
       termination_reason = execution_status::UNSET;
@@ -484,6 +533,18 @@ namespace graphlab {
           opts.get_engine_args().get_option("factorized", factorized_consistency);
           if (rmi.procid() == 0)
             logstream(LOG_EMPH) << "Engine Option: factorized = " << factorized_consistency << std::endl;
+        } else if (opt == "optimistic_locking") {
+          opts.get_engine_args().get_option("optimistic_locking", optimistic_locking);
+          if (rmi.procid() == 0)
+            logstream(LOG_EMPH) << "Engine Option: optimistic_locking = " << optimistic_locking << std::endl;
+        } else if (opt == "transactional") {
+          opts.get_engine_args().get_option("transactional", transactional);
+          if (rmi.procid() == 0)
+            logstream(LOG_EMPH) << "Engine Option: transactional = " << transactional << std::endl;
+        } else if (opt == "transaction_retries") {
+          opts.get_engine_args().get_option("transaction_retries", transaction_retries);
+          if (rmi.procid() == 0)
+            logstream(LOG_EMPH) << "Engine Option: transaction_retries = " << transaction_retries << std::endl;
         } else if (opt == "nfibers") {
           opts.get_engine_args().get_option("nfibers", nfibers);
           if (rmi.procid() == 0)
@@ -528,6 +589,14 @@ namespace graphlab {
 
       // construct the termination consensus object
       consensus = new fiber_async_consensus(rmi.dc(), nfibers);
+
+      INITIALIZE_EVENT_LOG(rmi.dc());
+      ADD_CUMULATIVE_EVENT(EVENT_UPDATES, "Updates", "Calls");
+      ADD_CUMULATIVE_EVENT(EVENT_OPTIMISTIC_LOCKS, "Optimistic Locks", "Locks");
+      ADD_CUMULATIVE_EVENT(EVENT_DISTRIBUTED_LOCKS, "Distributed Locks", "Locks");
+      ADD_CUMULATIVE_EVENT(EVENT_LOCK_WAIT, "Lock Wait", "us");
+      ADD_CUMULATIVE_EVENT(EVENT_TRANSACTIONS, "Transactions", "Commits");
+      ADD_CUMULATIVE_EVENT(EVENT_TRANSACTION_CONFLICTS, "Transaction Conflicts", "Conflicts");
     }
 
     /**
@@ -549,6 +618,7 @@ namespace graphlab {
         gather_cache.resize(graph.num_local_vertices(), gather_type());
         has_cache.resize(graph.num_local_vertices());
         has_cache.clear();
+        cachelocks.resize(graph.num_local_vertices());
       }
       if (!factorized_consistency) {
         cm_handles.resize(graph.num_local_vertices());
@@ -703,7 +773,7 @@ namespace graphlab {
                              const gather_type& delta) {
       if(use_cache) {
         const lvid_type lvid = vertex.local_id();
-        vertexlocks[lvid].lock();
+        cachelocks[lvid].lock();
         if( has_cache.get(lvid) ) {
           gather_cache[lvid] += delta;
         } else {
@@ -712,7 +782,7 @@ namespace graphlab {
           // gather_cache[lvid] = delta;
           // has_cache.set_bit(lvid);
         }
-        vertexlocks[lvid].unlock();
+        cachelocks[lvid].unlock();
       }
     }
 
@@ -727,10 +797,10 @@ namespace graphlab {
     void internal_clear_gather_cache(const vertex_type& vertex) {
       const lvid_type lvid = vertex.local_id();
       if(use_cache && has_cache.get(lvid)) {
-        vertexlocks[lvid].lock();
+        cachelocks[lvid].lock();
         gather_cache[lvid] = gather_type();
         has_cache.clear_bit(lvid);
-        vertexlocks[lvid].unlock();
+        cachelocks[lvid].unlock();
       }
 
     }
@@ -875,17 +945,40 @@ namespace graphlab {
                                vertex_program_type& vprog_) {
       vertex_program_type vprog = vprog_;
       lvid_type lvid = graph.local_vid(vid);
-      local_vertex_type local_vertex(graph.l_vertex(lvid));
-      vertex_type vertex(local_vertex);
-      context_type context(*this, graph);
-      edge_dir_type gather_dir = vprog.gather_edges(context, vertex);
       conditional_gather_type accum;
 
       //check against the cache
       if( use_cache && has_cache.get(lvid) ) {
+        cachelocks[lvid].lock();
+        if (has_cache.get(lvid)) {
           accum.set(gather_cache[lvid]);
+          cachelocks[lvid].unlock();
           return accum;
+        }
+        cachelocks[lvid].unlock();
+      }
+      accum = perform_uncached_gather(lvid, vprog);
+      if (use_cache) {
+        cachelocks[lvid].lock();
+        gather_cache[lvid] = accum.value; has_cache.set_bit(lvid);
+        cachelocks[lvid].unlock();
       }
+      return accum;
+    }
+
+
+    /**
+     * \internal
+     * Gathers over the local edges of lvid, without reading or writing
+     * the gather cache.
+     */
+    conditional_gather_type perform_uncached_gather(lvid_type lvid,
+                                                    vertex_program_type& vprog) {
+      local_vertex_type local_vertex(graph.l_vertex(lvid));
+      vertex_type vertex(local_vertex);
+      context_type context(*this, graph);
+      edge_dir_type gather_dir = vprog.gather_edges(context, vertex);
+      conditional_gather_type accum;
       // do in edges
       if(gather_dir == IN_EDGES || gather_dir == ALL_EDGES) {
         foreach(local_edge_type local_edge, local_vertex.in_edges()) {
@@ -910,9 +1003,6 @@ namespace graphlab {
           vertexlocks[b].unlock();
         }
       } 
-      if (use_cache) {
-        gather_cache[lvid] = accum.value; has_cache.set_bit(lvid);
-      }
       return accum;
     }
 
@@ -1001,6 +1091,84 @@ namespace graphlab {
     }
 
 
+    /**
+     * \internal
+     * Optimistic read phase of a vertex with no mirrors. Records the
+     * versions of all neighbors, runs init and gather without holding the
+     * neighborhood, then takes the neighborhood without waiting and checks
+     * that no neighbor version moved. On success the neighborhood is held
+     * and vprog / gather_result are ready for apply. A moved version
+     * releases the neighborhood and retries. Returns false if a neighbor is
+     * busy at commit, or after transaction_retries conflicts. The caller
+     * must then lock the vertex, which also hands back any forks the
+     * failed commit took.
+     */
+    bool try_transactional_read(const lvid_type lvid,
+                                const message_type& msg,
+                                vertex_program_type& vprog,
+                                conditional_gather_type& gather_result) {
+      local_vertex_type local_vertex(graph.l_vertex(lvid));
+      vertex_type vertex(local_vertex);
+      context_type context(*this, graph);
+      std::vector<size_t> read_versions;
+      read_versions.reserve(local_vertex.num_in_edges() +
+                            local_vertex.num_out_edges());
+      for (size_t attempt = 0; attempt < transaction_retries; ++attempt) {
+        read_versions.clear();
+        foreach(local_edge_type local_edge, local_vertex.in_edges()) {
+          read_versions.push_back(
+              cmlocks->philosopher_version(local_edge.source().id()));
+        }
+        foreach(local_edge_type local_edge, local_vertex.out_edges()) {
+          read_versions.push_back(
+              cmlocks->philosopher_version(local_edge.target().id()));
+        }
+        vprog = vertex_program_type();
+        vprog.init(context, vertex, msg);
+        // a neighbor may post to or clear the cache while we gather, so
+        // the cache is neither read nor written until the check passes
+        gather_result = perform_uncached_gather(lvid, vprog);
+
+        bool acquired = cmlocks->try_make_philosopher_eat_local(lvid);
+        if (acquired) {
+          // we hold the neighborhood. No version can move from here on
+          bool valid = true;
+          size_t i = 0;
+          foreach(local_edge_type local_edge, local_vertex.in_edges()) {
+            if (!valid) break;
+            valid = cmlocks->philosopher_version(local_edge.source().id()) ==
+                      read_versions[i++];
+          }
+          foreach(local_edge_type local_edge, local_vertex.out_edges()) {
+            if (!valid) break;
+            valid = cmlocks->philosopher_version(local_edge.target().id()) ==
+                      read_versions[i++];
+          }
+          if (valid) {
+            if (use_cache) {
+              cachelocks[lvid].lock();
+              gather_cache[lvid] = gather_result.value;
+              has_cache.set_bit(lvid);
+              cachelocks[lvid].unlock();
+            }
+            transactions_committed.inc();
+            INCREMENT_EVENT(EVENT_TRANSACTIONS, 1);
+            return true;
+          }
+          cmlocks->philosopher_abandons_eating_local(lvid);
+        }
+        transaction_conflicts.inc();
+        INCREMENT_EVENT(EVENT_TRANSACTION_CONFLICTS, 1);
+        if (!acquired) break;
+        fiber_control::yield();
+      }
+      transaction_fallbacks.inc();
+      vprog = vertex_program_type();
+      gather_result = conditional_gather_type();
+      return false;
+    }
+
+
     /**
      * \internal
      * Called when the scheduler returns a vertex to run.
@@ -1027,23 +1195,6 @@ namespace graphlab {
       
       if (!get_exclusive_access_to_vertex(lvid, msg)) return;
 
-      /**************************************************************************/
-      /*                             Acquire Locks                              */
-      /**************************************************************************/
-      if (!factorized_consistency) {
-        // begin lock acquisition
-        cm_handles[lvid] = new vertex_fiber_cm_handle;
-        cm_handles[lvid]->philosopher_ready = false;
-        cm_handles[lvid]->fiber_handle = fiber_control::get_tid();
-        cmlocks->make_philosopher_hungry(lvid);
-        cm_handles[lvid]->lock.lock();
-        while (!cm_handles[lvid]->philosopher_ready) {
-          fiber_control::deschedule_self(&(cm_handles[lvid]->lock.m_mut));
-          cm_handles[lvid]->lock.lock();
-        }
-        cm_handles[lvid]->lock.unlock();
-      }
-
       /**************************************************************************/
       /*                             Begin Program                              */
       /**************************************************************************/
@@ -1051,29 +1202,63 @@ namespace graphlab {
       vertex_program_type vprog = vertex_program_type();
       local_vertex_type local_vertex(graph.l_vertex(lvid));
       vertex_type vertex(local_vertex);
+      conditional_gather_type gather_result;
+
+      // on success, the locks are held and init and gather have run
+      bool transaction_committed = !factorized_consistency && transactional &&
+                                   local_vertex.num_mirrors() == 0 &&
+                                   try_transactional_read(lvid, msg, vprog,
+                                                          gather_result);
+
+      /**************************************************************************/
+      /*                             Acquire Locks                              */
+      /**************************************************************************/
+      if (!factorized_consistency && !transaction_committed) {
+        if (optimistic_locking && cmlocks->try_make_philosopher_eat_local(lvid)) {
+          // uncontended, with no remote replicas: nothing to wait for
+          INCREMENT_EVENT(EVENT_OPTIMISTIC_LOCKS, 1);
+        } else {
+          // begin lock acquisition
+          timer lock_time;
+          lock_time.start();
+          cm_handles[lvid] = new vertex_fiber_cm_handle;
+          cm_handles[lvid]->philosopher_ready = false;
+          cm_handles[lvid]->fiber_handle = fiber_control::get_tid();
+          cmlocks->make_philosopher_hungry(lvid);
+          cm_handles[lvid]->lock.lock();
+          while (!cm_handles[lvid]->philosopher_ready) {
+            fiber_control::deschedule_self(&(cm_handles[lvid]->lock.m_mut));
+            cm_handles[lvid]->lock.lock();
+          }
+          cm_handles[lvid]->lock.unlock();
+          INCREMENT_EVENT(EVENT_DISTRIBUTED_LOCKS, 1);
+          INCREMENT_EVENT(EVENT_LOCK_WAIT, (size_t)(lock_time.current_time() * 1e6));
+        }
+      }
 
       /**************************************************************************/
       /*                               init phase                               */
       /**************************************************************************/
-      vprog.init(context, vertex, msg);
+      if (!transaction_committed) vprog.init(context, vertex, msg);
 
       /**************************************************************************/
       /*                              Gather Phase                              */
       /**************************************************************************/
-      conditional_gather_type gather_result;
-      std::vector<request_future<conditional_gather_type> > gather_futures;
-      foreach(procid_t mirror, local_vertex.mirrors()) {
-        gather_futures.push_back(
-            object_fiber_remote_request(rmi, 
-                                        mirror, 
-                                        &async_consistent_engine::perform_gather, 
-                                        vid,
-                                        vprog));
-      }
-      gather_result += perform_gather(vid, vprog);
+      if (!transaction_committed) {
+        std::vector<request_future<conditional_gather_type> > gather_futures;
+        foreach(procid_t mirror, local_vertex.mirrors()) {
+          gather_futures.push_back(
+              object_fiber_remote_request(rmi, 
+                                          mirror, 
+                                          &async_consistent_engine::perform_gather, 
+                                          vid,
+                                          vprog));
+        }
+        gather_result += perform_gather(vid, vprog);
 
-      for(size_t i = 0;i < gather_futures.size(); ++i) {
-        gather_result += gather_futures[i]();
+        for(size_t i = 0;i < gather_futures.size(); ++i) {
+          gather_result += gather_futures[i]();
+        }
       }
 
      /**************************************************************************/
@@ -1128,6 +1313,7 @@ namespace graphlab {
         task_time->~timer();
       }
       programs_executed.inc(); 
+      INCREMENT_EVENT(EVENT_UPDATES, 1);
     }
 
 
@@ -1231,6 +1417,9 @@ namespace graphlab {
       force_stop = false;
       endgame_mode = false;
       programs_executed = 0;
+      transactions_committed = 0;
+      transaction_conflicts = 0;
+      transaction_fallbacks = 0;
       launch_timer.start();
 
       termination_reason = execution_status::RUNNING;
@@ -1266,6 +1455,18 @@ namespace graphlab {
       rmi.all_reduce(numadds);
       rmi.cout() << "Schedule Adds: " << numadds << std::endl;
 
+      if (transactional && !factorized_consistency) {
+        size_t commits = transactions_committed.value;
+        size_t conflicts = transaction_conflicts.value;
+        size_t fallbacks = transaction_fallbacks.value;
+        rmi.all_reduce(commits);
+        rmi.all_reduce(conflicts);
+        rmi.all_reduce(fallbacks);
+        rmi.cout() << "Transactions Committed: " << commits << std::endl;
+        rmi.cout() << "Transaction Conflicts: " << conflicts << std::endl;
+        rmi.cout() << "Transaction Fallbacks: " << fallbacks << std::endl;
+      }
+
       if (track_task_time) {
         double total_task_time = 0;
         for (size_t i = 0;i < total_completion_time.size(); ++i) {
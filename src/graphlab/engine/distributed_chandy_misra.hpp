@@ -83,6 +83,7 @@ class distributed_chandy_misra {
     unsigned char counter;
     bool cancellation_sent;
     bool lockid;
+    size_t version;
   };
   std::vector<philosopher> philosopherset;
   atomic<size_t> clean_fork_count;
@@ -126,6 +127,7 @@ class distributed_chandy_misra {
       philosopherset[i].counter = 0;
       philosopherset[i].cancellation_sent = false;
       philosopherset[i].lockid = false;
+      philosopherset[i].version = 0;
     }
     for (lvid_type i = 0;i < graph.num_local_vertices(); ++i) {
       local_vertex_type lvertex(graph.l_vertex(i));
@@ -664,13 +666,14 @@ class distributed_chandy_misra {
   
 
   
-  void local_philosopher_stops_eating(lvid_type p_id) {
+  void local_philosopher_stops_eating(lvid_type p_id, bool modified = true) {
     std::vector<lvid_type> retval;
     philosopherset[p_id].lock.lock();
     if (philosopherset[p_id].state != EATING) {
       std::cout << rmi.procid() << ": " << p_id << "FAILED!! Cannot Stop Eating!" << std::endl;
 //      ASSERT_EQ((int)philosopherset[p_id].state, (int)EATING);
     }
+    if (modified) ++philosopherset[p_id].version;
     
     local_vertex_type lvertex(graph.l_vertex(p_id));
     // now forks are dirty
@@ -816,6 +819,70 @@ class distributed_chandy_misra {
   }
   
   
+/****************************************************************************
+ * Optimistic local acquisition.
+ *
+ * A philosopher without mirrors only needs the forks on its local edges.
+ * If it already holds all of them, or can take the missing ones from
+ * THINKING neighbors without waiting on any neighbor lock, it goes straight
+ * from THINKING to EATING, skipping HUNGRY / HORS_DOEUVRE and the callback.
+ * Forks are taken clean, just as a THINKING owner gives them up on request.
+ * This keeps the precedence graph unchanged, so a failed attempt cannot
+ * close a cycle. The caller must then follow with make_philosopher_hungry(),
+ * since neighbors cannot take the clean forks back until p_id has eaten.
+ *
+ * Returns true if the philosopher is now EATING.
+ ***************************************************************************/
+  bool try_make_philosopher_eat_local(lvid_type p_id) {
+    local_vertex_type lvertex(graph.l_vertex(p_id));
+    if (lvertex.num_mirrors() > 0) return false;
+    philosopher& p = philosopherset[p_id];
+    p.lock.lock();
+    bool success = p.state == THINKING;
+    foreach(local_edge_type edge, lvertex.in_edges()) {
+      if (!success) break;
+      success = try_take_fork_locked(edge.id(), edge.source().id(),
+                                     p_id, OWNER_TARGET);
+    }
+    foreach(local_edge_type edge, lvertex.out_edges()) {
+      if (!success) break;
+      success = try_take_fork_locked(edge.id(), edge.target().id(),
+                                     p_id, OWNER_SOURCE);
+    }
+    if (success) {
+      ASSERT_EQ(p.forks_acquired, p.num_edges);
+      p.lockid = !p.lockid;
+      p.counter = 0;
+      p.cancellation_sent = false;
+      p.state = EATING;
+    }
+    p.lock.unlock();
+    return success;
+  }
+
+  /**
+   * Makes sure p_id holds the fork between it and other, without blocking.
+   * p_id must be locked. Fails if the neighbor is busy, or if the neighbor
+   * is waiting for a fork p_id holds.
+   */
+  inline bool try_take_fork_locked(size_t forkid, lvid_type other,
+                                   lvid_type p_id, unsigned char p_side) {
+    if (other == p_id) return true;
+    if (fork_owner(forkid) == p_side) {
+      return (forkset[forkid] & request_bit(!p_side)) == 0;
+    }
+    if (!philosopherset[other].lock.try_lock()) return false;
+    bool taken = philosopherset[other].state == THINKING && fork_dirty(forkid);
+    if (taken) {
+      forkset[forkid] = p_side;
+      clean_fork_count.inc();
+      philosopherset[other].forks_acquired--;
+      philosopherset[p_id].forks_acquired++;
+    }
+    philosopherset[other].lock.unlock();
+    return taken;
+  }
+
   void philosopher_stops_eating(lvid_type p_id) {
     local_vertex_type lvertex(graph.l_vertex(p_id));    
 
@@ -843,6 +910,25 @@ class distributed_chandy_misra {
   }
 
 
+  /**
+   * Releases the forks of a philosopher that became EATING through
+   * try_make_philosopher_eat_local() but did not modify anything, without
+   * advancing its version.
+   */
+  void philosopher_abandons_eating_local(lvid_type p_id) {
+    local_philosopher_stops_eating(p_id, false);
+  }
+
+  /**
+   * Number of times this replica of p_id has stopped eating after a
+   * modification. A neighbor which reads the same value before and after
+   * reading p_id's data, and finds p_id not EATING at the end, read data
+   * no update was writing.
+   */
+  size_t philosopher_version(lvid_type p_id) const {
+    return *reinterpret_cast<const volatile size_t*>(&philosopherset[p_id].version);
+  }
+
   void no_locks_consistency_check() {
     // make sure all forks are dirty
     for (size_t i = 0;i < forkset.size(); ++i) ASSERT_TRUE(fork_dirty(i));
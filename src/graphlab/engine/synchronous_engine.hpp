@@ -33,6 +33,7 @@
 #include <graphlab/vertex_program/ivertex_program.hpp>
 #include <graphlab/vertex_program/icontext.hpp>
 #include <graphlab/vertex_program/context.hpp>
+#include <graphlab/vertex_program/static_edge_traits.hpp>
 
 #include <graphlab/engine/execution_status.hpp>
 #include <graphlab/options/graphlab_options.hpp>
@@ -48,6 +49,8 @@
 #include <graphlab/rpc/dc_dist_object.hpp>
 #include <graphlab/rpc/distributed_event_log.hpp>
 #include <graphlab/rpc/fiber_buffered_exchange.hpp>
+#include <graphlab/scheduler/get_message_priority.hpp>
+#include <graphlab/scheduler/delta_stepping_scheduler.hpp>
 
 
 
@@ -199,6 +202,16 @@ namespace graphlab {
    * for the snapshot. The path including folder and file prefix in
    * which the snapshots should be saved.
    *
+   * \li \b delta If set to a positive value, the engine runs in
+   * delta-stepping bucket mode. The priority of each message (see
+   * \ref graphlab::delta_stepping_bucket) selects a bucket of width
+   * delta, and each super-step only runs the vertices whose messages fall
+   * in the lowest non-empty bucket across all machines. The other
+   * messages wait for a later super-step. For shortest paths, where the
+   * message priority is the negated distance, this avoids most of the
+   * repeated relaxations of Bellman-Ford style rounds. Defaults to 0
+   * (run all vertices with messages).
+   *
    * \see graphlab::omni_engine
    * \see graphlab::async_consistent_engine
    * \see graphlab::semi_synchronous_engine
@@ -322,6 +335,52 @@ namespace graphlab {
     typedef context<synchronous_engine> context_type;
     friend class context<synchronous_engine>;
 
+    /**
+     * \brief The edge directions of the vertex program, if it declares
+     * them at compile time. See static_edge_traits.
+     */
+    typedef static_edge_traits<vertex_program_type> edge_traits;
+
+    /**
+     * \brief Adds the gather of each visited edge to the accumulator.
+     * gather is called non-virtually so that it can be inlined into the
+     * edge loop of graph_type::l_foreach_in_edge().
+     */
+    struct static_gather_visitor {
+      context_type& context;
+      const vertex_program_type& vprog;
+      const vertex_type& vertex;
+      gather_type& accum;
+      size_t edges_touched;
+      static_gather_visitor(context_type& context,
+                            const vertex_program_type& vprog,
+                            const vertex_type& vertex, gather_type& accum) :
+        context(context), vprog(vprog), vertex(vertex), accum(accum),
+        edges_touched(0) { }
+      void operator()(edge_type& edge) {
+        accum += vprog.VertexProgram::gather(context, vertex, edge);
+        ++edges_touched;
+      }
+    };
+
+    /**
+     * \brief Scatters on each visited edge, calling scatter non-virtually.
+     */
+    struct static_scatter_visitor {
+      context_type& context;
+      const vertex_program_type& vprog;
+      const vertex_type& vertex;
+      size_t edges_touched;
+      static_scatter_visitor(context_type& context,
+                             const vertex_program_type& vprog,
+                             const vertex_type& vertex) :
+        context(context), vprog(vprog), vertex(vertex), edges_touched(0) { }
+      void operator()(edge_type& edge) {
+        vprog.VertexProgram::scatter(context, vertex, edge);
+        ++edges_touched;
+      }
+    };
+
 
     /**
      * \brief The type of the distributed aggregator inherited from iengine
@@ -404,6 +463,17 @@ namespace graphlab {
      */
     bool sched_allv;
 
+    /**
+     * \brief The delta-stepping bucket width. Bucket mode is disabled
+     * if not positive.
+     */
+    double delta;
+
+    /**
+     * \brief The bucket run in this super-step, in bucket mode.
+     */
+    size_t current_bucket;
+
     /**
      * \brief Used to stop the engine prematurely
      */
@@ -843,6 +913,16 @@ namespace graphlab {
      */
     void receive_messages(size_t thread_id);
 
+    struct min_bucket_reducer {
+      void operator()(size_t& a, const size_t& b) const { a = std::min(a, b); }
+    };
+
+    /**
+     * \brief Returns the lowest delta-stepping bucket of all messages
+     * on all machines. (size_t)(-1) if there are no messages.
+     */
+    size_t lowest_message_bucket();
+
 
     /**
      * \brief Execute the \ref graphlab::ivertex_program::gather function on all
@@ -1007,7 +1087,7 @@ namespace graphlab {
     threads(2*1024*1024 /* 2MB stack per fiber*/),
     thread_barrier(opts.get_ncpus()),
     max_iterations(-1), snapshot_interval(-1), iteration_counter(0),
-    timeout(0), sched_allv(false),
+    timeout(0), sched_allv(false), delta(0), current_bucket(0),
     vprog_exchange(dc),
     vdata_exchange(dc),
     gather_exchange(dc),
@@ -1048,6 +1128,11 @@ namespace graphlab {
         if (rmi.procid() == 0)
           logstream(LOG_EMPH) << "Engine Option: sched_allv = "
             << sched_allv << std::endl;
+      } else if (opt == "delta") {
+        opts.get_engine_args().get_option("delta", delta);
+        if (rmi.procid() == 0)
+          logstream(LOG_EMPH) << "Engine Option: delta = "
+            << delta << std::endl;
       } else {
         logstream(LOG_FATAL) << "Unexpected Engine Option: " << opt << std::endl;
       }
@@ -1338,12 +1423,20 @@ namespace graphlab {
       //
 
       // if (rmi.procid() == 0) std::cout << "Receive messages..." << std::endl;
+      if (delta > 0) {
+        // only the messages of the lowest bucket are received
+        current_bucket = lowest_message_bucket();
+        if (rmi.procid() == 0 && print_this_round)
+          logstream(LOG_EMPH)
+            << "\tBucket: " << current_bucket << std::endl;
+      }
       num_active_vertices = 0;
       run_synchronous( &synchronous_engine::receive_messages );
       if (sched_allv) {
         active_minorstep.fill();
       }
-      has_message.clear();
+      // in bucket mode, receive_messages clears the received messages
+      if (delta <= 0) has_message.clear();
       /**
        * Post conditions:
        *   1) there are no messages remaining
@@ -1522,6 +1615,13 @@ namespace graphlab {
 
         // if this is the master of lvid and we have a message
         if(graph.l_is_master(lvid)) {
+          if (delta > 0) {
+            // leave messages of later buckets for a later super-step
+            const double priority =
+                scheduler_impl::get_message_priority(messages[lvid]);
+            if (delta_stepping_bucket(priority, delta) > current_bucket) continue;
+            has_message.clear_bit(lvid);
+          }
           // The vertex becomes active for this superstep
           active_superstep.set_bit(lvid);
           ++nactive_inc;
@@ -1559,6 +1659,24 @@ namespace graphlab {
   } // end of receive messages
 
 
+  template<typename VertexProgram>
+  size_t synchronous_engine<VertexProgram>::
+  lowest_message_bucket() {
+    // only masters have messages after the exchange
+    size_t bucket = (size_t)(-1);
+    size_t lvid = 0;
+    if (has_message.first_bit(lvid)) {
+      do {
+        const double priority =
+            scheduler_impl::get_message_priority(messages[lvid]);
+        bucket = std::min(bucket, delta_stepping_bucket(priority, delta));
+      } while(has_message.next_bit(lvid));
+    }
+    rmi.all_reduce2(bucket, min_bucket_reducer());
+    return bucket;
+  } // end of lowest_message_bucket
+
+
   template<typename VertexProgram>
   void synchronous_engine<VertexProgram>::
   execute_gathers(const size_t thread_id) {
@@ -1593,6 +1711,29 @@ namespace graphlab {
         if( caching_enabled && has_cache.get(lvid) ) {
           accum = gather_cache[lvid];
           accum_is_set = true;
+        } else if(edge_traits::is_static) {
+          // The gather direction is fixed at compile time and gather_type() is
+          // the identity of +=, so walk the local adjacency arrays
+          // directly without the first edge branch
+          const vertex_program_type& vprog = vertex_programs[lvid];
+          local_vertex_type local_vertex = graph.l_vertex(lvid);
+          const vertex_type vertex(local_vertex);
+          const edge_dir_type gather_dir = edge_traits::gather_dir;
+          DASSERT_TRUE(vprog.gather_edges(context, vertex) == gather_dir);
+          static_gather_visitor visitor(context, vprog, vertex, accum);
+          vprog.pre_local_gather(accum);
+          if(gather_dir == IN_EDGES || gather_dir == ALL_EDGES) {
+            graph.l_foreach_in_edge(lvid, visitor);
+          }
+          if(gather_dir == OUT_EDGES || gather_dir == ALL_EDGES) {
+            graph.l_foreach_out_edge(lvid, visitor);
+          }
+          INCREMENT_EVENT(EVENT_GATHERS, visitor.edges_touched);
+          vprog.post_local_gather(accum);
+          accum_is_set = visitor.edges_touched > 0;
+          if(caching_enabled && accum_is_set) {
+            gather_cache[lvid] = accum; has_cache.set_bit(lvid);
+          } // end of if caching enabled
         } else {
           // recompute the local contribution to the gather
           const vertex_program_type& vprog = vertex_programs[lvid];
@@ -1759,6 +1900,22 @@ namespace graphlab {
         const vertex_program_type& vprog = vertex_programs[lvid];
         local_vertex_type local_vertex = graph.l_vertex(lvid);
         const vertex_type vertex(local_vertex);
+        if(edge_traits::is_static) {
+          const edge_dir_type scatter_dir = edge_traits::is_static_scatter ?
+              edge_traits::scatter_dir :
+              vprog.VertexProgram::scatter_edges(context, vertex);
+          DASSERT_TRUE(vprog.scatter_edges(context, vertex) == scatter_dir);
+          static_scatter_visitor visitor(context, vprog, vertex);
+          if(scatter_dir == IN_EDGES || scatter_dir == ALL_EDGES) {
+            graph.l_foreach_in_edge(lvid, visitor);
+          }
+          if(scatter_dir == OUT_EDGES || scatter_dir == ALL_EDGES) {
+            graph.l_foreach_out_edge(lvid, visitor);
+          }
+          INCREMENT_EVENT(EVENT_SCATTERS, visitor.edges_touched);
+          vertex_programs[lvid] = vertex_program_type();
+          continue;
+        }
         const edge_dir_type scatter_dir = vprog.scatter_edges(context, vertex);
 				size_t edges_touched = 0;
         // Loop over in edges
@@ -1811,13 +1968,13 @@ namespace graphlab {
   void synchronous_engine<VertexProgram>::
   recv_vertex_programs() {
     typename vprog_exchange_type::recv_buffer_type recv_buffer;
-    while(vprog_exchange.recv(recv_buffer)) {
+    while(vprog_exchange.recv_in_place(recv_buffer)) {
       for (size_t i = 0;i < recv_buffer.size(); ++i) {
-        typename vprog_exchange_type::buffer_type& buffer = recv_buffer[i].buffer;
-        foreach(const vid_prog_pair_type& pair, buffer) {
-          const lvid_type lvid = graph.local_vid(pair.first);
+        typename vprog_exchange_type::pair_reader reader(recv_buffer[i]);
+        while(!reader.done()) {
+          const lvid_type lvid = graph.local_vid(reader.first());
           //      ASSERT_FALSE(graph.l_is_master(lvid));
-          vertex_programs[lvid] = pair.second;
+          reader.second(vertex_programs[lvid]);
           active_minorstep.set_bit(lvid);
         }
       }
@@ -1844,13 +2001,13 @@ namespace graphlab {
   void synchronous_engine<VertexProgram>::
   recv_vertex_data() {
     typename vdata_exchange_type::recv_buffer_type recv_buffer;
-    while(vdata_exchange.recv(recv_buffer)) {
+    while(vdata_exchange.recv_in_place(recv_buffer)) {
       for (size_t i = 0;i < recv_buffer.size(); ++i) {
-        typename vdata_exchange_type::buffer_type& buffer = recv_buffer[i].buffer;
-        foreach(const vid_vdata_pair_type& pair, buffer) {
-          const lvid_type lvid = graph.local_vid(pair.first);
+        typename vdata_exchange_type::pair_reader reader(recv_buffer[i]);
+        while(!reader.done()) {
+          const lvid_type lvid = graph.local_vid(reader.first());
           ASSERT_FALSE(graph.l_is_master(lvid));
-          graph.l_vertex(lvid).data() = pair.second;
+          reader.second(graph.l_vertex(lvid).data());
         }
       }
     }
@@ -1880,18 +2037,20 @@ namespace graphlab {
   void synchronous_engine<VertexProgram>::
   recv_gathers() {
     typename gather_exchange_type::recv_buffer_type recv_buffer;
-    while(gather_exchange.recv(recv_buffer)) {
+    while(gather_exchange.recv_in_place(recv_buffer)) {
       for (size_t i = 0;i < recv_buffer.size(); ++i) {
-        typename gather_exchange_type::buffer_type& buffer = recv_buffer[i].buffer;
-        foreach(const vid_gather_pair_type& pair, buffer) {
-          const lvid_type lvid = graph.local_vid(pair.first);
-          const gather_type& accum = pair.second;
+        typename gather_exchange_type::pair_reader reader(recv_buffer[i]);
+        while(!reader.done()) {
+          const lvid_type lvid = graph.local_vid(reader.first());
           ASSERT_TRUE(graph.l_is_master(lvid));
           vlocks[lvid].lock();
           if( has_gather_accum.get(lvid) ) {
+            // only a sum needs the accumulator on its own
+            gather_type accum;
+            reader.second(accum);
             gather_accum[lvid] += accum;
           } else {
-            gather_accum[lvid] = accum;
+            reader.second(gather_accum[lvid]);
             has_gather_accum.set_bit(lvid);
           }
           vlocks[lvid].unlock();
@@ -1917,17 +2076,19 @@ namespace graphlab {
   void synchronous_engine<VertexProgram>::
   recv_messages() {
     typename message_exchange_type::recv_buffer_type recv_buffer;
-    while(message_exchange.recv(recv_buffer)) {
+    while(message_exchange.recv_in_place(recv_buffer)) {
       for (size_t i = 0;i < recv_buffer.size(); ++i) {
-        typename message_exchange_type::buffer_type& buffer = recv_buffer[i].buffer;
-        foreach(const vid_message_pair_type& pair, buffer) {
-          const lvid_type lvid = graph.local_vid(pair.first);
+        typename message_exchange_type::pair_reader reader(recv_buffer[i]);
+        while(!reader.done()) {
+          const lvid_type lvid = graph.local_vid(reader.first());
           ASSERT_TRUE(graph.l_is_master(lvid));
           vlocks[lvid].lock();
           if( has_message.get(lvid) ) {
-            messages[lvid] += pair.second;
+            message_type msg;
+            reader.second(msg);
+            messages[lvid] += msg;
           } else {
-            messages[lvid] = pair.second;
+            reader.second(messages[lvid]);
             has_message.set_bit(lvid);
           }
           vlocks[lvid].unlock();
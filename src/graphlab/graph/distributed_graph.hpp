@@ -2747,6 +2747,32 @@ namespace graphlab {
       return local_graph.num_out_edges(lvid);
     }
 
+    /**
+     * \internal
+     * \brief Calls visit(edge) with an edge_type for each in edge of a
+     *        local vertex ID on the local graph.
+     *
+     * Visits the same edges as l_in_edges() but iterates the local
+     * adjacency storage directly, so that a visitor whose type is known
+     * at compile time is inlined into the loop.
+     */
+    template <typename Visitor>
+    void l_foreach_in_edge(const lvid_type lvid, Visitor& visit) {
+      edge_visitor_adapter<Visitor> adapter(*this, visit);
+      local_graph.foreach_in_edge(lvid, adapter);
+    }
+
+    /**
+     * \internal
+     * \brief Calls visit(edge) with an edge_type for each out edge of a
+     *        local vertex ID on the local graph. See l_foreach_in_edge().
+     */
+    template <typename Visitor>
+    void l_foreach_out_edge(const lvid_type lvid, Visitor& visit) {
+      edge_visitor_adapter<Visitor> adapter(*this, visit);
+      local_graph.foreach_out_edge(lvid, adapter);
+    }
+
     procid_t procid() const {
       return rpc.procid();
     }
@@ -3047,6 +3073,22 @@ namespace graphlab {
       edge_id_type id() const { return e.id(); }
     };
 
+    /** \internal
+     * \brief Wraps the local graph edges passed to a visitor into
+     *        edge_type. Used by l_foreach_in_edge() and l_foreach_out_edge()
+     */
+    template <typename Visitor>
+    struct edge_visitor_adapter {
+      distributed_graph& graph_ref;
+      Visitor& visit;
+      edge_visitor_adapter(distributed_graph& graph_ref, Visitor& visit):
+                                         graph_ref(graph_ref), visit(visit) { }
+      void operator()(const typename local_graph_type::edge_type& e) const {
+        edge_type edge(graph_ref, e);
+        visit(edge);
+      }
+    };
+
     /** \internal
      * \brief A functor which converts local_graph_type::edge_type to
      *        local_edge_type
@@ -458,6 +458,27 @@ namespace graphlab {
       return boost::make_iterator_range(begin, end);
     }
 
+    /**
+     * \internal
+     * \brief Calls visit(edge) on each in edge of the vertex with the
+     * given id. Unlike in_edges() this walks the values of each storage
+     * block with a raw pointer, so the loop body can be inlined.
+     */
+    template <typename Visitor>
+    void foreach_in_edge(lvid_type v, Visitor& visit) {
+      visit_edges<true>(_csc_storage.begin(v), _csc_storage.end(v), v, visit);
+    }
+
+    /**
+     * \internal
+     * \brief Calls visit(edge) on each out edge of the vertex with the
+     * given id. See foreach_in_edge().
+     */
+    template <typename Visitor>
+    void foreach_out_edge(lvid_type v, Visitor& visit) {
+      visit_edges<false>(_csr_storage.begin(v), _csr_storage.end(v), v, visit);
+    }
+
     /**
      * \internal
      * \brief Returns edge data of edge_type e
@@ -518,6 +539,28 @@ namespace graphlab {
     /** The vertex data is simply a vector of vertex data */
     std::vector<VertexData> vertices;
 
+    /** Visits the edges of vid stored in [begin, end) one block at a time */
+    template <bool InEdges, typename Visitor>
+    void visit_edges(typename csr_type::iterator begin,
+                     typename csr_type::iterator end,
+                     lvid_type vid, Visitor& visit) {
+      typedef typename csr_type::blocktype blocktype;
+      blocktype* block = begin.get_blockptr();
+      blocktype* endblock = end.get_blockptr();
+      size_t offset = begin.get_offset();
+      while (block != NULL) {
+        const size_t last = (block == endblock) ? end.get_offset() : block->size();
+        const std::pair<lvid_type, edge_id_type>* values = block->data();
+        for (size_t i = offset; i < last; ++i) {
+          if (InEdges) visit(edge_type(*this, values[i].first, vid, values[i].second));
+          else visit(edge_type(*this, vid, values[i].first, values[i].second));
+        }
+        if (block == endblock) break;
+        block = block->next();
+        offset = 0;
+      }
+    }
+
     /** Stores the edge data and edge relationships. */
     csr_type _csr_storage;
     csr_type _csc_storage;
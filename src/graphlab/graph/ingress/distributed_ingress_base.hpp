@@ -57,8 +57,12 @@ namespace graphlab {
     /// The underlying distributed graph object that is being loaded
     graph_type& graph;
 
-    /// Temporary buffers used to store vertex data on ingress
-    struct vertex_buffer_record {
+    /** Temporary buffers used to store vertex data on ingress.
+     *  When the vertex data is a POD and the record has no padding, the
+     *  record is itself a POD and is copied as a block. */
+    struct vertex_buffer_record :
+      public conditional_pod_type<
+        gl_is_packed_pod_pair<vertex_id_type, vertex_data_type>::value> {
       vertex_id_type vid;
       vertex_data_type vdata;
       vertex_buffer_record(vertex_id_type vid = -1,
@@ -69,8 +73,11 @@ namespace graphlab {
     }; 
     buffered_exchange<vertex_buffer_record> vertex_exchange;
 
-    /// Temporar buffers used to store edge data on ingress
-    struct edge_buffer_record {
+    /// Temporar buffers used to store edge data on ingress. POD as above.
+    struct edge_buffer_record :
+      public conditional_pod_type<
+        gl_is_packed_pod_pair<std::pair<vertex_id_type, vertex_id_type>,
+                              edge_data_type>::value> {
       vertex_id_type source, target;
       edge_data_type edata;
       edge_buffer_record(const vertex_id_type& source = vertex_id_type(-1), 
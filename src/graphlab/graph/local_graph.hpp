@@ -547,6 +547,37 @@ namespace graphlab {
       return boost::make_iterator_range(begin, end);
     }
 
+    /**
+     * \internal
+     * \brief Calls visit(edge) on each in edge of the vertex with the
+     * given id. Unlike in_edges() this walks the CSC array with a raw
+     * pointer, so the loop body can be inlined.
+     */
+    template <typename Visitor>
+    void foreach_in_edge(lvid_type v, Visitor& visit) {
+      const size_t len = _csc_storage.end(v) - _csc_storage.begin(v);
+      if (len == 0) return;
+      const std::pair<lvid_type, edge_id_type>* ptr = &(*_csc_storage.begin(v));
+      const std::pair<lvid_type, edge_id_type>* end = ptr + len;
+      for (; ptr != end; ++ptr) visit(edge_type(*this, ptr->first, v, ptr->second));
+    }
+
+    /**
+     * \internal
+     * \brief Calls visit(edge) on each out edge of the vertex with the
+     * given id. See foreach_in_edge().
+     */
+    template <typename Visitor>
+    void foreach_out_edge(lvid_type v, Visitor& visit) {
+      const edge_id_type begin_eid = _csr_storage.begin(v) - _csr_storage.begin(0);
+      const edge_id_type end_eid = _csr_storage.end(v) - _csr_storage.begin(0);
+      if (begin_eid == end_eid) return;
+      const lvid_type* targets = &(*_csr_storage.begin(0));
+      for (edge_id_type eid = begin_eid; eid < end_eid; ++eid) {
+        visit(edge_type(*this, v, targets[eid], eid));
+      }
+    }
+
     /** 
      * \internal
      * \brief Returns edge data of edge_type e
@@ -21,6 +21,12 @@
  */
 
 
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <boost/bind.hpp>
 #include <graphlab/util/random.hpp>
 #include <graphlab/parallel/fiber_control.hpp>
@@ -28,6 +34,12 @@
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/macros_def.hpp>
 //#include <valgrind/valgrind.h>
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+#ifndef MAP_NORESERVE
+#define MAP_NORESERVE 0
+#endif
 namespace graphlab {
 
 bool fiber_control::tls_created = false;
@@ -46,6 +58,9 @@ fiber_control::fiber_control(size_t nworkers,
                              size_t affinity_base)
     :nworkers(nworkers),
     affinity_base(affinity_base),
+    work_stealing(true),
+    max_pooled_fibers(DEFAULT_MAX_POOLED_FIBERS),
+    max_mapped_stacks(16384),
     stop_workers(false),
     flsdeleter(NULL) {
   // initialize the thread local storage keys
@@ -63,7 +78,14 @@ fiber_control::fiber_control(size_t nworkers,
     schedule[i].priority_queue = new inplace_lf_queue2<fiber>;
     schedule[i].popped_affinity_queue = NULL;
     schedule[i].popped_priority_queue = NULL;
+    schedule[i].reused_launches = 0;
+    schedule[i].allocated_launches = 0;
   }
+  install_overflow_handler();
+  // leave at least half of the memory maps to the rest of the process
+  std::ifstream fin("/proc/sys/vm/max_map_count");
+  size_t max_map_count = 0;
+  if (fin >> max_map_count) max_mapped_stacks = max_map_count / 4;
   // launch the workers
   for (size_t i = 0;i < nworkers; ++i) {
     workers.launch(boost::bind(&fiber_control::worker_init, this, i), 
@@ -82,15 +104,197 @@ fiber_control::~fiber_control() {
     delete schedule[i].priority_queue;
   }
   workers.join();
+  for (size_t i = 0;i < nworkers; ++i) {
+    for (size_t j = 0;j < schedule[i].fiber_pool.size(); ++j) {
+      destroy_fiber(schedule[i].fiber_pool[j]);
+    }
+    schedule[i].fiber_pool.clear();
+  }
 
+  pthread_key_delete(tlskey);
+}
 
 
-  pthread_key_delete(tlskey);
+static size_t page_size() {
+  static size_t pagesize = sysconf(_SC_PAGESIZE);
+  return pagesize;
 }
 
+fiber_control::fiber* fiber_control::allocate_fiber(size_t stacksize) {
+  size_t pagesize = page_size();
+  stacksize = (stacksize + pagesize - 1) / pagesize * pagesize;
+  // use the pool of the current worker. Launches from outside the workers
+  // pick any pool.
+  size_t workerid = get_worker_id();
+  if (workerid >= nworkers) {
+    workerid = graphlab::random::fast_uniform<size_t>(0, nworkers - 1);
+  }
+  thread_schedule& ts = schedule[workerid];
+  fiber* fib = NULL;
+  ts.pool_lock.lock();
+  // all fibers of a pool generally have the same stack size.
+  // Search from the back, where the most recently used stacks are.
+  for (size_t i = ts.fiber_pool.size(); i > 0; --i) {
+    if (ts.fiber_pool[i - 1]->stacksize == stacksize) {
+      fib = ts.fiber_pool[i - 1];
+      ts.fiber_pool[i - 1] = ts.fiber_pool.back();
+      ts.fiber_pool.pop_back();
+      break;
+    }
+  }
+  fiber* evicted = NULL;
+  if (fib != NULL) {
+    ++ts.reused_launches;
+  } else {
+    ++ts.allocated_launches;
+    // the pool holds stacks of another size. Let them age out, so that a
+    // change of stack size does not leave the pool useless.
+    if (!ts.fiber_pool.empty()) {
+      evicted = ts.fiber_pool.back();
+      ts.fiber_pool.pop_back();
+    }
+  }
+  ts.pool_lock.unlock();
+  if (evicted != NULL) destroy_fiber(evicted);
+  if (fib != NULL) return fib;
+
+  fib = new fiber;
+  fib->parent = this;
+  fib->stacksize = stacksize;
+  fib->stack_mapping = NULL;
+  if (mapped_stacks.inc() <= max_mapped_stacks) {
+    // Map the stack with a guard page below it, since the stack grows
+    // downwards. The pages are only committed when first touched.
+    size_t mapsize = stacksize + pagesize;
+    void* mapping = mmap(NULL, mapsize, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping != MAP_FAILED && mprotect(mapping, pagesize, PROT_NONE) == 0) {
+      fib->stack_mapping = mapping;
+      fib->stack = (char*)mapping + pagesize;
+      mapped_bytes.inc(mapsize);
+      return fib;
+    }
+    logstream(LOG_WARNING) << "Unable to map a guarded fiber stack: "
+                           << strerror(errno) << std::endl;
+    if (mapping != MAP_FAILED) munmap(mapping, mapsize);
+  }
+  mapped_stacks.dec();
+  fib->stack = malloc(stacksize);
+  ASSERT_TRUE(fib->stack != NULL);
+  unguarded_stacks.inc();
+  return fib;
+}
+
+void fiber_control::recycle_fiber(size_t workerid, fiber* fib) {
+  thread_schedule& ts = schedule[workerid];
+  ts.pool_lock.lock();
+  if (ts.fiber_pool.size() < max_pooled_fibers) {
+    ts.fiber_pool.push_back(fib);
+    fib = NULL;
+  }
+  ts.pool_lock.unlock();
+  if (fib != NULL) destroy_fiber(fib);
+}
+
+void fiber_control::set_max_pooled_fibers(size_t n) {
+  max_pooled_fibers = n;
+  for (size_t i = 0;i < nworkers; ++i) {
+    std::vector<fiber*> evicted;
+    schedule[i].pool_lock.lock();
+    while (schedule[i].fiber_pool.size() > n) {
+      evicted.push_back(schedule[i].fiber_pool.back());
+      schedule[i].fiber_pool.pop_back();
+    }
+    schedule[i].pool_lock.unlock();
+    for (size_t j = 0;j < evicted.size(); ++j) destroy_fiber(evicted[j]);
+  }
+}
+
+void fiber_control::destroy_fiber(fiber* fib) {
+  if (fib->stack_mapping != NULL) {
+    size_t mapsize = fib->stacksize + page_size();
+    munmap(fib->stack_mapping, mapsize);
+    mapped_stacks.dec();
+    mapped_bytes.dec(mapsize);
+  } else {
+    free(fib->stack);
+    unguarded_stacks.dec();
+  }
+  delete fib;
+}
+
+fiber_control::stack_pool_stats fiber_control::get_stack_pool_stats() {
+  stack_pool_stats ret;
+  for (size_t i = 0;i < nworkers; ++i) {
+    schedule[i].pool_lock.lock();
+    ret.reused_launches += schedule[i].reused_launches;
+    ret.allocated_launches += schedule[i].allocated_launches;
+    ret.pooled_fibers += schedule[i].fiber_pool.size();
+    schedule[i].pool_lock.unlock();
+  }
+  ret.mapped_stacks = mapped_stacks.value;
+  ret.mapped_bytes = mapped_bytes.value;
+  ret.unguarded_stacks = unguarded_stacks.value;
+  return ret;
+}
+
+static struct sigaction previous_segv_action;
+
+void fiber_control::install_overflow_handler() {
+  static bool installed = false;
+  if (installed) return;
+  installed = true;
+  struct sigaction act;
+  memset(&act, 0, sizeof(act));
+  act.sa_sigaction = fiber_control::overflow_handler;
+  sigemptyset(&act.sa_mask);
+  // run on the worker's alternate stack: the faulting stack is exhausted
+  act.sa_flags = SA_SIGINFO | SA_ONSTACK;
+  sigaction(SIGSEGV, &act, &previous_segv_action);
+}
+
+void fiber_control::overflow_handler(int sig, siginfo_t* info, void* context) {
+  tls* t = tls_created ? (tls*)pthread_getspecific(tlskey) : NULL;
+  fiber* fib = t != NULL ? t->cur_fiber : NULL;
+  char* addr = (char*)info->si_addr;
+  // A fault in the guard page, or in a frame large enough to jump over it,
+  // is an overflow of the running fiber.
+  if (fib != NULL && fib->stack_mapping != NULL && addr < (char*)fib->stack &&
+      addr + fib->stacksize >= (char*)fib->stack) {
+    char msg[256];
+    int len = snprintf(msg, sizeof(msg),
+                       "Fiber stack overflow: fiber %ld on worker %ld "
+                       "exceeded its %ld byte stack. Launch it with a larger "
+                       "stacksize.\n",
+                       (long)fib->id, (long)t->workerid, (long)fib->stacksize);
+    if (len > 0) {
+      ssize_t ret = write(STDERR_FILENO, msg, std::min<size_t>(len, sizeof(msg) - 1));
+      (void)ret;
+    }
+    abort();
+  }
+  // not ours. Hand over to the previous handler
+  if (previous_segv_action.sa_flags & SA_SIGINFO) {
+    previous_segv_action.sa_sigaction(sig, info, context);
+  } else if (previous_segv_action.sa_handler != SIG_DFL &&
+             previous_segv_action.sa_handler != SIG_IGN) {
+    previous_segv_action.sa_handler(sig);
+  } else {
+    // restore the default action. The faulting instruction runs again
+    // and the process dies as it would have without this handler.
+    sigaction(SIGSEGV, &previous_segv_action, NULL);
+  }
+}
 
 void fiber_control::tls_deleter(void* f) {
   fiber_control::tls* t = (fiber_control::tls*)(f);
+  if (t->signal_stack != NULL) {
+    stack_t ss;
+    memset(&ss, 0, sizeof(ss));
+    ss.ss_flags = SS_DISABLE;
+    sigaltstack(&ss, NULL);
+    free(t->signal_stack);
+  }
   delete t;
 }
 
@@ -122,6 +326,10 @@ void fiber_control::active_queue_insert_tail(size_t workerid, fiber_control::fib
       schedule[workerid].active_lock.lock();
       schedule[workerid].active_cond.signal();
       schedule[workerid].active_lock.unlock();
+    } else if (work_stealing && idle_workers.value > 0 &&
+               schedule[workerid].affinity_queue->approx_size() > 1) {
+      // the worker is busy and fibers are piling up behind it
+      wake_idle_worker(value);
     }
   }
 }
@@ -163,19 +371,89 @@ fiber_control::fiber* fiber_control::try_pop_queue(inplace_lf_queue2<fiber>& lfq
   return ret;
 }
 
+void fiber_control::unpop_queue(inplace_lf_queue2<fiber>& lfqueue,
+                                fiber*& popped_queue, fiber* fib) {
+  fib->next = popped_queue != NULL ? popped_queue : lfqueue.end_of_dequeue_list();
+  popped_queue = fib;
+}
+
 fiber_control::fiber* fiber_control::active_queue_remove(size_t workerid) {
   fiber_control::fiber* ret = NULL;
   thread_schedule& curts = schedule[workerid];
+  curts.queue_lock.lock();
   ret = try_pop_queue(*curts.priority_queue, curts.popped_priority_queue);
   if (ret == NULL) {
     ret = try_pop_queue(*curts.affinity_queue , curts.popped_affinity_queue);
   }
+  curts.queue_lock.unlock();
+  if (ret == NULL && work_stealing && nworkers > 1) {
+    ret = steal_fiber(workerid);
+  }
   if (ret) {
     // printf("%ld: Running %ld\n", get_worker_id(), ret->id);
   }
   return ret;
 }
 
+fiber_control::fiber* fiber_control::steal_fiber(size_t workerid) {
+  thread_schedule& curts = schedule[workerid];
+  size_t nvictims = nworkers - 1;
+  if (nvictims > MAX_STEAL_VICTIMS) nvictims = MAX_STEAL_VICTIMS;
+  for (size_t i = 0;i < nvictims; ++i) {
+    size_t victim = graphlab::random::fast_uniform<size_t>(0, nworkers - 2);
+    if (victim >= workerid) ++victim;
+    thread_schedule& ts = schedule[victim];
+    // cheap unlocked test first
+    bool has_affinity_fibers = ts.popped_affinity_queue != NULL ||
+                               !ts.affinity_queue->empty();
+    bool has_priority_fibers = ts.popped_priority_queue != NULL ||
+                               !ts.priority_queue->empty();
+    if (!has_affinity_fibers && !has_priority_fibers) continue;
+    if (!ts.queue_lock.try_lock()) continue;
+    // take regular fibers first. Priority fibers were just woken up and
+    // are best left to run where their data is warm.
+    inplace_lf_queue2<fiber>* queue = ts.affinity_queue;
+    fiber** popped = &ts.popped_affinity_queue;
+    fiber* ret = try_pop_queue(*queue, *popped);
+    if (ret == NULL) {
+      queue = ts.priority_queue;
+      popped = &ts.popped_priority_queue;
+      ret = try_pop_queue(*queue, *popped);
+    }
+    if (ret != NULL && ret->affinity.get(workerid) == 0) {
+      // not allowed to run here. Put it back where it was
+      unpop_queue(*queue, *popped, ret);
+      ret = NULL;
+    }
+    ts.queue_lock.unlock();
+    if (ret != NULL) {
+      ++curts.stats.steals;
+      return ret;
+    }
+  }
+  ++curts.stats.failed_steals;
+  return NULL;
+}
+
+void fiber_control::wake_idle_worker(fiber* fib) {
+  size_t start = graphlab::random::fast_uniform<size_t>(0, nworkers - 1);
+  for (size_t i = 0;i < nworkers; ++i) {
+    size_t w = (start + i) % nworkers;
+    if (schedule[w].waiting && fib->affinity.get(w)) {
+      schedule[w].active_lock.lock();
+      schedule[w].active_cond.signal();
+      schedule[w].active_lock.unlock();
+      return;
+    }
+  }
+}
+
+void fiber_control::reset_worker_stats() {
+  for (size_t i = 0;i < nworkers; ++i) {
+    schedule[i].stats = worker_stats();
+  }
+}
+
 void fiber_control::exit() {
   distributed_control* dc = distributed_control::get_instance();
   if (dc) dc->flush();
@@ -210,13 +488,31 @@ void fiber_control::worker_init(size_t workerid) {
   t->garbage = NULL;
   t->workerid = workerid;
   t->parent = this;
+  // the stack overflow handler cannot run on the overflowed fiber stack
+  const size_t signal_stack_size = 65536;
+  t->signal_stack = malloc(signal_stack_size);
+  stack_t ss;
+  memset(&ss, 0, sizeof(ss));
+  ss.ss_sp = t->signal_stack;
+  ss.ss_size = signal_stack_size;
+  ss.ss_flags = 0;
+  sigaltstack(&ss, NULL);
 
   schedule[workerid].waiting = true;
   schedule[workerid].active_lock.lock();
   while(!stop_workers) {
     // get a fiber to run
     fiber* next_fib = t->parent->active_queue_remove(workerid);
+    bool announced_idle = false;
+    if (next_fib == NULL && work_stealing) {
+      // announce that this worker is idle before looking once more, so
+      // that a worker queueing fibers after this point knows to wake us
+      idle_workers.inc();
+      announced_idle = true;
+      next_fib = t->parent->active_queue_remove(workerid);
+    }
     if (next_fib != NULL) {
+      if (announced_idle) idle_workers.dec();
       // if there is a fiber. yield to it
       schedule[workerid].active_lock.unlock();
       schedule[workerid].waiting = false;
@@ -233,16 +529,14 @@ void fiber_control::worker_init(size_t workerid) {
       schedule[workerid].active_lock.lock();
     } else {
       // if there is no fiber. wait.
+      ++schedule[workerid].stats.idle_waits;
       schedule[workerid].active_cond.wait(schedule[workerid].active_lock);
+      if (announced_idle) idle_workers.dec();
     }
   }
   schedule[workerid].active_lock.unlock();
 }
 
-struct trampoline_args {
-  boost::function<void(void)> fn;
-};
-
 // the trampoline to call the user function. This function never returns
 void fiber_control::trampoline(intptr_t _args) {
   // we may have launched to here by switching in from another fiber.
@@ -251,12 +545,13 @@ void fiber_control::trampoline(intptr_t _args) {
   if (t->prev_fiber) t->parent->reschedule_fiber(t->workerid, t->prev_fiber);
   t->prev_fiber = NULL;
 
-  trampoline_args* args = reinterpret_cast<trampoline_args*>(_args);
+  fiber* fib = reinterpret_cast<fiber*>(_args);
   try {
-    args->fn();
+    fib->fn();
   } catch (...) {
   }
-  delete args;
+  // release whatever the function holds before the fiber is pooled
+  fib->fn.clear();
   fiber_control::exit();
 }
 
@@ -269,11 +564,10 @@ size_t fiber_control::launch(boost::function<void(void)> fn,
   // make sure there is always a worker I can work on
   ASSERT_LT(b, nworkers);
 
-  // allocate a stack
-  fiber* fib = new fiber;
-  fib->parent = this;
-  fib->stack = malloc(stacksize);
+  // get a fiber and a stack, preferably a recycled one
+  fiber* fib = allocate_fiber(stacksize);
   fib->id = fiber_id_counter.inc();
+  fib->affinity_array.clear();
   foreach(size_t b, affinity) {
     if (b < nworkers) fib->affinity_array.push_back((unsigned char)b);
     else break;
@@ -287,13 +581,13 @@ size_t fiber_control::launch(boost::function<void(void)> fn,
   fib->terminate = false;
   fib->descheduled = false;
   fib->scheduleable = true;
+  fib->priority = false;
   // construct the initial context
-  trampoline_args* args = new trampoline_args;
-  args->fn = fn;
-  fib->initial_trampoline_args = (intptr_t)(args);
+  fib->fn.swap(fn);
+  fib->initial_trampoline_args = (intptr_t)(fib);
   // stack grows downwards.
-  fib->context = boost::context::make_fcontext((char*)fib->stack + stacksize,
-                                               stacksize,
+  fib->context = boost::context::make_fcontext((char*)fib->stack + fib->stacksize,
+                                               fib->stacksize,
                                                trampoline);
   fibers_active.inc();
 
@@ -403,12 +697,12 @@ void fiber_control::reschedule_fiber(size_t workerid, fiber* fib) {
     fib->lock.unlock();
   } else if (fib->terminate) {
     fib->lock.unlock();
-    // previous fiber is dead. destroy it
-    free(fib->stack);
+    // previous fiber is dead. Keep it and its stack for another launch
     //VALGRIND_STACK_DEREGISTER(fib->stack);
     // delete the fiber local storage if any
     if (fib->fls && flsdeleter) flsdeleter(fib->fls);
-    delete fib;
+    fib->fls = NULL;
+    recycle_fiber(workerid, fib);
     // if we are out of threads, signal the join
     if (fibers_active.dec() == 0) {
       join_lock.lock();
@@ -25,7 +25,9 @@
 #define GRAPHLAB_FIBER_CONTROL_HPP
 
 #include <stdint.h>
+#include <signal.h>
 #include <cstdlib>
+#include <vector>
 #include <boost/context/all.hpp>
 #include <boost/function.hpp>
 #include <boost/lockfree/queue.hpp>
@@ -48,7 +50,11 @@ class fiber_control {
     simple_spinlock lock;
     fiber_control* parent;
     boost::context::fcontext_t* context;
-    void* stack;
+    void* stack;        // lowest usable address of the stack
+    size_t stacksize;   // usable stack size. Always a multiple of the page size
+    void* stack_mapping; // the mmap'd region. Begins with the guard page.
+                         // NULL if the stack was malloc'd instead
+    boost::function<void (void)> fn; // the function to run
     size_t id;
     affinity_type affinity;
     std::vector<unsigned char> affinity_array;
@@ -75,6 +81,33 @@ class fiber_control {
                     // will cause it to be placed at the head of the queue
   };
 
+  /**
+   * Scheduling counters of one worker. See get_worker_stats().
+   */
+  struct worker_stats {
+    size_t steals;        // fibers taken from another worker's queue
+    size_t failed_steals; // steal rounds which found nothing to take
+    size_t idle_waits;    // number of times the worker went to sleep
+    worker_stats(): steals(0), failed_steals(0), idle_waits(0) { }
+  };
+
+  /**
+   * Counters of the fiber stack pools. See get_stack_pool_stats().
+   */
+  struct stack_pool_stats {
+    size_t reused_launches;    // launches which took a pooled fiber and stack
+    size_t allocated_launches; // launches which had to map a new stack
+    size_t pooled_fibers;      // idle fibers currently held by the pools
+    size_t mapped_stacks;      // stacks currently mapped, in use or pooled
+    size_t mapped_bytes;       // address space reserved by the mapped stacks,
+                               // including guard pages. Only the pages a
+                               // fiber actually touched are resident.
+    size_t unguarded_stacks;   // malloc'd stacks currently allocated
+    stack_pool_stats(): reused_launches(0), allocated_launches(0),
+                        pooled_fibers(0), mapped_stacks(0), mapped_bytes(0),
+                        unguarded_stacks(0) { }
+  };
+
 
  private:
   size_t nworkers;
@@ -82,6 +115,16 @@ class fiber_control {
   atomic<size_t> fiber_id_counter;
   atomic<size_t> fibers_active;
   atomic<size_t> active_workers;
+  atomic<size_t> idle_workers;
+  bool work_stealing;
+  size_t max_pooled_fibers;
+  // Every guarded stack costs two kernel memory map entries, of which a
+  // process has a limited number (vm.max_map_count). Past this many,
+  // stacks are malloc'd without a guard page.
+  size_t max_mapped_stacks;
+  atomic<size_t> mapped_stacks;
+  atomic<size_t> mapped_bytes;
+  atomic<size_t> unguarded_stacks;
   mutex join_lock;
   conditional join_cond;
 
@@ -100,9 +143,28 @@ class fiber_control {
 
     inplace_lf_queue2<fiber>* priority_queue;
     fiber* popped_priority_queue;
+
+    // Held while dequeueing. The lock-free queues allow a single consumer,
+    // which is either the owner or a worker stealing from it.
+    simple_spinlock queue_lock;
+    worker_stats stats; // only modified by the owning worker
+
+    // Terminated fibers kept with their stacks for reuse by launch().
+    // Filled by the owning worker. Launches from outside the workers may
+    // take from any pool, hence the lock.
+    simple_spinlock pool_lock;
+    std::vector<fiber*> fiber_pool;
+    size_t reused_launches;
+    size_t allocated_launches;
   };
   std::vector<thread_schedule> schedule;
 
+  /// Default bound on the number of idle fibers pooled by each worker
+  static const size_t DEFAULT_MAX_POOLED_FIBERS = 1024;
+
+  /// Number of random workers an idle worker tries to steal from
+  static const size_t MAX_STEAL_VICTIMS = 4;
+
   thread_group workers;
 
 
@@ -111,6 +173,23 @@ class fiber_control {
   void active_queue_insert_tail(size_t workerid, fiber* value);
   void active_queue_insert_tail(fiber* value);
   fiber* active_queue_remove(size_t workerid);
+  /// Takes one fiber which may run on workerid from another worker's queue
+  fiber* steal_fiber(size_t workerid);
+  /// Wakes a sleeping worker which may run fib, so that it can steal it
+  void wake_idle_worker(fiber* fib);
+  /// Pushes a fiber back at the head of a popped list
+  static void unpop_queue(inplace_lf_queue2<fiber>& lfqueue,
+                          fiber*& popped_queue, fiber* fib);
+
+  /// Returns a fiber with a stack of at least stacksize bytes
+  fiber* allocate_fiber(size_t stacksize);
+  /// Returns a terminated fiber to the pool of workerid, or unmaps it
+  void recycle_fiber(size_t workerid, fiber* fib);
+  /// Unmaps the stack of a fiber and deletes it
+  void destroy_fiber(fiber* fib);
+  /// Installs the handler reporting fiber stack overflows. Idempotent
+  static void install_overflow_handler();
+  static void overflow_handler(int sig, siginfo_t* info, void* context);
 
   // a thread local storage for the worker to point to a fiber
   static bool tls_created;
@@ -121,6 +200,7 @@ class fiber_control {
     fiber* garbage; // A fiber to delete after the context switch
     size_t workerid;
     boost::context::fcontext_t base_context;
+    void* signal_stack; // alternate stack the overflow handler runs on
   };
 
   static pthread_key_t tlskey; // points to the tls structure above
@@ -158,6 +238,7 @@ class fiber_control {
 
   /** the basic launch function
    * Returns a fiber ID. IDs are not sequential.
+   * The stack size is rounded up to a multiple of the page size.
    * \note The ID is really a pointer to a fiber_control::fiber object.
    */
   size_t launch(boost::function<void (void)> fn, 
@@ -191,6 +272,43 @@ class fiber_control {
   inline size_t total_threads_created() {
     return fiber_id_counter.value;
   }
+  /**
+   * Enables or disables work stealing. When enabled (the default), a
+   * worker which runs out of fibers takes runnable fibers from the queue
+   * of up to MAX_STEAL_VICTIMS randomly chosen workers, honoring the
+   * affinity of each fiber.
+   */
+  void set_work_stealing(bool enable) {
+    work_stealing = enable;
+  }
+
+  /**
+   * Returns the scheduling counters of a worker. The values are read
+   * without synchronization and are only approximate while workers run.
+   */
+  worker_stats get_worker_stats(size_t workerid) const {
+    return schedule[workerid].stats;
+  }
+
+  /// Zeroes the scheduling counters of all workers
+  void reset_worker_stats();
+
+  /**
+   * Sets the number of terminated fibers each worker keeps for reuse.
+   * Fiber stacks are mmap'd with a guard page below them, so that a stack
+   * overflow faults immediately (and is reported as such) instead of
+   * corrupting the heap. (Except when so many fibers are alive at once
+   * that the process would run out of memory maps, in which case the
+   * extra stacks come from malloc.) Pooled stacks stay mapped and keep the pages
+   * their last fiber touched, so the steady state memory use is bounded
+   * by nworkers * n times the deepest stack use. Setting 0 unmaps every
+   * stack on fiber exit. Defaults to DEFAULT_MAX_POOLED_FIBERS.
+   */
+  void set_max_pooled_fibers(size_t n);
+
+  /// Returns the stack pool counters summed over all workers. Approximate
+  stack_pool_stats get_stack_pool_stats();
+
   /**
    * Sets the TLS deletion function. The deletion function will be called
    * on every non-NULL TLS value.
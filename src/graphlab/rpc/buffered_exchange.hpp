@@ -29,6 +29,7 @@
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/dc_dist_object.hpp>
 #include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/serialization/serialized_size.hpp>
 
 
 #include <graphlab/macros_def.hpp>
@@ -155,7 +156,13 @@ namespace graphlab {
       ASSERT_LT(index, send_locks.size());
       send_locks[index].lock();
 
-      (*(send_buffers[index].oarc)) << value;
+      oarchive& oarc = *(send_buffers[index].oarc);
+      // size the buffer once on first use rather than growing it
+      // by repeated reallocation up to max_buffer_size
+      if (send_buffers[index].numinserts == 0) {
+        oarc.reserve(max_buffer_size + serialized_size<T>::get(value));
+      }
+      write_value(oarc, value);
       ++send_buffers[index].numinserts;
 
       if(send_buffers[index].oarc->off >= max_buffer_size) {
@@ -275,6 +282,17 @@ namespace graphlab {
 
     void barrier() { rpc.barrier(); }
   private:
+    /**
+     * Trivially serializable values are written as raw bytes so that
+     * rpc_recv can copy a whole buffer of them with one memcpy.
+     */
+    static const bool value_is_raw = gl_is_trivially_serializable<T>::value;
+
+    static void write_value(oarchive& oarc, const T& value) {
+      if (value_is_raw) oarc.write(reinterpret_cast<const char*>(&value), sizeof(T));
+      else oarc << value;
+    }
+
     void rpc_recv(size_t len, wild_pointer w) {
       buffer_type tmp;
       iarchive iarc(reinterpret_cast<const char*>(w.ptr), len);
@@ -289,8 +307,13 @@ namespace graphlab {
       numel_iarc.read(reinterpret_cast<char*>(&numel), sizeof(size_t));
       //std::cout << "Receiving: " << numel << "\n";
       tmp.resize(numel);
-      for (size_t i = 0;i < numel; ++i) {
-        iarc >> tmp[i];
+      if (value_is_raw) {
+        // the values were written back to back by write_value
+        if (numel > 0) iarc.read(reinterpret_cast<char*>(&(tmp[0])), numel * sizeof(T));
+      } else {
+        for (size_t i = 0;i < numel; ++i) {
+          iarc >> tmp[i];
+        }
       }
 
       recv_lock.lock();
@@ -39,6 +39,7 @@
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/util/synchronized_unordered_map.hpp>
+#include <graphlab/util/sharded_hopscotch_map.hpp>
 #include <graphlab/util/dense_bitset.hpp>
 
 namespace graphlab {
@@ -73,7 +74,10 @@ namespace graphlab {
    * \ingroup rpc
    This implements a limited distributed key -> value map with caching capabilities
    It is up to the user to determine cache invalidation policies. User explicitly
-   calls the invalidate() function to clear local cache entries
+   calls the invalidate() function to clear local cache entries.
+   The table data is held in a sharded_hopscotch_map so that local accesses
+   only contend on the same shard. multi_get() and multi_set() send one
+   message per owning machine.
   */
   template<typename KeyType, typename ValueType>
   class caching_dht{
@@ -81,7 +85,7 @@ namespace graphlab {
 
     typedef dc_impl::lru_list<KeyType, ValueType> lru_entry_type;
     /// datatype of the data map
-    typedef boost::unordered_map<KeyType, ValueType> map_type;
+    typedef sharded_hopscotch_map<KeyType, ValueType> map_type;
     /// datatype of the local cache map
     typedef boost::unordered_map<KeyType, lru_entry_type* > cache_type;
 
@@ -98,7 +102,6 @@ namespace graphlab {
   private:
     mutable dc_dist_object<caching_dht<KeyType, ValueType> > rpc;
   
-    mutex datalock;
     map_type data;  /// The actual table data that is distributed
  
     mutex cachelock; /// lock for the cache datastructures
@@ -118,7 +121,7 @@ namespace graphlab {
 
     /// Constructor. Creates the integer map.
     caching_dht(distributed_control &dc, 
-                size_t max_cache_size = 1024):rpc(dc, this),data(11) {
+                size_t max_cache_size = 1024):rpc(dc, this) {
       cache.rehash(max_cache_size);
       maxcache = max_cache_size;
       logger(LOG_INFO, "%d Creating distributed_hash_table. Cache Limit = %d", 
@@ -144,9 +147,7 @@ namespace graphlab {
       size_t hashvalue = hasher(key);
       size_t owningmachine = hashvalue % rpc.dc().numprocs();
       if (owningmachine == rpc.dc().procid()) {
-        datalock.lock();
-        data[key] = newval;
-        datalock.unlock();
+        data.set(key, newval);
       } else {
         rpc.remote_call(owningmachine, 
                         &caching_dht<KeyType,ValueType>::set, 
@@ -166,15 +167,7 @@ namespace graphlab {
       std::pair<bool, ValueType> ret;
       // if I own the key, get it from the map table
       if (owningmachine == rpc.dc().procid()) {
-        datalock.lock();
-        typename map_type::const_iterator iter = data.find(key);    
-        if (iter == data.end()) {
-          ret.first = false;
-        } else {
-          ret.first = true;
-          ret.second = iter->second;
-        }
-        datalock.unlock();
+        ret = data.get(key);
       } else {
         ret = rpc.remote_request(owningmachine, 
                                  &caching_dht<KeyType,ValueType>::get, 
@@ -218,6 +211,73 @@ namespace graphlab {
       }
     }
 
+    /**
+     * Gets the values associated with a collection of keys, sending one
+     * request to each machine which owns any of the keys, and updating
+     * the cache with the results. Returns, for each key in order,
+     * (true, Value) on success and (false, undefined) otherwise.
+     */
+    std::vector<std::pair<bool, ValueType> >
+    multi_get(const std::vector<KeyType>& keys) const {
+      std::vector<std::pair<bool, ValueType> > ret(keys.size());
+      std::vector<std::vector<KeyType> > batches(rpc.dc().numprocs());
+      std::vector<std::vector<size_t> > positions(rpc.dc().numprocs());
+      for (size_t i = 0; i < keys.size(); ++i) {
+        size_t owningmachine = hasher(keys[i]) % rpc.dc().numprocs();
+        if (owningmachine == rpc.dc().procid()) {
+          ret[i] = data.get(keys[i]);
+        } else {
+          batches[owningmachine].push_back(keys[i]);
+          positions[owningmachine].push_back(i);
+        }
+      }
+      std::vector<request_future<std::vector<std::pair<bool, ValueType> > > >
+          futures(rpc.dc().numprocs());
+      for (procid_t p = 0; p < rpc.dc().numprocs(); ++p) {
+        if (batches[p].empty()) continue;
+        futures[p] = rpc.future_remote_request(p,
+                              &caching_dht<KeyType,ValueType>::local_multi_get,
+                              batches[p]);
+        dc_impl::pull_flush_soon_thread_local_buffer(p);
+      }
+      for (procid_t p = 0; p < rpc.dc().numprocs(); ++p) {
+        if (batches[p].empty()) continue;
+        std::vector<std::pair<bool, ValueType> >& reply = futures[p]();
+        for (size_t j = 0; j < reply.size(); ++j) {
+          ret[positions[p][j]] = reply[j];
+          if (reply[j].first) update_cache(batches[p][j], reply[j].second);
+          else invalidate(batches[p][j]);
+        }
+      }
+      return ret;
+    }
+
+    /**
+     * Sets values[i] to be the value associated with keys[i], sending one
+     * message to each machine which owns any of the keys.
+     */
+    void multi_set(const std::vector<KeyType>& keys,
+                   const std::vector<ValueType>& values) {
+      ASSERT_EQ(keys.size(), values.size());
+      std::vector<std::vector<KeyType> > keybatches(rpc.dc().numprocs());
+      std::vector<std::vector<ValueType> > valbatches(rpc.dc().numprocs());
+      for (size_t i = 0; i < keys.size(); ++i) {
+        size_t owningmachine = hasher(keys[i]) % rpc.dc().numprocs();
+        if (owningmachine == rpc.dc().procid()) {
+          data.set(keys[i], values[i]);
+        } else {
+          keybatches[owningmachine].push_back(keys[i]);
+          valbatches[owningmachine].push_back(values[i]);
+          update_cache(keys[i], values[i]);
+        }
+      }
+      for (procid_t p = 0; p < rpc.dc().numprocs(); ++p) {
+        if (keybatches[p].empty()) continue;
+        rpc.remote_call(p, &caching_dht<KeyType,ValueType>::local_multi_set,
+                        keybatches[p], valbatches[p]);
+      }
+    }
+
     /// Invalidates the cache entry associated with this key
     void invalidate(const KeyType &key) const{
       cachelock.lock();
@@ -249,7 +309,17 @@ namespace graphlab {
 
   private:
 
-  
+    std::vector<std::pair<bool, ValueType> >
+    local_multi_get(const std::vector<KeyType>& keys) const {
+      std::vector<std::pair<bool, ValueType> > ret(keys.size());
+      for (size_t i = 0; i < keys.size(); ++i) ret[i] = data.get(keys[i]);
+      return ret;
+    }
+
+    void local_multi_set(const std::vector<KeyType>& keys,
+                         const std::vector<ValueType>& values) {
+      for (size_t i = 0; i < keys.size(); ++i) data.set(keys[i], values[i]);
+    }
 
     /// Updates the cache with this new value
     void update_cache(const KeyType &key, const ValueType &val) const{
@@ -47,6 +47,7 @@
 #include <graphlab/rpc/dc_stream_receive.hpp>
 #include <graphlab/rpc/request_reply_handler.hpp>
 #include <graphlab/rpc/dc_services.hpp>
+#include <graphlab/rpc/received_buffer.hpp>
 
 #include <graphlab/rpc/dc_init_from_env.hpp>
 #include <graphlab/rpc/dc_init_from_mpi.hpp>
@@ -305,6 +306,8 @@ void distributed_control::process_fcall_block(fcallqueue_entry &fcallblock) {
     //parse the data in fcallblock.data
     char* data = fcallblock.chunk_src;
     size_t remaininglen = fcallblock.chunk_len;
+    // calls may keep parts of the chunk alive with a received_buffer
+    dc_impl::receive_chunk chunk = {fcallblock.chunk_src, fcallblock.chunk_len, NULL};
     //PERMANENT_ACCUMULATE_DIST_EVENT(eventlog, BYTES_EVENT, remaininglen);
     while(remaininglen > 0) {
       ASSERT_GE(remaininglen, sizeof(dc_impl::packet_hdr));
@@ -315,13 +318,15 @@ void distributed_control::process_fcall_block(fcallqueue_entry &fcallblock) {
         global_bytes_received[hdr.src].inc(hdr.len);
       }
 
+      dc_impl::set_current_receive_chunk(&chunk);
       exec_function_call(fcallblock.source, hdr.packet_type_mask,
                          data + sizeof(dc_impl::packet_hdr),
                          hdr.len);
+      dc_impl::set_current_receive_chunk(NULL);
       data += sizeof(dc_impl::packet_hdr) + hdr.len;
       remaininglen -= sizeof(dc_impl::packet_hdr) + hdr.len;
     }
-    free(fcallblock.chunk_src);
+    dc_impl::release_receive_chunk(chunk);
   }
 #else
   else {
@@ -180,6 +180,8 @@ namespace dc_impl {
  * \li distributed_control::broadcast()
  * \li distributed_control::all_reduce()
  * \li distributed_control::all_reduce2()
+ * \li distributed_control::all_reduce_dense()
+ * \li distributed_control::all_reduce_array()
  * \li distributed_control::gather()
  * \li distributed_control::all_gather()
  *
@@ -1298,6 +1300,59 @@ class distributed_control{
   template <typename U, typename PlusEqual>
   inline void all_reduce2(U& data, PlusEqual plusequal, bool control = false);
 
+  /**
+   * \brief Sums a dense numeric value elementwise over all machines,
+   * making the result available to all machines.
+   *
+   * This is equivalent to all_reduce() for types whose operator+= is an
+   * elementwise sum over a contiguous array of arithmetic values, as
+   * described by graphlab::dense_reduction_traits. A std::vector of an
+   * arithmetic type or of graphlab::atomic is summed elementwise when
+   * passed here directly, but only types which opt in through
+   * dense_reduction_traits are reduced this way by the aggregators.
+   * Instead of serializing the whole object, the array is summed in
+   * place: small arrays by recursive doubling, and large arrays by a
+   * chunked and pipelined ring reduce scatter followed by a ring all
+   * gather, so the traffic on each link does not grow with the number
+   * of machines.
+   *
+   * Vectors may have different lengths on different machines. Missing
+   * trailing entries are treated as zero.
+   *
+   * Example:
+   * \code
+   * std::vector<double> counts(ntopics, 0);
+   * ... count locally ...
+   * dc.all_reduce_dense(counts);
+   * // counts now contains the sum over all machines
+   * \endcode
+   *
+   * \param data  A dense value to sum over.
+   * \param control Optional parameter. Defaults to false. If set to true,
+   *                this will marked as control plane communication and will
+   *                not register in bytes_received() or bytes_sent(). This must
+   *                be the same on all machines.
+   */
+  template <typename U>
+  inline void all_reduce_dense(U& data, bool control = false);
+
+  /**
+   * \brief Sums an array of arithmetic values elementwise over all
+   * machines, making the result available to all machines.
+   *
+   * This is the array form of all_reduce_dense(). len must be the same
+   * on all machines.
+   *
+   * \param data  Pointer to the first element of the array
+   * \param len   Number of elements in the array
+   * \param control Optional parameter. Defaults to false. If set to true,
+   *                this will marked as control plane communication and will
+   *                not register in bytes_received() or bytes_sent(). This must
+   *                be the same on all machines.
+   */
+  template <typename V>
+  inline void all_reduce_array(V* data, size_t len, bool control = false);
+
 
    /**
     \brief A distributed barrier which waits for all machines to call the
@@ -1448,6 +1503,16 @@ inline void distributed_control::all_reduce2(U& data, PlusEqual plusequal, bool
   distributed_services->all_reduce2(data, plusequal, control);
 }
 
+template <typename U>
+inline void distributed_control::all_reduce_dense(U& data, bool control) {
+  distributed_services->all_reduce_dense(data, control);
+}
+
+template <typename V>
+inline void distributed_control::all_reduce_array(V* data, size_t len, bool control) {
+  distributed_services->all_reduce_array(data, len, control);
+}
+
 
 
 
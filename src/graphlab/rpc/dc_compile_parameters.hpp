@@ -145,5 +145,36 @@
  */
 #define DEFAULT_BUFFERED_EXCHANGE_SIZE FULL_BUFFER_SIZE_LIMIT
 
+/**************************************************************************/
+/*                                                                        */
+/*                          Collective Selection                          */
+/*                                                                        */
+/**************************************************************************/
+
+/**
+ * \ingroup rpc
+ * \def RPC_COLLECTIVE_FLAT_MAX_PROCS
+ * With at most this many machines, the collectives use the original
+ * flat fan-in / fan-out tree, which is already only 2 hops deep.
+ */
+#define RPC_COLLECTIVE_FLAT_MAX_PROCS 4
+
+/**
+ * \ingroup rpc
+ * \def RPC_COLLECTIVE_SMALL_PAYLOAD
+ * Collectives whose largest serialized per-machine payload is at most
+ * this many bytes use the latency optimal recursive doubling algorithms.
+ * Larger payloads use the bandwidth optimal ring / pipelined algorithms.
+ */
+#define RPC_COLLECTIVE_SMALL_PAYLOAD 8192
+
+/**
+ * \ingroup rpc
+ * \def RPC_COLLECTIVE_CHUNK_SIZE
+ * Large broadcasts are forwarded down the broadcast tree in pieces of
+ * this many bytes so that all levels of the tree transmit concurrently.
+ */
+#define RPC_COLLECTIVE_CHUNK_SIZE 65536
+
 
 #endif
@@ -28,6 +28,10 @@
 #include <vector>
 #include <string>
 #include <set>
+#include <map>
+#include <cstring>
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_arithmetic.hpp>
 #include <graphlab/parallel/atomic.hpp>
 #include <graphlab/parallel/fiber_conditional.hpp>
 #include <graphlab/rpc/dc_internal_types.hpp>
@@ -38,6 +42,7 @@
 #include <graphlab/rpc/function_ret_type.hpp>
 #include <graphlab/rpc/mem_function_arg_types_def.hpp>
 #include <graphlab/util/charstream.hpp>
+#include <graphlab/util/generics/dense_reduction_traits.hpp>
 #include <boost/preprocessor.hpp>
 #include <graphlab/util/tracepoint.hpp>
 #include <graphlab/rpc/request_reply_handler.hpp>
@@ -236,6 +241,10 @@ class dc_dist_object : public dc_impl::dc_dist_object_base{
     ab_barrier_release = -1;
 
 
+    //-------- Initialize the scalable collectives --------
+    coll_seq = 0;
+    coll_algorithm = COLLECTIVE_AUTO;
+
     //-------- Initialize the full barrier ---------
 
     full_barrier_in_effect = false;
@@ -513,6 +522,8 @@ class dc_dist_object : public dc_impl::dc_dist_object_base{
 
   BOOST_PP_REPEAT(6, RPC_INTERFACE_GENERATOR, (internal_call,dc_impl::object_call_issue, STANDARD_CALL) )
   BOOST_PP_REPEAT(6, RPC_INTERFACE_GENERATOR, (internal_control_call,dc_impl::object_call_issue, (STANDARD_CALL | CONTROL_PACKET)) )
+  BOOST_PP_REPEAT(6, RPC_INTERFACE_GENERATOR, (internal_flush_call,dc_impl::object_call_issue, (STANDARD_CALL | FLUSH_PACKET)) )
+  BOOST_PP_REPEAT(6, RPC_INTERFACE_GENERATOR, (internal_control_flush_call,dc_impl::object_call_issue, (STANDARD_CALL | CONTROL_PACKET | FLUSH_PACKET)) )
 
 
   #define REQUEST_INTERFACE_GENERATOR(Z,N,ARGS) \
@@ -876,6 +887,31 @@ private:
   /// \copydoc distributed_control::broadcast()
   template <typename U>
   void broadcast(U& data, bool originator, bool control = false) {
+    if (numprocs() == 1) return;
+    if (coll_algorithm == COLLECTIVE_FLAT_TREE ||
+        (coll_algorithm == COLLECTIVE_AUTO &&
+         numprocs() <= RPC_COLLECTIVE_FLAT_MAX_PROCS)) {
+      flat_broadcast(data, originator, control);
+      return;
+    }
+    size_t seq = coll_seq++;
+    if (originator) {
+      coll_tree_broadcast(seq, procid(), coll_serialize(data), control);
+    } else {
+      coll_deserialize(coll_receive_broadcast(seq), data);
+    }
+    // preserve the barrier-like behavior of the flat broadcast
+    barrier();
+  }
+
+ private:
+
+  /**
+   * The original broadcast: the originator sends the serialized object
+   * directly to every other machine.
+   */
+  template <typename U>
+  void flat_broadcast(U& data, bool originator, bool control) {
     if (originator) {
       // construct the data stream
       std::stringstream strm;
@@ -1050,7 +1086,49 @@ private:
   /// \copydoc distributed_control::all_gather()
   template <typename U>
   void all_gather(std::vector<U>& data, bool control = false) {
+    all_gather_impl(data, control, 0);
+  }
+
+ private:
+
+  /**
+   * Dispatches all_gather to one of the collective algorithms.
+   * payload_hint, if non-zero, must be the same on all machines and is
+   * used in place of negotiating the largest serialized payload size.
+   */
+  template <typename U>
+  void all_gather_impl(std::vector<U>& data, bool control,
+                       size_t payload_hint) {
     if (numprocs() == 1) return;
+    std::string mydata;
+    size_t payload = payload_hint;
+    if (coll_algorithm == COLLECTIVE_AUTO &&
+        numprocs() > RPC_COLLECTIVE_FLAT_MAX_PROCS && payload == 0) {
+      mydata = coll_serialize(data[procid()]);
+      payload = coll_agree_payload<U>(mydata.length(), control);
+    }
+    dc_collective_type alg = choose_collective(payload);
+    if (alg == COLLECTIVE_FLAT_TREE) {
+      tree_all_gather(data, control);
+      return;
+    }
+    if (mydata.empty()) mydata = coll_serialize(data[procid()]);
+    std::vector<std::string> blocks;
+    if (alg == COLLECTIVE_RECURSIVE_DOUBLING) {
+      coll_bruck_all_gather(mydata, blocks, control);
+    } else {
+      coll_ring_all_gather(mydata, blocks, control);
+    }
+    for (procid_t i = 0; i < numprocs(); ++i) {
+      if (i != procid()) coll_deserialize(blocks[i], data[i]);
+    }
+  }
+
+  /**
+   * The original all_gather over the BARRIER_BRANCH_FACTOR-ary tree.
+   */
+  template <typename U>
+  void tree_all_gather(std::vector<U>& data, bool control) {
     // get the string representation of the data
     charstream strm(128);
     oarchive oarc(strm);
@@ -1179,10 +1257,11 @@ private:
     }
   }
 
-  /// \copydoc distributed_control::all_reduce2()
+  /**
+   * The original all_reduce2 over the BARRIER_BRANCH_FACTOR-ary tree.
+   */
   template <typename U, typename PlusEqual>
-  void all_reduce2(U& data, PlusEqual plusequal, bool control = false) {
-    if (numprocs() == 1) return;
+  void tree_all_reduce2(U& data, PlusEqual plusequal, bool control) {
     // get the string representation of the data
    /* charstream strm(128);
     oarchive oarc(strm);
@@ -1283,6 +1362,8 @@ private:
   }
 
 
+ public:
+
   template <typename U>
   struct default_plus_equal {
     void operator()(U& u, const U& v) {
@@ -1290,12 +1371,565 @@ private:
     }
   };
 
+  /// \copydoc distributed_control::all_reduce2()
+  template <typename U, typename PlusEqual>
+  void all_reduce2(U& data, PlusEqual plusequal, bool control = false) {
+    if (numprocs() == 1) return;
+    size_t payload = 0;
+    if (coll_algorithm == COLLECTIVE_AUTO &&
+        numprocs() > RPC_COLLECTIVE_FLAT_MAX_PROCS) {
+      payload = coll_agree_payload<U>(coll_serialize(data).length(), control);
+    }
+    switch(choose_collective(payload)) {
+     case COLLECTIVE_RECURSIVE_DOUBLING:
+      coll_rd_all_reduce2(data, plusequal, control);
+      break;
+     case COLLECTIVE_RING:
+      coll_pipelined_all_reduce2(data, plusequal, control);
+      break;
+     default:
+      tree_all_reduce2(data, plusequal, control);
+    }
+  }
+
   /// \copydoc distributed_control::all_reduce()
   template <typename U>
   void all_reduce(U& data, bool control = false) {
     all_reduce2(data, default_plus_equal<U>(), control);
   }
 
+  /// \copydoc distributed_control::all_reduce_array()
+  template <typename V>
+  void all_reduce_array(V* data, size_t len, bool control = false) {
+    BOOST_STATIC_ASSERT(boost::is_arithmetic<V>::value);
+    if (numprocs() == 1 || len == 0) return;
+    dc_collective_type alg = coll_algorithm;
+    if (alg != COLLECTIVE_RECURSIVE_DOUBLING && alg != COLLECTIVE_RING) {
+      // there is no flat tree for raw arrays
+      alg = len * sizeof(V) <= RPC_COLLECTIVE_SMALL_PAYLOAD ?
+              COLLECTIVE_RECURSIVE_DOUBLING : COLLECTIVE_RING;
+    }
+    // the ring needs at least one element per machine
+    if (alg == COLLECTIVE_RING && len >= numprocs()) {
+      coll_ring_all_reduce_array(data, len, control);
+    } else {
+      coll_rd_all_reduce_array(data, len, control);
+    }
+  }
+
+  /// \copydoc distributed_control::all_reduce_dense()
+  template <typename U>
+  void all_reduce_dense(U& data, bool control = false) {
+    all_reduce_dense_with<dense_reduction_traits<U> >(data, control);
+  }
+
+  /// \copydoc distributed_control::all_reduce_dense()
+  template <typename E>
+  void all_reduce_dense(std::vector<E>& data, bool control = false) {
+    all_reduce_dense_with<vector_dense_reduction_traits<E> >(data, control);
+  }
+
+ private:
+  template <typename Traits, typename U>
+  void all_reduce_dense_with(U& data, bool control) {
+    BOOST_STATIC_ASSERT(Traits::is_dense);
+    if (numprocs() == 1) return;
+    size_t len = Traits::size(data);
+    if (!Traits::is_fixed_size) {
+      // machines with an empty accumulator contribute zeros
+      coll_rd_all_reduce2(len, coll_max_equal<size_t>(), control);
+      if (len != Traits::size(data)) Traits::resize(data, len);
+    }
+    all_reduce_array(Traits::data(data), len, control);
+  }
+
+ public:
+  /**
+   * \brief Sets the algorithm family used by barrier(), broadcast(),
+   * all_gather() and all_reduce(). All machines must set the same value
+   * before the next collective. Defaults to COLLECTIVE_AUTO.
+   */
+  void set_collective_algorithm(dc_collective_type alg) {
+    coll_algorithm = alg;
+  }
+
+  /// Returns the algorithm family used by the collectives
+  dc_collective_type get_collective_algorithm() const {
+    return coll_algorithm;
+  }
+
+
+/*****************************************************************************
+           Implementation of the recursive doubling / ring collectives
+ *****************************************************************************/
+
+ private:
+  /**
+   * Messages exchanged by the collectives below are parked in a mailbox
+   * keyed by (collective sequence number, step, source). Since all
+   * machines issue collectives on an object in the same order, the
+   * sequence number identifies the collective, and a fast machine may
+   * run ahead into the next collective without confusing a slow one.
+   */
+  typedef std::pair<size_t, std::pair<size_t, procid_t> > coll_key_type;
+  std::map<coll_key_type, std::string> coll_mailbox;
+  /// number of chunks of each broadcast received so far
+  std::map<size_t, size_t> coll_bcast_numchunks;
+  mutex coll_mut;
+  fiber_conditional coll_cond;
+  /// sequence number of the next collective
+  size_t coll_seq;
+  dc_collective_type coll_algorithm;
+
+  /// Broadcast chunks are not associated with a known source
+  static procid_t coll_any_source() {
+    return (procid_t)(-1);
+  }
+
+  /// Step used to return the result to the folded out machines
+  static size_t coll_result_step() {
+    return (size_t)(-1);
+  }
+
+  template <typename U>
+  static std::string coll_serialize(const U& u) {
+    charstream strm(128);
+    oarchive oarc(strm);
+    oarc << u;
+    strm.flush();
+    return std::string(strm->c_str(), strm->size());
+  }
+
+  template <typename U>
+  static void coll_deserialize(const std::string& s, U& u) {
+    iarchive iarc(s.c_str(), s.length());
+    iarc >> u;
+  }
+
+  /**
+   * A message body. It is serialized like a std::string, but directly from
+   * the sender's memory, so raw arrays need not be copied into a string
+   * first. On the receiving side it owns the bytes.
+   */
+  struct coll_buffer {
+    const char* ptr;
+    size_t len;
+    std::string owned;
+    coll_buffer(): ptr(NULL), len(0) { }
+    coll_buffer(const char* ptr, size_t len): ptr(ptr), len(len) { }
+    void save(oarchive& oarc) const {
+      oarc << len;
+      oarc.write(ptr, len);
+    }
+    void load(iarchive& iarc) {
+      iarc >> len;
+      owned.resize(len);
+      iarc.read(&(owned[0]), len);
+      ptr = owned.c_str();
+    }
+  };
+
+  void __coll_deliver(size_t seq, size_t step, procid_t source,
+                      coll_buffer& buf) {
+    coll_mut.lock();
+    coll_mailbox[coll_key_type(seq, std::make_pair(step, source))].swap(buf.owned);
+    coll_cond.signal();
+    coll_mut.unlock();
+  }
+
+  void coll_send(procid_t target, size_t seq, size_t step,
+                 const char* c, size_t len, bool control) {
+    if (control) {
+      internal_control_flush_call(target, &dc_dist_object<T>::__coll_deliver,
+                                  seq, step, procid(), coll_buffer(c, len));
+    } else {
+      internal_flush_call(target, &dc_dist_object<T>::__coll_deliver,
+                          seq, step, procid(), coll_buffer(c, len));
+    }
+  }
+
+  void coll_send(procid_t target, size_t seq, size_t step,
+                 const std::string& s, bool control) {
+    coll_send(target, seq, step, s.c_str(), s.length(), control);
+  }
+
+  /// Blocks until the message (seq, step, source) arrives and returns it
+  std::string coll_recv(size_t seq, size_t step, procid_t source) {
+    coll_key_type key(seq, std::make_pair(step, source));
+    std::string ret;
+    coll_mut.lock();
+    while(1) {
+      typename std::map<coll_key_type, std::string>::iterator iter =
+          coll_mailbox.find(key);
+      if (iter != coll_mailbox.end()) {
+        ret.swap(iter->second);
+        coll_mailbox.erase(iter);
+        break;
+      }
+      coll_cond.wait(coll_mut);
+    }
+    coll_mut.unlock();
+    return ret;
+  }
+
+  dc_collective_type choose_collective(size_t payload) const {
+    if (coll_algorithm != COLLECTIVE_AUTO) return coll_algorithm;
+    else if (numprocs() <= RPC_COLLECTIVE_FLAT_MAX_PROCS) return COLLECTIVE_FLAT_TREE;
+    else if (payload <= RPC_COLLECTIVE_SMALL_PAYLOAD) return COLLECTIVE_RECURSIVE_DOUBLING;
+    else return COLLECTIVE_RING;
+  }
+
+  template <typename U>
+  struct coll_max_equal {
+    void operator()(U& u, const U& v) {
+      u = std::max(u, v);
+    }
+  };
+
+  /**
+   * Returns the largest payload over all machines so that every machine
+   * chooses the same algorithm. POD types have a fixed size and need no
+   * communication.
+   */
+  template <typename U>
+  size_t coll_agree_payload(size_t local_payload, bool control) {
+    if (gl_is_pod<U>::value) return sizeof(U);
+    coll_rd_all_reduce2(local_payload, coll_max_equal<size_t>(), control);
+    return local_payload;
+  }
+
+  /**
+   * Recursive doubling all reduce. Machines beyond the largest power of two
+   * first fold their data into a partner, and receive the result at the
+   * end. In each round, both partners combine (lower rank) += (higher rank)
+   * so that every machine ends up with a bitwise identical result.
+   */
+  template <typename U, typename PlusEqual>
+  void coll_rd_all_reduce2(U& data, PlusEqual plusequal, bool control) {
+    size_t seq = coll_seq++;
+    size_t p2 = 1;
+    while (p2 * 2 <= numprocs()) p2 *= 2;
+    size_t rem = numprocs() - p2;
+    if (procid() >= p2) {
+      coll_send(procid() - p2, seq, 0, coll_serialize(data), control);
+      coll_deserialize(coll_recv(seq, coll_result_step(), procid() - p2), data);
+      return;
+    }
+    if (procid() < rem) {
+      U tmp;
+      coll_deserialize(coll_recv(seq, 0, procid() + p2), tmp);
+      plusequal(data, tmp);
+    }
+    size_t step = 1;
+    for (size_t mask = 1; mask < p2; mask <<= 1, ++step) {
+      procid_t partner = (procid_t)(procid() ^ mask);
+      coll_send(partner, seq, step, coll_serialize(data), control);
+      U tmp;
+      coll_deserialize(coll_recv(seq, step, partner), tmp);
+      if (procid() < partner) {
+        plusequal(data, tmp);
+      } else {
+        plusequal(tmp, data);
+        data = tmp;
+      }
+    }
+    if (procid() < rem) {
+      coll_send(procid() + p2, seq, coll_result_step(),
+                coll_serialize(data), control);
+    }
+  }
+
+  /**
+   * Large payload all reduce. The data is reduced to machine 0 along a
+   * binomial tree, so every machine sends its payload exactly once, and
+   * the result is pipelined back down with coll_tree_broadcast.
+   */
+  template <typename U, typename PlusEqual>
+  void coll_pipelined_all_reduce2(U& data, PlusEqual plusequal, bool control) {
+    size_t seq = coll_seq++;
+    for (size_t mask = 1; mask < numprocs(); mask <<= 1) {
+      if (procid() & mask) {
+        coll_send(procid() - mask, seq, mask, coll_serialize(data), control);
+        break;
+      } else if (procid() + mask < numprocs()) {
+        U tmp;
+        coll_deserialize(coll_recv(seq, mask, procid() + mask), tmp);
+        plusequal(data, tmp);
+      }
+    }
+    size_t bseq = coll_seq++;
+    if (procid() == 0) {
+      coll_tree_broadcast(bseq, 0, coll_serialize(data), control);
+    } else {
+      coll_deserialize(coll_receive_broadcast(bseq), data);
+    }
+  }
+
+  /**
+   * dst[i] += src[i]. Kept as a plain loop over restrict qualified pointers
+   * so that the compiler vectorizes it.
+   */
+  template <typename V>
+  static void coll_dense_sum(V* __restrict__ dst, const V* __restrict__ src,
+                             size_t len) {
+    for (size_t i = 0; i < len; ++i) dst[i] += src[i];
+  }
+
+  template <typename V>
+  static const V* coll_array_of(const std::string& s) {
+    return reinterpret_cast<const V*>(s.c_str());
+  }
+
+  /**
+   * The schedule of coll_rd_all_reduce2() over a raw array. Both partners
+   * compute the same elementwise sums, so the results are bitwise identical.
+   */
+  template <typename V>
+  void coll_rd_all_reduce_array(V* data, size_t len, bool control) {
+    size_t seq = coll_seq++;
+    const size_t bytes = len * sizeof(V);
+    size_t p2 = 1;
+    while (p2 * 2 <= numprocs()) p2 *= 2;
+    size_t rem = numprocs() - p2;
+    if (procid() >= p2) {
+      coll_send(procid() - p2, seq, 0, (const char*)data, bytes, control);
+      std::string s = coll_recv(seq, coll_result_step(), procid() - p2);
+      memcpy(data, s.c_str(), bytes);
+      return;
+    }
+    if (procid() < rem) {
+      std::string s = coll_recv(seq, 0, procid() + p2);
+      coll_dense_sum(data, coll_array_of<V>(s), len);
+    }
+    size_t step = 1;
+    for (size_t mask = 1; mask < p2; mask <<= 1, ++step) {
+      procid_t partner = (procid_t)(procid() ^ mask);
+      coll_send(partner, seq, step, (const char*)data, bytes, control);
+      std::string s = coll_recv(seq, step, partner);
+      coll_dense_sum(data, coll_array_of<V>(s), len);
+    }
+    if (procid() < rem) {
+      coll_send(procid() + p2, seq, coll_result_step(),
+                (const char*)data, bytes, control);
+    }
+  }
+
+  /**
+   * Ring all reduce over a raw array: a reduce scatter followed by an all
+   * gather, each taking p - 1 stages. The array is cut into p segments and
+   * the segments into chunks of RPC_COLLECTIVE_CHUNK_SIZE bytes. In the
+   * reduce scatter, a machine adds each chunk it receives from the left to
+   * its own and forwards the sum to the right immediately, so the stages
+   * overlap. Every link carries 2(p - 1)/p of the array, regardless of p.
+   */
+  template <typename V>
+  void coll_ring_all_reduce_array(V* data, size_t len, bool control) {
+    size_t seq = coll_seq++;
+    const size_t p = numprocs();
+    procid_t right = (procid_t)((procid() + 1) % p);
+    procid_t left = (procid_t)((procid() + p - 1) % p);
+    const size_t chunklen = std::max<size_t>(1, RPC_COLLECTIVE_CHUNK_SIZE / sizeof(V));
+    // chunks in the largest segment. Message steps are
+    // stage * maxchunks + chunk
+    const size_t maxchunks = ((len + p - 1) / p + chunklen - 1) / chunklen;
+    // stage 0: send my own segment
+    size_t seg = procid();
+    size_t segbegin = seg * len / p, segend = (seg + 1) * len / p;
+    for (size_t c = 0; segbegin + c * chunklen < segend; ++c) {
+      size_t b = segbegin + c * chunklen;
+      size_t e = std::min(b + chunklen, segend);
+      coll_send(right, seq, maxchunks + c, (const char*)(data + b),
+                (e - b) * sizeof(V), control);
+    }
+    // reduce scatter stages 1 .. p-1 and all gather stages p .. 2p-2.
+    // In reduce scatter stage s, I receive segment procid() - s. After the
+    // last one I hold the sum of segment procid() + 1. In all gather stage
+    // p - 1 + t, I receive the summed segment procid() + 1 - t.
+    for (size_t stage = 1; stage <= 2 * p - 2; ++stage) {
+      bool reducing = stage < p;
+      seg = reducing ? (procid() + p - stage) % p
+                     : (procid() + 1 + p - (stage - p + 1)) % p;
+      segbegin = seg * len / p;
+      segend = (seg + 1) * len / p;
+      for (size_t c = 0; segbegin + c * chunklen < segend; ++c) {
+        size_t b = segbegin + c * chunklen;
+        size_t e = std::min(b + chunklen, segend);
+        std::string s = coll_recv(seq, stage * maxchunks + c, left);
+        if (reducing) coll_dense_sum(data + b, coll_array_of<V>(s), e - b);
+        else memcpy(data + b, s.c_str(), (e - b) * sizeof(V));
+        // forwarding the last reduce scatter stage starts the all gather
+        if (stage < 2 * p - 2) {
+          coll_send(right, seq, (stage + 1) * maxchunks + c,
+                    (const char*)(data + b), (e - b) * sizeof(V), control);
+        }
+      }
+    }
+  }
+
+  /**
+   * Bruck all gather: ceil(log2(p)) rounds. Each machine keeps the blocks
+   * of machines procid(), procid() + 1, ... in order, and in the round
+   * with distance d forwards its first min(d, p - d) blocks to machine
+   * procid() - d. On return blocks[i] is the payload of machine i.
+   */
+  void coll_bruck_all_gather(const std::string& mydata,
+                             std::vector<std::string>& blocks,
+                             bool control) {
+    size_t seq = coll_seq++;
+    const size_t p = numprocs();
+    std::vector<std::string> held(1, mydata);
+    size_t step = 0;
+    for (size_t dist = 1; dist < p; dist <<= 1, ++step) {
+      size_t count = std::min(dist, p - dist);
+      std::vector<std::string> out(held.begin(), held.begin() + count);
+      coll_send((procid_t)((procid() + p - dist) % p), seq, step,
+                coll_serialize(out), control);
+      std::vector<std::string> in;
+      coll_deserialize(coll_recv(seq, step, (procid_t)((procid() + dist) % p)),
+                       in);
+      ASSERT_EQ(in.size(), count);
+      for (size_t i = 0; i < in.size(); ++i) {
+        held.push_back(std::string());
+        held.back().swap(in[i]);
+      }
+    }
+    blocks.resize(p);
+    for (size_t i = 0; i < p; ++i) blocks[(procid() + i) % p].swap(held[i]);
+  }
+
+  /**
+   * Ring all gather: p - 1 steps, each passing one block to the right
+   * neighbor. Every link carries exactly (p - 1) payloads.
+   */
+  void coll_ring_all_gather(const std::string& mydata,
+                            std::vector<std::string>& blocks,
+                            bool control) {
+    size_t seq = coll_seq++;
+    const size_t p = numprocs();
+    procid_t right = (procid_t)((procid() + 1) % p);
+    procid_t left = (procid_t)((procid() + p - 1) % p);
+    blocks.clear();
+    blocks.resize(p);
+    blocks[procid()] = mydata;
+    for (size_t step = 1; step < p; ++step) {
+      size_t sendblock = (procid() + p - step + 1) % p;
+      size_t recvblock = (procid() + p - step) % p;
+      coll_send(right, seq, step, blocks[sendblock], control);
+      blocks[recvblock] = coll_recv(seq, step, left);
+    }
+  }
+
+  /**
+   * Dissemination barrier: ceil(log2(p)) rounds, in round k signalling
+   * machine procid() + 2^k and waiting for machine procid() - 2^k.
+   */
+  void coll_dissemination_barrier() {
+    size_t seq = coll_seq++;
+    const size_t p = numprocs();
+    size_t step = 0;
+    for (size_t dist = 1; dist < p; dist <<= 1, ++step) {
+      coll_send((procid_t)((procid() + dist) % p), seq, step,
+                std::string(), true);
+      coll_recv(seq, step, (procid_t)((procid() + p - dist) % p));
+    }
+  }
+
+  /// Identifies one chunk of a broadcast
+  struct coll_chunk_header: public IS_POD_TYPE {
+    size_t seq;
+    size_t chunkid;
+    size_t numchunks;
+    procid_t root;
+    bool control;
+  };
+
+  /**
+   * Forwards one chunk of a broadcast to my children in the binomial tree
+   * rooted at hdr.root, largest subtree first.
+   */
+  void coll_forward_broadcast(const coll_chunk_header& hdr,
+                              const std::string& s) {
+    const size_t p = numprocs();
+    size_t rel = (procid() + p - hdr.root) % p;
+    // the lowest set bit of rel is the edge to my parent. My children are
+    // rel + mask for all smaller powers of two
+    size_t mask = 1;
+    while (mask < p && (rel & mask) == 0) mask <<= 1;
+    for (mask >>= 1; mask > 0; mask >>= 1) {
+      if (rel + mask < p) {
+        procid_t target = (procid_t)((rel + mask + hdr.root) % p);
+        if (hdr.control) {
+          internal_control_flush_call(target,
+                                      &dc_dist_object<T>::__coll_broadcast_chunk,
+                                      hdr, s);
+        } else {
+          internal_flush_call(target,
+                              &dc_dist_object<T>::__coll_broadcast_chunk,
+                              hdr, s);
+        }
+      }
+    }
+  }
+
+  void __coll_broadcast_chunk(coll_chunk_header hdr, std::string s) {
+    coll_forward_broadcast(hdr, s);
+    coll_mut.lock();
+    coll_mailbox[coll_key_type(hdr.seq,
+                               std::make_pair(hdr.chunkid,
+                                              coll_any_source()))].swap(s);
+    coll_bcast_numchunks[hdr.seq] = hdr.numchunks;
+    coll_cond.signal();
+    coll_mut.unlock();
+  }
+
+  /**
+   * Broadcasts a serialized payload from root along a binomial tree.
+   * Payloads larger than RPC_COLLECTIVE_CHUNK_SIZE are cut into chunks
+   * which every machine forwards as soon as they arrive, so all levels of
+   * the tree are busy at the same time.
+   */
+  void coll_tree_broadcast(size_t seq, procid_t root, const std::string& s,
+                           bool control) {
+    coll_chunk_header hdr;
+    hdr.seq = seq;
+    hdr.root = root;
+    hdr.control = control;
+    hdr.numchunks = std::max<size_t>(1, (s.length() + RPC_COLLECTIVE_CHUNK_SIZE - 1)
+                                         / RPC_COLLECTIVE_CHUNK_SIZE);
+    if (hdr.numchunks == 1) {
+      hdr.chunkid = 0;
+      coll_forward_broadcast(hdr, s);
+      return;
+    }
+    for (hdr.chunkid = 0; hdr.chunkid < hdr.numchunks; ++hdr.chunkid) {
+      coll_forward_broadcast(hdr, s.substr(hdr.chunkid * RPC_COLLECTIVE_CHUNK_SIZE,
+                                           RPC_COLLECTIVE_CHUNK_SIZE));
+    }
+  }
+
+  /// Receives and reassembles the broadcast with sequence number seq
+  std::string coll_receive_broadcast(size_t seq) {
+    std::string ret;
+    coll_mut.lock();
+    while (coll_bcast_numchunks.count(seq) == 0) coll_cond.wait(coll_mut);
+    size_t numchunks = coll_bcast_numchunks[seq];
+    for (size_t i = 0; i < numchunks; ++i) {
+      coll_key_type key(seq, std::make_pair(i, coll_any_source()));
+      typename std::map<coll_key_type, std::string>::iterator iter;
+      while ((iter = coll_mailbox.find(key)) == coll_mailbox.end()) {
+        coll_cond.wait(coll_mut);
+      }
+      if (numchunks == 1) ret.swap(iter->second);
+      else ret.append(iter->second);
+      coll_mailbox.erase(iter);
+    }
+    coll_bcast_numchunks.erase(seq);
+    coll_mut.unlock();
+    return ret;
+  }
+
+ public:
+
 ////////////////////////////////////////////////////////////////////////////
 
 
@@ -1408,6 +2042,20 @@ private:
 
   /// \copydoc distributed_control::barrier()
   void barrier() {
+    if (numprocs() == 1) return;
+    if (coll_algorithm == COLLECTIVE_FLAT_TREE ||
+        (coll_algorithm == COLLECTIVE_AUTO &&
+         numprocs() <= RPC_COLLECTIVE_FLAT_MAX_PROCS)) {
+      tree_barrier();
+    } else {
+      coll_dissemination_barrier();
+    }
+  }
+
+ private:
+
+  /// The original barrier over the BARRIER_BRANCH_FACTOR-ary tree.
+  void tree_barrier() {
     // upward message
     int barrier_val = barrier_sense;
     barrier_mut.lock();
@@ -1487,7 +2135,8 @@ private:
     // tell node 0 how many calls there are
     std::vector<std::vector<size_t> > all_calls_sent(numprocs());
     all_calls_sent[procid()] = calls_sent_to_target;
-    all_gather(all_calls_sent, true);
+    all_gather_impl(all_calls_sent, true,
+                    sizeof(size_t) * (numprocs() + 1));
 
     // get the number of calls I am supposed to receive from each machine
     calls_to_receive.clear(); calls_to_receive.resize(numprocs(), 0);
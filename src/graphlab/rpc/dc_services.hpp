@@ -113,6 +113,18 @@ namespace graphlab {
       rmi.all_reduce2(data, plusequal, control);
     }
 
+    /// \copydoc distributed_control::all_reduce_dense()
+    template <typename U>
+    inline void all_reduce_dense(U& data, bool control = false) {
+      rmi.all_reduce_dense(data, control);
+    }
+
+    /// \copydoc distributed_control::all_reduce_array()
+    template <typename V>
+    inline void all_reduce_array(V* data, size_t len, bool control = false) {
+      rmi.all_reduce_array(data, len, control);
+    }
+
     /// \copydoc distributed_control::barrier()
     inline void barrier() {
       rmi.barrier();
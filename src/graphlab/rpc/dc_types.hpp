@@ -39,6 +39,20 @@ namespace graphlab {
     SCTP_COMM   ///< SCTP (limited support)
   };
 
+  /**
+   * \ingroup rpc
+   * The family of algorithms used by the dc_dist_object collectives
+   * (barrier, broadcast, all_gather, all_reduce).
+   * COLLECTIVE_AUTO chooses per call based on the payload size and
+   * the number of machines. All machines must use the same setting.
+   */
+  enum dc_collective_type {
+    COLLECTIVE_AUTO,                ///< Choose by payload size and numprocs
+    COLLECTIVE_FLAT_TREE,           ///< BARRIER_BRANCH_FACTOR-ary fan-in/fan-out tree
+    COLLECTIVE_RECURSIVE_DOUBLING,  ///< log(p) rounds of pairwise exchanges
+    COLLECTIVE_RING                 ///< Ring / chunk pipelined binomial trees
+  };
+
 
   /**
    * \internal
@@ -24,29 +24,80 @@
 #ifndef GRAPHLAB_DHT_HPP
 #define GRAPHLAB_DHT_HPP
 
+#include <vector>
 #include <boost/functional/hash.hpp>
-#include <boost/unordered_map.hpp>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/rpc/dc_dist_object.hpp>
+#include <graphlab/util/sharded_hopscotch_map.hpp>
 
 namespace graphlab {
 
   /**
    * \ingroup rpc
    * Implements a very rudimentary distributed key value store.
+   *
+   * Each key is owned by machine hash(key) % numprocs(). The owner keeps
+   * its entries in a sharded_hopscotch_map, so local readers and writers
+   * only contend when they touch the same shard.
+   *
+   * multi_get(), multi_get_future() and multi_set() batch many keys,
+   * sending one message per owning machine instead of one per key.
    */
   template <typename KeyType, typename ValueType>
   class dht { 
 
   public:
-    typedef boost::unordered_map<size_t, ValueType> storage_type;
-  
+    typedef sharded_hopscotch_map<size_t, ValueType> storage_type;
+    typedef std::vector<std::pair<bool, ValueType> > multi_result_type;
+
+    /**
+     * The result of multi_get_future(). Holds one outstanding request
+     * per owning machine. operator() waits for all of them and returns
+     * the values in the order of the requested keys.
+     */
+    class batch_future {
+    public:
+      /// Waits for all the replies if they have not yet been received
+      void wait() {
+        if (hasval) return;
+        for (size_t i = 0; i < futures.size(); ++i) {
+          if (positions[i].empty()) continue;
+          multi_result_type& ret = futures[i]();
+          for (size_t j = 0; j < positions[i].size(); ++j) {
+            result[positions[i][j]] = ret[j];
+          }
+        }
+        hasval = true;
+      }
+
+      /// Returns true if operator() can be called without blocking
+      bool is_ready() {
+        for (size_t i = 0; i < futures.size(); ++i) {
+          if (!positions[i].empty() && !futures[i].is_ready()) return false;
+        }
+        return true;
+      }
+
+      /// Waits for and returns the values
+      multi_result_type& operator()() {
+        wait();
+        return result;
+      }
+
+    private:
+      friend class dht;
+      multi_result_type result;
+      /// request to each machine. Unused if positions[i] is empty
+      std::vector<request_future<multi_result_type> > futures;
+      /// for each machine, where its replies go in result
+      std::vector<std::vector<size_t> > positions;
+      bool hasval;
+    };
 
   private:
     mutable dc_dist_object< dht > rpc;
   
     boost::hash<KeyType> hasher;
-    mutex lock;
     storage_type storage;
 
   public:
@@ -66,24 +117,16 @@ namespace graphlab {
      */
     std::pair<bool, ValueType> get(const KeyType &key) const {
       // who owns the data?
-
       const size_t hashvalue = hasher(key);
       const size_t owningmachine = hashvalue % rpc.numprocs();
-      std::pair<bool, ValueType> retval;
       // if it is me, we can return it
       if (owningmachine == rpc.dc().procid()) {
-
-        lock.lock();
-        typename storage_type::const_iterator iter = storage.find(hashvalue);
-        retval.first = iter != storage.end();
-        if (retval.first) retval.second = iter->second;
-        lock.unlock();
+        return storage.get(hashvalue);
       } else {
-        retval = rpc.remote_request(owningmachine, 
-                                         &dht<KeyType,ValueType>::get, 
-                                         key);
+        return rpc.remote_request(owningmachine, 
+                                  &dht<KeyType,ValueType>::local_get, 
+                                  hashvalue);
       }
-      return retval;
     }
  
     /**
@@ -93,28 +136,60 @@ namespace graphlab {
      */
     request_future<std::pair<bool, ValueType> > get_future(const KeyType &key) const {
       // who owns the data?
-
       const size_t hashvalue = hasher(key);
       const size_t owningmachine = hashvalue % rpc.numprocs();
-      std::pair<bool, ValueType> retval;
       // if it is me, we can return it
       if (owningmachine == rpc.dc().procid()) {
-
-        lock.lock();
-        typename storage_type::const_iterator iter = storage.find(hashvalue);
-        retval.first = iter != storage.end();
-        if (retval.first) retval.second = iter->second;
-        lock.unlock();
-        return retval;
+        return storage.get(hashvalue);
       } else {
         return rpc.future_remote_request(owningmachine, 
-                                           &dht<KeyType,ValueType>::get, 
-                                           key);
+                                         &dht<KeyType,ValueType>::local_get, 
+                                         hashvalue);
       }
     }
-  
 
+    /**
+     * Gets the values associated with a collection of keys, sending one
+     * request to each machine which owns any of the keys. Returns
+     * immediately. The returned future yields, for each key in order,
+     * (true, Value) if the entry is available and (false, undefined)
+     * otherwise.
+     */
+    batch_future multi_get_future(const std::vector<KeyType>& keys) const {
+      batch_future ret;
+      ret.result.resize(keys.size());
+      ret.futures.resize(rpc.numprocs());
+      ret.positions.resize(rpc.numprocs());
+      ret.hasval = false;
+      std::vector<std::vector<size_t> > hashes(rpc.numprocs());
+      for (size_t i = 0; i < keys.size(); ++i) {
+        const size_t hashvalue = hasher(keys[i]);
+        const procid_t owningmachine = hashvalue % rpc.numprocs();
+        if (owningmachine == rpc.dc().procid()) {
+          ret.result[i] = storage.get(hashvalue);
+        } else {
+          hashes[owningmachine].push_back(hashvalue);
+          ret.positions[owningmachine].push_back(i);
+        }
+      }
+      for (procid_t p = 0; p < rpc.numprocs(); ++p) {
+        if (hashes[p].empty()) continue;
+        ret.futures[p] = rpc.future_remote_request(p,
+                                     &dht<KeyType,ValueType>::local_multi_get,
+                                     hashes[p]);
+        // future requests are not flushed by default
+        dc_impl::pull_flush_soon_thread_local_buffer(p);
+      }
+      return ret;
+    }
 
+    /**
+     * Gets the values associated with a collection of keys. Equivalent to
+     * multi_get_future(keys)().
+     */
+    multi_result_type multi_get(const std::vector<KeyType>& keys) const {
+      return multi_get_future(keys)();
+    }
 
     /**
      * Sets the newval to be the value associated with the key
@@ -126,13 +201,37 @@ namespace graphlab {
  
       // if it is me, set it
       if (owningmachine == rpc.dc().procid()) {
-        lock.lock();
-        storage[hashvalue] = newval;
-        lock.unlock();
+        storage.set(hashvalue, newval);
       } else {
         rpc.remote_call(owningmachine, 
-                             &dht<KeyType,ValueType>::set, 
-                             key, newval);
+                        &dht<KeyType,ValueType>::local_set, 
+                        hashvalue, newval);
+      }
+    }
+
+    /**
+     * Sets values[i] to be the value associated with keys[i], sending one
+     * message to each machine which owns any of the keys.
+     */
+    void multi_set(const std::vector<KeyType>& keys,
+                   const std::vector<ValueType>& values) {
+      ASSERT_EQ(keys.size(), values.size());
+      std::vector<std::vector<size_t> > hashes(rpc.numprocs());
+      std::vector<std::vector<ValueType> > batches(rpc.numprocs());
+      for (size_t i = 0; i < keys.size(); ++i) {
+        const size_t hashvalue = hasher(keys[i]);
+        const procid_t owningmachine = hashvalue % rpc.numprocs();
+        if (owningmachine == rpc.dc().procid()) {
+          storage.set(hashvalue, values[i]);
+        } else {
+          hashes[owningmachine].push_back(hashvalue);
+          batches[owningmachine].push_back(values[i]);
+        }
+      }
+      for (procid_t p = 0; p < rpc.numprocs(); ++p) {
+        if (hashes[p].empty()) continue;
+        rpc.remote_call(p, &dht<KeyType,ValueType>::local_multi_set,
+                        hashes[p], batches[p]);
       }
     }
   
@@ -149,8 +248,34 @@ namespace graphlab {
       storage.clear();
     }
 
+  private:
+    /*
+     * The remote handlers take the hash of the key, which is all the
+     * owner stores, so keys need not be sent over the wire.
+     */
+    std::pair<bool, ValueType> local_get(size_t hashvalue) const {
+      return storage.get(hashvalue);
+    }
+
+    multi_result_type local_multi_get(const std::vector<size_t>& hashes) const {
+      multi_result_type ret(hashes.size());
+      for (size_t i = 0; i < hashes.size(); ++i) {
+        ret[i] = storage.get(hashes[i]);
+      }
+      return ret;
+    }
+
+    void local_set(size_t hashvalue, const ValueType& newval) {
+      storage.set(hashvalue, newval);
+    }
+
+    void local_multi_set(const std::vector<size_t>& hashes,
+                         const std::vector<ValueType>& values) {
+      for (size_t i = 0; i < hashes.size(); ++i) {
+        storage.set(hashes[i], values[i]);
+      }
+    }
   };
 
 };
 #endif
-
@@ -29,6 +29,9 @@
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/dc_dist_object.hpp>
 #include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/serialization/serialized_size.hpp>
+#include <graphlab/rpc/received_buffer.hpp>
+#include <boost/type_traits/integral_constant.hpp>
 
 
 #include <graphlab/macros_def.hpp>
@@ -89,11 +92,83 @@ namespace graphlab {
   public:
     typedef std::vector<T> buffer_type;
 
+    /**
+     * Trivially serializable values are written as raw bytes, and are
+     * otherwise serialized one by one.
+     */
+    static const bool value_is_raw = gl_is_trivially_serializable<T>::value;
+
     struct buffer_record {
       procid_t proc;
       buffer_type buffer;
-      buffer_record() : proc(-1)  { }
+      /// The values as received. Only used by recv_in_place()
+      received_buffer bytes;
+      size_t numel;
+      buffer_record() : proc(-1), numel(0)  { }
+
+      /// Number of values in the record, whichever way they were received
+      size_t size() const {
+        return bytes.size() == 0 ? buffer.size() : numel;
+      }
     }; // end of buffer record
+
+    /**
+     * Reads the values of a record returned by recv_in_place(), which
+     * must be std::pairs, one after the other straight from the network
+     * buffer. The second element of each pair is written directly into
+     * its destination, so nothing is copied on the way. e.g.,
+     *
+     *   pair_reader reader(rec);
+     *   while(!reader.done()) {
+     *     lvid_type lvid = graph.local_vid(reader.first());
+     *     reader.second(graph.l_vertex(lvid).data());
+     *   }
+     */
+    class pair_reader {
+     public:
+      typedef typename T::first_type first_type;
+      typedef typename T::second_type second_type;
+
+      explicit pair_reader(const buffer_record& rec)
+        : iarc(rec.bytes.data(), rec.bytes.size()), remaining(rec.numel) {
+        T probe;
+        second_offset = reinterpret_cast<char*>(&probe.second) -
+                        reinterpret_cast<char*>(&probe);
+      }
+
+      bool done() const { return remaining == 0; }
+
+      /// Reads the first element of the next pair
+      first_type first() {
+        first_type ret;
+        read_first(ret, boost::integral_constant<bool, value_is_raw>());
+        return ret;
+      }
+
+      /// Reads the second element of the pair into target. Must follow first()
+      void second(second_type& target) {
+        read_second(target, boost::integral_constant<bool, value_is_raw>());
+        --remaining;
+      }
+
+     private:
+      iarchive iarc;
+      size_t remaining;
+      size_t second_offset;
+
+      // the pairs are raw bytes, which are not necessarily aligned
+      void read_first(first_type& ret, boost::true_type) {
+        memcpy(&ret, iarc.buf + iarc.off, sizeof(first_type));
+      }
+      void read_second(second_type& target, boost::true_type) {
+        memcpy(&target, iarc.buf + iarc.off + second_offset, sizeof(second_type));
+        iarc.off += sizeof(T);
+      }
+      // the pairs are serialized as the first then the second element
+      void read_first(first_type& ret, boost::false_type) { iarc >> ret; }
+      void read_second(second_type& target, boost::false_type) { iarc >> target; }
+    }; // end of pair reader
+
     typedef std::vector<buffer_record> recv_buffer_type;
     mutex lock;
   private:
@@ -177,12 +252,15 @@ namespace graphlab {
       size_t wid = fiber_control::get_worker_id();
       if (send_buffers[wid][proc].oarc == NULL) {
         send_buffers[wid][proc].oarc = rpc.split_call_begin(&fiber_buffered_exchange::rpc_recv);
+        // size the buffer once rather than growing it by repeated
+        // reallocation up to max_buffer_size
+        send_buffers[wid][proc].oarc->reserve(max_buffer_size + serialized_size<T>::get(value));
         // write a header
         (*send_buffers[wid][proc].oarc) << rpc.procid();
         send_buffers[wid][proc].numinserts = 0;
       }
 
-      (*(send_buffers[wid][proc].oarc)) << value;
+      write_value(*(send_buffers[wid][proc].oarc), value);
       ++send_buffers[wid][proc].numinserts;
 
 
@@ -225,6 +303,21 @@ namespace graphlab {
      */
     bool recv(std::vector<buffer_record>& ret_buffer,
               const bool self_buffer = true) {
+      bool success = recv_in_place(ret_buffer, self_buffer);
+      for (size_t i = 0;i < ret_buffer.size(); ++i) {
+        read_values(ret_buffer[i]);
+      }
+      return success;
+    } // end of recv
+
+    /**
+     * Like recv(), but the values are left in the network buffers they
+     * arrived in, and buffer_record::buffer is empty. The values must be
+     * read with a pair_reader. The network buffers are released when
+     * ret_buffer is cleared or reused.
+     */
+    bool recv_in_place(std::vector<buffer_record>& ret_buffer,
+                       const bool self_buffer = true) {
       fiber_control::fast_yield();
       ret_buffer.clear();
       bool success = false;
@@ -255,7 +348,7 @@ namespace graphlab {
         }
       }
       return success;
-    } // end of recv
+    } // end of recv_in_place
 
 
 
@@ -284,8 +377,28 @@ namespace graphlab {
 
     void barrier() { rpc.barrier(); }
   private:
+    static void write_value(oarchive& oarc, const T& value) {
+      if (value_is_raw) oarc.write(reinterpret_cast<const char*>(&value), sizeof(T));
+      else oarc << value;
+    }
+
+    /// Reads the values of a record received in place into its buffer
+    static void read_values(buffer_record& rec) {
+      if (rec.bytes.size() == 0) return;
+      rec.buffer.resize(rec.numel);
+      if (value_is_raw) {
+        // the values were written back to back by write_value
+        memcpy(&(rec.buffer[0]), rec.bytes.data(), rec.numel * sizeof(T));
+      } else {
+        iarchive iarc(rec.bytes.data(), rec.bytes.size());
+        for (size_t i = 0;i < rec.numel; ++i) {
+          iarc >> rec.buffer[i];
+        }
+      }
+      rec.bytes = received_buffer();
+    }
+
     void rpc_recv(size_t len, wild_pointer w) {
-      buffer_type tmp;
       iarchive iarc(reinterpret_cast<const char*>(w.ptr), len);
       // first desrialize the source process
       procid_t src_proc; iarc >> src_proc;
@@ -298,9 +411,11 @@ namespace graphlab {
       size_t numel = 0; 
       numel_iarc.read(reinterpret_cast<char*>(&numel), sizeof(size_t));
       //std::cout << "Receiving: " << numel << "\n";
-      tmp.resize(numel);
-      for (size_t i = 0;i < numel; ++i) {
-        iarc >> tmp[i];
+      // keep the values where they are. They are read by the receiver
+      received_buffer bytes;
+      if (numel > 0) {
+        bytes = received_buffer(iarc.buf + iarc.off,
+                                len - iarc.off - sizeof(size_t));
       }
 
       size_t wid = fiber_control::get_worker_id();
@@ -308,7 +423,8 @@ namespace graphlab {
       recv_buffers[wid].push_back(buffer_record());
       buffer_record& rec = recv_buffers[wid].back();
       rec.proc = src_proc;
-      rec.buffer.swap(tmp);
+      rec.bytes = bytes;
+      rec.numel = numel;
       lock.unlock();
     } // end of rpc rcv
 
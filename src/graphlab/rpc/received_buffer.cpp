@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <graphlab/rpc/received_buffer.hpp>
+
+namespace graphlab {
+namespace dc_impl {
+
+/*
+ * Only read at the start of a handler, before it can yield, so it does
+ * not matter that a fiber may resume on a different thread.
+ */
+static __thread receive_chunk* current_receive_chunk = NULL;
+
+void set_current_receive_chunk(receive_chunk* c) {
+  current_receive_chunk = c;
+}
+
+void release_receive_chunk(receive_chunk& c) {
+  if (c.refctr == NULL) {
+    free(c.chunk);
+  } else if (c.refctr->dec() == 0) {
+    delete c.refctr;
+    free(c.chunk);
+  }
+  c.chunk = NULL;
+  c.refctr = NULL;
+}
+
+} // namespace dc_impl
+
+
+received_buffer::received_buffer(const void* p, size_t l)
+  : chunk(NULL), refctr(NULL), ptr(NULL), len(l) {
+  const char* cp = reinterpret_cast<const char*>(p);
+  dc_impl::receive_chunk* c = dc_impl::current_receive_chunk;
+  if (c != NULL && cp >= c->chunk && cp + l <= c->chunk + c->len) {
+    // share the chunk. The extra count is the hold of the call
+    // processing loop which drops it in release_receive_chunk()
+    if (c->refctr == NULL) c->refctr = new atomic<size_t>(1);
+    c->refctr->inc();
+    chunk = c->chunk;
+    refctr = c->refctr;
+    ptr = cp;
+  } else {
+    chunk = (char*)malloc(l > 0 ? l : 1);
+    memcpy(chunk, cp, l);
+    refctr = new atomic<size_t>(1);
+    ptr = chunk;
+  }
+}
+
+} // namespace graphlab
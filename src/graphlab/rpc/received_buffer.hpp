@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_RPC_RECEIVED_BUFFER_HPP
+#define GRAPHLAB_RPC_RECEIVED_BUFFER_HPP
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <boost/static_assert.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/serialization/is_pod.hpp>
+
+namespace graphlab {
+namespace dc_impl {
+
+/**
+ * \internal
+ * The receive chunk whose calls are being executed. refctr is only
+ * allocated if a call retains the chunk with a received_buffer.
+ */
+struct receive_chunk {
+  char* chunk;
+  size_t len;
+  atomic<size_t>* refctr;
+};
+
+/**
+ * \internal
+ * Publishes the chunk the next function call on this thread is read from.
+ * Must be cleared (set to NULL) once the call returns.
+ */
+void set_current_receive_chunk(receive_chunk* c);
+
+/**
+ * \internal
+ * Called once all calls in the chunk were executed. Frees the chunk
+ * unless a received_buffer still refers to it.
+ */
+void release_receive_chunk(receive_chunk& c);
+
+} // namespace dc_impl
+
+
+/**
+ * \ingroup rpc
+ * A reference counted handle on a range of received bytes, which keeps
+ * them valid after the function call which received them returns.
+ *
+ * Constructed inside an RPC handler with a pointer into the handler's
+ * arguments (for instance a wild_pointer), it shares the receive buffer
+ * of the RPC layer so nothing is copied. If the bytes do not belong to a
+ * receive buffer which can be shared, they are copied once.
+ *
+ * The whole receive buffer stays allocated for as long as any handle on
+ * part of it exists, so handles should not be kept for long.
+ */
+class received_buffer {
+ private:
+  char* chunk;
+  atomic<size_t>* refctr;
+  const char* ptr;
+  size_t len;
+
+  void release() {
+    if (refctr != NULL && refctr->dec() == 0) {
+      delete refctr;
+      free(chunk);
+    }
+    chunk = NULL; refctr = NULL; ptr = NULL; len = 0;
+  }
+
+ public:
+  received_buffer(): chunk(NULL), refctr(NULL), ptr(NULL), len(0) { }
+
+  /// Must be called from within the RPC handler which received [ptr, ptr+len)
+  received_buffer(const void* ptr, size_t len);
+
+  received_buffer(const received_buffer& other)
+    : chunk(other.chunk), refctr(other.refctr), ptr(other.ptr), len(other.len) {
+    if (refctr != NULL) refctr->inc();
+  }
+
+  received_buffer& operator=(const received_buffer& other) {
+    if (this != &other) {
+      if (other.refctr != NULL) other.refctr->inc();
+      release();
+      chunk = other.chunk; refctr = other.refctr;
+      ptr = other.ptr; len = other.len;
+    }
+    return *this;
+  }
+
+  ~received_buffer() { release(); }
+
+  const char* data() const { return ptr; }
+  size_t size() const { return len; }
+};
+
+
+} // namespace graphlab
+#endif
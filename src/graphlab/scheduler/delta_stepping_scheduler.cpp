@@ -0,0 +1,157 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <graphlab/scheduler/delta_stepping_scheduler.hpp>
+#include <graphlab/macros_def.hpp>
+namespace graphlab {
+
+void delta_stepping_scheduler::set_options(const graphlab_options& opts) {
+  ncpus = opts.get_ncpus();
+  std::vector<std::string> keys = opts.get_scheduler_args().get_option_keys();
+  foreach(std::string opt, keys) {
+    if (opt == "delta") {
+      opts.get_scheduler_args().get_option("delta", delta);
+    } else if (opt == "buckets") {
+      opts.get_scheduler_args().get_option("buckets", num_buckets);
+    }  else {
+      logstream(LOG_FATAL) << "Unexpected Scheduler Option: " << opt << std::endl;
+    }
+  }
+  ASSERT_GT(delta, 0);
+  ASSERT_GE(num_buckets, 1);
+}
+
+// Initializes the internal datastructures
+void delta_stepping_scheduler::initialize_data_structures() {
+  queues.resize(num_buckets * ncpus);
+  bucket_size.resize(num_buckets);
+  vertex_is_scheduled.resize(num_vertices);
+  vertex_version.resize(num_vertices);
+  vertex_bucket.resize(num_vertices);
+}
+
+delta_stepping_scheduler::delta_stepping_scheduler(size_t num_vertices,
+                                                   const graphlab_options& opts):
+    delta(1.0),
+    num_buckets(1024),
+    num_vertices(num_vertices) {
+  ASSERT_GE(opts.get_ncpus(), 1);
+  set_options(opts);
+  initialize_data_structures();
+}
+
+
+void delta_stepping_scheduler::set_num_vertices(const lvid_type numv) {
+  num_vertices = numv;
+  vertex_is_scheduled.resize(numv);
+  vertex_version.resize(numv);
+  vertex_bucket.resize(numv);
+}
+
+void delta_stepping_scheduler::push(size_t bucket, const entry& e) {
+  const size_t slot = bucket % num_buckets;
+  // count the entry before it is visible, so that advance() never
+  // skips a bucket an entry is being pushed to
+  bucket_size[slot].inc();
+  queue_type& q = queues[slot * ncpus +
+                         random::fast_uniform(size_t(0), ncpus - 1)];
+  q.lock.lock();
+  q.entries.push_back(e);
+  q.lock.unlock();
+}
+
+void delta_stepping_scheduler::schedule(const lvid_type vid, double priority) {
+  if (vid >= num_vertices) return;
+  size_t bucket = delta_stepping_bucket(priority, delta);
+  const size_t cur = current_bucket.value;
+  if (bucket < cur) bucket = cur;
+  else if (bucket >= cur + num_buckets) bucket = cur + num_buckets - 1;
+
+  if (!vertex_is_scheduled.set_bit(vid)) {
+    vertex_bucket[vid] = bucket;
+    push(bucket, entry(vid, vertex_version[vid].value));
+  } else if (bucket < vertex_bucket[vid]) {
+    // already scheduled in a later bucket. Supersede the old entry
+    vertex_bucket[vid] = bucket;
+    push(bucket, entry(vid, vertex_version[vid].inc()));
+  }
+}
+
+bool delta_stepping_scheduler::advance(size_t cur) {
+  advance_lock.lock();
+  bool ret = false;
+  if (current_bucket.value != cur) {
+    // somebody else moved on already
+    ret = true;
+  } else {
+    for (size_t i = 0; i < num_buckets; ++i) {
+      if (bucket_size[(cur + i) % num_buckets].value > 0) {
+        current_bucket.value = cur + i;
+        ret = true;
+        break;
+      }
+    }
+  }
+  advance_lock.unlock();
+  return ret;
+}
+
+/** Get the next element in the queue */
+sched_status::status_enum delta_stepping_scheduler::get_next(const size_t cpuid,
+                                                             lvid_type& ret_vid) {
+  while(1) {
+    const size_t cur = current_bucket.value;
+    const size_t slot = cur % num_buckets;
+    // start with this cpu's queue of the bucket
+    for (size_t i = 0; i < ncpus && bucket_size[slot].value > 0; ++i) {
+      queue_type& q = queues[slot * ncpus + (cpuid + i) % ncpus];
+      if (q.entries.empty()) continue;
+      bool good = false;
+      q.lock.lock();
+      while(!good && !q.entries.empty()) {
+        const entry e = q.entries.back();
+        q.entries.pop_back();
+        bucket_size[slot].dec();
+        // entries superseded by a lower bucket are dropped here
+        if (e.vid < num_vertices && e.version == vertex_version[e.vid].value) {
+          good = vertex_is_scheduled.clear_bit(e.vid);
+          ret_vid = e.vid;
+        }
+      }
+      q.lock.unlock();
+      if (good) return sched_status::NEW_TASK;
+    }
+    if (!advance(cur)) return sched_status::EMPTY;
+  }
+} // end of get_next_task
+
+
+bool delta_stepping_scheduler::empty() {
+  for (size_t i = 0;i < bucket_size.size(); ++i) {
+    if (bucket_size[i].value > 0) return false;
+  }
+  return true;
+}
+
+}
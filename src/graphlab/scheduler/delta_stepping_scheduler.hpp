@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_DELTA_STEPPING_SCHEDULER_HPP
+#define GRAPHLAB_DELTA_STEPPING_SCHEDULER_HPP
+
+#include <vector>
+
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
+
+#include <graphlab/util/random.hpp>
+#include <graphlab/scheduler/ischeduler.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+
+#include <graphlab/options/graphlab_options.hpp>
+
+#include <graphlab/macros_def.hpp>
+namespace graphlab {
+
+  /**
+   * Returns the delta-stepping bucket of a priority. The priority is
+   * read as a negated distance (higher priority runs first), so the
+   * bucket is floor(-priority / delta). Positive priorities fall in
+   * bucket 0.
+   */
+  inline size_t delta_stepping_bucket(double priority, double delta) {
+    const double key = -priority / delta;
+    if (!(key > 0)) return 0;
+    // keep far away (and infinite) distances representable
+    if (key >= double(size_t(1) << 62)) return size_t(1) << 62;
+    return size_t(key);
+  }
+
+  /**
+   * \ingroup group_schedulers
+   *
+   * A delta-stepping scheduler for label correcting algorithms with
+   * monotone priorities, such as single source shortest paths.
+   *
+   * The priority of a vertex is read as its negated tentative distance
+   * (see delta_stepping_bucket()). Vertices are kept in buckets of
+   * width \c delta and all threads work on the lowest non-empty bucket
+   * until it is exhausted, including vertices rescheduled into it while
+   * it is processed. Only then does the scheduler move on to the next
+   * bucket. With a well chosen delta this avoids most of the repeated
+   * relaxations a FIFO order causes, while keeping a whole bucket of
+   * parallelism.
+   *
+   * The buckets form a circular window of \c buckets buckets starting at
+   * the current one. Vertices beyond the window go in its last bucket,
+   * and vertices below the current bucket go in the current one.
+   * Each bucket is split into one locked queue per cpu.
+   *
+   * A vertex scheduled again with a priority of a lower bucket is pushed
+   * again with a new version. The older entry is dropped when popped.
+   */
+  class delta_stepping_scheduler : public ischeduler {
+
+  public:
+
+    struct entry {
+      lvid_type vid;
+      uint32_t version;
+      entry(lvid_type vid = 0, uint32_t version = 0):
+          vid(vid), version(version) { }
+    };
+
+  private:
+
+    struct queue_type {
+      std::vector<entry> entries;
+      simple_spinlock lock;
+      // keep the queues of different cpus on separate cache lines
+      char padding[64];
+    };
+
+    // a bitset denoting if a vertex is scheduled
+    dense_bitset vertex_is_scheduled;
+    // the version of the live entry of each vertex
+    std::vector<atomic<uint32_t> > vertex_version;
+    // the (absolute) bucket of the live entry of each vertex
+    std::vector<size_t> vertex_bucket;
+
+    // bucket i of the window is queues[i * ncpus ... (i + 1) * ncpus - 1]
+    std::vector<queue_type> queues;
+    // number of entries in each bucket of the window, including stale ones
+    std::vector<atomic<size_t> > bucket_size;
+    // the current bucket. Absolute
+    atomic<size_t> current_bucket;
+    mutex advance_lock;
+
+    // the number of CPUs
+    size_t ncpus;
+    // the bucket width
+    double delta;
+    // the number of buckets in the window
+    size_t num_buckets;
+    // the number of vertices in the graph
+    size_t num_vertices;
+
+    void set_options(const graphlab_options& opts);
+
+    // Initializes the internal datastructures
+    void initialize_data_structures();
+
+    void push(size_t bucket, const entry& e);
+
+    /**
+     * Moves the current bucket past an empty bucket cur. Returns false if
+     * all buckets are empty.
+     */
+    bool advance(size_t cur);
+
+  public:
+
+    delta_stepping_scheduler(size_t num_vertices, const graphlab_options& opts);
+
+    void set_num_vertices(const lvid_type numv);
+
+    void schedule(const lvid_type vid, double priority = 1);
+
+    /** Get the next element in the queue */
+    sched_status::status_enum get_next(const size_t cpuid,
+                                       lvid_type& ret_vid);
+
+    bool empty();
+
+    /// Returns the current bucket
+    size_t get_current_bucket() const {
+      return current_bucket.value;
+    }
+
+    static void print_options_help(std::ostream& out) {
+      out << "\t delta = [bucket width, in units of -priority. Default = 1].\n"
+          << "buckets = [number of buckets kept ahead of the current one. "
+          << "Default = 1024]\n";
+    }
+
+  };
+
+
+} // end of namespace graphlab
+#include <graphlab/macros_undef.hpp>
+
+#endif
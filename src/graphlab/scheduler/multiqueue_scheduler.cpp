@@ -0,0 +1,146 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <algorithm>
+#include <graphlab/scheduler/multiqueue_scheduler.hpp>
+#include <graphlab/macros_def.hpp>
+namespace graphlab {
+
+void multiqueue_scheduler::set_options(const graphlab_options& opts) {
+  ncpus = opts.get_ncpus();
+  std::vector<std::string> keys = opts.get_scheduler_args().get_option_keys();
+  foreach(std::string opt, keys) {
+    if (opt == "multi") {
+      opts.get_scheduler_args().get_option("multi", multi);
+    } else if (opt == "min_priority") {
+      opts.get_scheduler_args().get_option("min_priority", min_priority);
+    }  else {
+      logstream(LOG_FATAL) << "Unexpected Scheduler Option: " << opt << std::endl;
+    }
+  }
+}
+
+// Initializes the internal datastructures
+void multiqueue_scheduler::initialize_data_structures() {
+  size_t nqueues = std::max(multi * ncpus, size_t(1));
+  queues.resize(nqueues);
+  vertex_is_scheduled.resize(num_vertices);
+  vertex_version.resize(num_vertices);
+  vertex_priority.resize(num_vertices);
+}
+
+multiqueue_scheduler::multiqueue_scheduler(size_t num_vertices,
+                                           const graphlab_options& opts):
+    multi(2),
+    min_priority(-std::numeric_limits<double>::max()),
+    num_vertices(num_vertices) {
+  ASSERT_GE(opts.get_ncpus(), 1);
+  set_options(opts);
+  initialize_data_structures();
+}
+
+
+void multiqueue_scheduler::set_num_vertices(const lvid_type numv) {
+  num_vertices = numv;
+  vertex_is_scheduled.resize(numv);
+  vertex_version.resize(numv);
+  vertex_priority.resize(numv);
+}
+
+void multiqueue_scheduler::push(const entry& e) {
+  // rather than waiting on a busy queue, try another one
+  size_t idx = random_queue();
+  while (!queues[idx].lock.try_lock()) idx = random_queue();
+  queue_type& q = queues[idx];
+  q.heap.push_back(e);
+  std::push_heap(q.heap.begin(), q.heap.end());
+  update_top(q);
+  q.lock.unlock();
+}
+
+void multiqueue_scheduler::schedule(const lvid_type vid, double priority) {
+  if (vid >= num_vertices) return;
+  if (!vertex_is_scheduled.set_bit(vid)) {
+    vertex_priority[vid] = priority;
+    push(entry(priority, vid, vertex_version[vid].value));
+  } else if (priority > vertex_priority[vid]) {
+    // already scheduled, at a lower priority. Supersede the old entry
+    vertex_priority[vid] = priority;
+    push(entry(priority, vid, vertex_version[vid].inc()));
+  }
+}
+
+bool multiqueue_scheduler::pop_locked(queue_type& q, lvid_type& ret_vid) {
+  bool good = false;
+  while(!good && !q.heap.empty() && q.heap.front().priority >= min_priority) {
+    const entry e = q.heap.front();
+    std::pop_heap(q.heap.begin(), q.heap.end());
+    q.heap.pop_back();
+    // entries superseded by a priority raise are dropped here
+    if (e.vid < num_vertices && e.version == vertex_version[e.vid].value) {
+      good = vertex_is_scheduled.clear_bit(e.vid);
+      ret_vid = e.vid;
+    }
+  }
+  update_top(q);
+  return good;
+}
+
+/** Get the next element in the queue */
+sched_status::status_enum multiqueue_scheduler::get_next(const size_t cpuid,
+                                                         lvid_type& ret_vid) {
+  // pop from the better of two random queues
+  const size_t MAX_PROBES = 2;
+  for (size_t i = 0;i < MAX_PROBES && queues.size() > 1; ++i) {
+    size_t idx = random_queue();
+    const size_t other = random_queue();
+    if (queues[other].top > queues[idx].top) idx = other;
+    queue_type& q = queues[idx];
+    if (q.top < min_priority || !q.lock.try_lock()) continue;
+    bool good = pop_locked(q, ret_vid);
+    q.lock.unlock();
+    if (good) return sched_status::NEW_TASK;
+  }
+  // The probes found nothing. Look at every queue before reporting empty.
+  const size_t initial_idx = (cpuid * multi) % queues.size();
+  for(size_t i = 0; i < queues.size(); ++i) {
+    queue_type& q = queues[(initial_idx + i) % queues.size()];
+    if (q.top < min_priority) continue;
+    q.lock.lock();
+    bool good = pop_locked(q, ret_vid);
+    q.lock.unlock();
+    if (good) return sched_status::NEW_TASK;
+  }
+  return sched_status::EMPTY;
+} // end of get_next_task
+
+
+bool multiqueue_scheduler::empty() {
+  for (size_t i = 0;i < queues.size(); ++i) {
+    if (queues[i].top >= min_priority) return false;
+  }
+  return true;
+}
+
+}
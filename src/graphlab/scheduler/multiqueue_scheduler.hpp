@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_MULTIQUEUE_SCHEDULER_HPP
+#define GRAPHLAB_MULTIQUEUE_SCHEDULER_HPP
+
+#include <vector>
+#include <limits>
+
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
+
+#include <graphlab/util/random.hpp>
+#include <graphlab/scheduler/ischeduler.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+
+#include <graphlab/options/graphlab_options.hpp>
+
+#include <graphlab/macros_def.hpp>
+namespace graphlab {
+
+  /**
+   * \ingroup group_schedulers
+   *
+   * A relaxed concurrent priority scheduler (a "MultiQueue").
+   *
+   * Vertices are pushed into one of \c multi * ncpus binary heaps
+   * chosen at random. To pop, a thread compares the cached top priority of
+   * two random heaps without locking, and pops from the better of the
+   * two. Threads therefore rarely contend for the same lock, and the
+   * popped vertex is, with high probability, among the top
+   * O(number of queues) scheduled vertices.
+   *
+   * Raising the priority of a scheduled vertex does not search the heaps.
+   * Instead, a new heap entry is pushed with a new version of the vertex,
+   * and the older entries, which no longer match the vertex's version,
+   * are discarded when they reach the top of their heap.
+   */
+  class multiqueue_scheduler : public ischeduler {
+
+  public:
+
+    /// A heap entry. Ordered by priority
+    struct entry {
+      double priority;
+      lvid_type vid;
+      uint32_t version;
+      entry(double priority = 0, lvid_type vid = 0, uint32_t version = 0):
+          priority(priority), vid(vid), version(version) { }
+      bool operator<(const entry& other) const {
+        return priority < other.priority;
+      }
+    };
+
+  private:
+
+    struct queue_type {
+      std::vector<entry> heap;
+      // Priority of the top of the heap. -infinity if the heap is empty.
+      // Written under the lock, read without it.
+      volatile double top;
+      simple_spinlock lock;
+      // keep the heavily written queue headers on separate cache lines
+      char padding[64];
+      queue_type(): top(-std::numeric_limits<double>::infinity()) { }
+    };
+
+    // a bitset denoting if a vertex is scheduled
+    dense_bitset vertex_is_scheduled;
+    // the version of the live heap entry of each vertex
+    std::vector<atomic<uint32_t> > vertex_version;
+    // the priority of the live heap entry of each vertex. Races only
+    // cause a redundant, or a skipped, priority raise
+    std::vector<double> vertex_priority;
+    std::vector<queue_type> queues;
+
+    // the number of CPUs
+    size_t ncpus;
+    // The queue to CPU ratio
+    size_t multi;
+    double min_priority;
+    // the number of vertices in the graph
+    size_t num_vertices;
+
+    void set_options(const graphlab_options& opts);
+
+    // Initializes the internal datastructures
+    void initialize_data_structures();
+
+    /// Pushes an entry into a random queue
+    void push(const entry& e);
+
+    /**
+     * Pops the top valid entry of a queue whose lock is held.
+     * Returns false if the queue has no entry of priority >= min_priority.
+     */
+    bool pop_locked(queue_type& q, lvid_type& ret_vid);
+
+    /// Recomputes the cached top of a queue whose lock is held
+    void update_top(queue_type& q) {
+      q.top = q.heap.empty() ? -std::numeric_limits<double>::infinity() :
+                               q.heap.front().priority;
+    }
+
+    size_t random_queue() const {
+      return queues.size() == 1 ? 0 :
+          random::fast_uniform(size_t(0), queues.size() - 1);
+    }
+
+  public:
+
+    multiqueue_scheduler(size_t num_vertices, const graphlab_options& opts);
+
+    void set_num_vertices(const lvid_type numv);
+
+    void schedule(const lvid_type vid, double priority = 1);
+
+    /** Get the next element in the queue */
+    sched_status::status_enum get_next(const size_t cpuid,
+                                       lvid_type& ret_vid);
+
+    bool empty();
+
+    static void print_options_help(std::ostream& out) {
+      out << "\t multi = [number of queues per thread. Default = 2].\n"
+          << "min_priority = [double, minimum priority required to receive \n"
+          << "\t a message, default = -inf]\n";
+    }
+
+  };
+
+
+} // end of namespace graphlab
+#include <graphlab/macros_undef.hpp>
+
+#endif
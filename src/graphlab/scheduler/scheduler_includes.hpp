@@ -27,6 +27,8 @@
 #include <graphlab/scheduler/ischeduler.hpp>
  #include <graphlab/scheduler/priority_scheduler.hpp>
 #include <graphlab/scheduler/queued_fifo_scheduler.hpp>
+#include <graphlab/scheduler/multiqueue_scheduler.hpp>
+#include <graphlab/scheduler/delta_stepping_scheduler.hpp>
 #include <graphlab/scheduler/scheduler_factory.hpp>
 #include <graphlab/scheduler/scheduler_list.hpp>
 #include <graphlab/scheduler/sweep_scheduler.hpp>
@@ -43,12 +43,24 @@
     "This scheduler maintains a shared FIFO queue of FIFO queues. "     \
     "Each thread maintains its own smaller in and out queues. When a "  \
     "threads out queue is too large (greater than \"queuesize\") then " \
-    "the thread puts its out queue at the end of the master queue."))   
+    "the thread puts its out queue at the end of the master queue."))   \
+  (("multiqueue", multiqueue_scheduler,                                 \
+    "Relaxed concurrent priority scheduler. Each thread pops from the " \
+    "better of two random priority queues, so high priority vertices "  \
+    "run roughly first while threads rarely contend. Scales better "    \
+    "than \"priority\" with many threads."))                           \
+  (("delta_stepping", delta_stepping_scheduler,                         \
+    "Delta-stepping buckets for monotone priorities such as shortest "  \
+    "path distances. The priority is read as a negated distance, and "  \
+    "all threads work on the bucket of the smallest distances (of "     \
+    "width \"delta\") until it is empty."))
 
 #include <graphlab/scheduler/fifo_scheduler.hpp>
 #include <graphlab/scheduler/sweep_scheduler.hpp>
 #include <graphlab/scheduler/priority_scheduler.hpp>
 #include <graphlab/scheduler/queued_fifo_scheduler.hpp>
+#include <graphlab/scheduler/multiqueue_scheduler.hpp>
+#include <graphlab/scheduler/delta_stepping_scheduler.hpp>
 
 
 namespace graphlab {
@@ -23,6 +23,7 @@
 
 #ifndef GRAPHLAB_IS_POD_HPP
 #define GRAPHLAB_IS_POD_HPP
+#include <utility>
 #include <boost/type_traits.hpp>
 
 namespace graphlab {
@@ -80,6 +81,77 @@ namespace graphlab {
                              gl_is_pod<T>::value>::value
                           ));
   };
+
+  /**
+   * \ingroup group_serialization
+   *
+   * \brief Tests if a contiguous array of T can be written and read back
+   * with a single memcpy.
+   *
+   * gl_is_trivially_serializable<T>::value is true if T is a POD type
+   * (see gl_is_pod), a scalar, or a std::pair of such types nested to
+   * any depth. The buffered exchanges use it to send values as raw
+   * bytes. The bytes written are the in-memory representation of T,
+   * including any padding, so only peers running the same build can
+   * read them. std::vector and anything stored on disk keep writing
+   * pairs element by element.
+   */
+  template <typename T>
+  struct gl_is_trivially_serializable {
+    BOOST_STATIC_CONSTANT(bool, value = gl_is_pod_or_scaler<T>::value);
+  };
+
+  template <typename T, typename U>
+  struct gl_is_trivially_serializable<std::pair<T, U> > {
+    BOOST_STATIC_CONSTANT(bool, value =
+                          (
+                           boost::type_traits::ice_and<
+                             gl_is_trivially_serializable<T>::value,
+                             gl_is_trivially_serializable<U>::value>::value
+                          ));
+  };
+
+  /// \internal
+  template <bool IsPOD>
+  struct conditional_pod_type { };
+
+  /**
+   * \ingroup group_serialization
+   * \brief Inheriting from conditional_pod_type<true> is the same as
+   * inheriting from IS_POD_TYPE. Templated records whose members may or
+   * may not be POD can use this to opt into the POD serializer only when
+   * it is safe to do so. For instance:
+   * \code
+   * template <typename DataType>
+   * struct record :
+   *   public conditional_pod_type<gl_is_pod_or_scaler<DataType>::value> {
+   *   size_t id;
+   *   DataType data;
+   *   // save() and load() are used only if DataType is not a POD
+   *   void save(oarchive& oarc) const { oarc << id << data; }
+   *   void load(iarchive& iarc) { iarc >> id >> data; }
+   * };
+   * \endcode
+   */
+  template <>
+  struct conditional_pod_type<true> : public IS_POD_TYPE { };
+
+  /**
+   * \ingroup group_serialization
+   * \brief True if both T and U are trivially serializable and a struct
+   * holding a T followed by a U has no padding. Such a struct costs no
+   * more bytes as a raw copy than when it is written field by field.
+   */
+  template <typename T, typename U>
+  struct gl_is_packed_pod_pair {
+    BOOST_STATIC_CONSTANT(bool, value =
+                          (
+                           boost::type_traits::ice_and<
+                             gl_is_trivially_serializable<std::pair<T, U> >::value,
+                             sizeof(std::pair<T, U>) == sizeof(T) + sizeof(U)
+                             >::value
+                          ));
+  };
 }
 
 #endif
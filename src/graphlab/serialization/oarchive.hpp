@@ -31,6 +31,7 @@
 #define GRAPHLAB_OARCHIVE_HPP
 
 #include <iostream>
+#include <algorithm>
 #include <string>
 #include <graphlab/logger/assertions.hpp>
 #include <graphlab/serialization/is_pod.hpp>
@@ -102,6 +103,19 @@ namespace graphlab {
           buf = (char*)realloc(buf, len);
         }
      }
+
+    /**
+     * Makes room for at least "s" more bytes so that they can be written
+     * without reallocating. Has no effect when writing to a stream.
+     * Like expand_buf(), the buffer at least doubles so that a sequence
+     * of reservations does not reallocate each time.
+     */
+    inline void reserve(size_t s) {
+      if (out == NULL && off + s > len) {
+        len = std::max(off + s, 2 * len);
+        buf = (char*)realloc(buf, len);
+      }
+    }
     /** Directly writes "s" bytes from the memory location
      * pointed to by "c" into the stream.
      */
@@ -177,6 +191,10 @@ namespace graphlab {
       oarc->direct_assign(t);
     }
 
+    inline void reserve(size_t s) {
+      oarc->reserve(s);
+    }
+
     inline bool fail() {
       return oarc->fail();
     }
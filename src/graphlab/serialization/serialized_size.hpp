@@ -0,0 +1,109 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_SERIALIZED_SIZE_HPP
+#define GRAPHLAB_SERIALIZED_SIZE_HPP
+#include <string>
+#include <vector>
+#include <utility>
+#include <graphlab/serialization/is_pod.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup group_serialization
+   *
+   * \brief Estimates the number of bytes an oarchive writes for a value.
+   *
+   * serialized_size<T>::get(t) returns an upper bound on the bytes
+   * written by <code>oarc << t</code>. It is used to reserve the
+   * capacity of an in-memory oarchive once, instead of letting it
+   * grow by repeated reallocation while a large container is written.
+   *
+   * serialized_size<T>::is_known is false when no cheap bound exists
+   * (for instance for user classes with a save() function). get()
+   * then returns 0.
+   *
+   * POD types, std::string, std::pair and std::vector are covered.
+   * Other types may specialize the trait.
+   */
+  template <typename T,
+            bool IsPOD = gl_is_pod_or_scaler<T>::value>
+  struct serialized_size {
+    static const bool is_known = false;
+    static size_t get(const T&) { return 0; }
+  };
+
+  /// POD types are written as raw bytes. size_t and unsigned long
+  /// carry an extra tag byte.
+  template <typename T>
+  struct serialized_size<T, true> {
+    static const bool is_known = true;
+    static size_t get(const T&) { return sizeof(T) + 1; }
+  };
+
+  /// A std::string is its length followed by its characters
+  template <>
+  struct serialized_size<std::string, false> {
+    static const bool is_known = true;
+    static size_t get(const std::string& s) {
+      return sizeof(size_t) + 1 + s.length();
+    }
+  };
+
+  template <typename T, typename U>
+  struct serialized_size<std::pair<T, U>, false> {
+    static const bool is_known = serialized_size<T>::is_known &&
+                                 serialized_size<U>::is_known;
+    static size_t get(const std::pair<T, U>& p) {
+      return serialized_size<T>::get(p.first) +
+             serialized_size<U>::get(p.second);
+    }
+  };
+
+  /**
+   * A vector of POD values is its length followed by one block of
+   * bytes. Otherwise the length is written twice, followed by the
+   * elements one by one.
+   */
+  template <typename T>
+  struct serialized_size<std::vector<T>, false> {
+    static const bool is_known = serialized_size<T>::is_known;
+    static size_t get(const std::vector<T>& v) {
+      size_t ret = sizeof(size_t) + 1;
+      if (gl_is_pod_or_scaler<T>::value) {
+        ret += sizeof(T) * v.size();
+      } else if (is_known) {
+        ret += sizeof(size_t) + 1;
+        for (size_t i = 0;i < v.size(); ++i) {
+          ret += serialized_size<T>::get(v[i]);
+        }
+      }
+      return ret;
+    }
+  };
+
+} // namespace graphlab
+
+#endif
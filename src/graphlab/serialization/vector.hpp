@@ -27,6 +27,7 @@
 #include <graphlab/serialization/iarchive.hpp>
 #include <graphlab/serialization/oarchive.hpp>
 #include <graphlab/serialization/iterator.hpp>
+#include <graphlab/serialization/serialized_size.hpp>
 
 
 namespace graphlab {
@@ -71,7 +72,9 @@ namespace graphlab {
     template <typename OutArcType, typename ValueType>
     struct vector_serialize_impl<OutArcType, ValueType, true > {
       static void exec(OutArcType& oarc, const std::vector<ValueType>& vec) {
+        oarc.reserve(serialized_size<std::vector<ValueType> >::get(vec));
         oarc << size_t(vec.size());
+        if (vec.empty()) return;
         serialize(oarc, &(vec[0]),sizeof(ValueType)*vec.size());
       }
     };
@@ -94,6 +97,7 @@ namespace graphlab {
         size_t len;
         iarc >> len;
         vec.clear(); vec.resize(len);
+        if (len == 0) return;
         deserialize(iarc, &(vec[0]), sizeof(ValueType)*vec.size());
       }
     };
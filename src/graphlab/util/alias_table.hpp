@@ -0,0 +1,122 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_ALIAS_TABLE_HPP
+#define GRAPHLAB_ALIAS_TABLE_HPP
+#include <vector>
+#include <stdint.h>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/util/random.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup random
+   * \brief Draws from a fixed discrete distribution in constant time.
+   *
+   * The table is built from non-negative weights in O(n) using Vose's
+   * variant of Walker's alias method. Each draw then takes a single
+   * uniform random number: its integer part selects a column, and its
+   * fraction chooses between the column and its alias.
+   *
+   * The weights are kept so that the probability of a draw can be
+   * evaluated later, for instance in the acceptance ratio of a
+   * Metropolis-Hastings step which uses the table as its proposal.
+   */
+  class alias_table {
+  public:
+    alias_table() : total_weight(0) { }
+
+    template <typename Double>
+    explicit alias_table(const std::vector<Double>& weights) :
+      total_weight(0) {
+      build(weights);
+    }
+
+    /** Rebuilds the table from the weights, which must not all be 0 */
+    template <typename Double>
+    void build(const std::vector<Double>& new_weights) {
+      const size_t n = new_weights.size();
+      weights.assign(new_weights.begin(), new_weights.end());
+      total_weight = 0;
+      for (size_t i = 0; i < n; ++i) {
+        ASSERT_GE(weights[i], 0);
+        total_weight += weights[i];
+      }
+      ASSERT_GT(total_weight, 0);
+      prob.resize(n);
+      alias.resize(n);
+      std::vector<double> scaled(n);
+      std::vector<uint32_t> small, large;
+      for (size_t i = 0; i < n; ++i) {
+        scaled[i] = weights[i] * n / total_weight;
+        if (scaled[i] < 1) small.push_back(i);
+        else large.push_back(i);
+      }
+      while (!small.empty() && !large.empty()) {
+        const uint32_t s = small.back(); small.pop_back();
+        const uint32_t l = large.back(); large.pop_back();
+        prob[s] = scaled[s];
+        alias[s] = l;
+        scaled[l] = (scaled[l] + scaled[s]) - 1;
+        if (scaled[l] < 1) small.push_back(l);
+        else large.push_back(l);
+      }
+      // Whatever remains is 1 up to rounding
+      for (size_t i = 0; i < large.size(); ++i) {
+        prob[large[i]] = 1; alias[large[i]] = large[i];
+      }
+      for (size_t i = 0; i < small.size(); ++i) {
+        prob[small[i]] = 1; alias[small[i]] = small[i];
+      }
+    }
+
+    /** Returns the number of outcomes */
+    size_t size() const { return weights.size(); }
+
+    /** Returns true if the table has not been built */
+    bool empty() const { return weights.empty(); }
+
+    /** Returns the weight of outcome i the table was built from */
+    double weight(size_t i) const { return weights[i]; }
+
+    /** Returns the sum of the weights */
+    double total() const { return total_weight; }
+
+    /** Draws an outcome with probability weight(i) / total() */
+    size_t sample() const {
+      DASSERT_FALSE(empty());
+      const double u = random::uniform<double>(0, weights.size());
+      size_t i = size_t(u);
+      if (i >= weights.size()) i = weights.size() - 1;
+      return (u - i) < prob[i] ? i : alias[i];
+    }
+
+  private:
+    std::vector<float> weights;
+    std::vector<float> prob;
+    std::vector<uint32_t> alias;
+    double total_weight;
+  }; // end of alias_table
+
+} // namespace graphlab
+#endif
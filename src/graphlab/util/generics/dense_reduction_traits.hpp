@@ -0,0 +1,142 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_DENSE_REDUCTION_TRAITS_HPP
+#define GRAPHLAB_DENSE_REDUCTION_TRAITS_HPP
+#include <vector>
+#include <boost/type_traits/is_arithmetic.hpp>
+#include <boost/type_traits/is_base_of.hpp>
+#include <boost/static_assert.hpp>
+#include <graphlab/serialization/is_pod.hpp>
+#include <graphlab/parallel/atomic.hpp>
+
+namespace graphlab {
+
+  /// \internal
+  struct IS_DENSE_SUM_TYPE_BASE : public IS_POD_TYPE { };
+
+  /**
+   * \brief Inheriting from IS_DENSE_SUM_TYPE<V> declares that the
+   * derived type holds nothing but members of the arithmetic type V and
+   * that its operator+= sums them elementwise.
+   *
+   * The type is serialized as a POD, as with IS_POD_TYPE, and
+   * aggregators of the type are summed in place with
+   * dc_dist_object::all_reduce_dense().
+   * \code
+   * struct error_aggregator : public graphlab::IS_DENSE_SUM_TYPE<double> {
+   *   double train_error, validation_error;
+   *   ...
+   * };
+   * \endcode
+   */
+  template <typename V>
+  struct IS_DENSE_SUM_TYPE : public IS_DENSE_SUM_TYPE_BASE {
+    typedef V dense_value_type;
+  };
+
+  /**
+   * Treats a POD struct containing only members of type V as a fixed
+   * length array of V.
+   */
+  template <typename T, typename V>
+  struct pod_dense_reduction_traits {
+    BOOST_STATIC_ASSERT(sizeof(T) % sizeof(V) == 0);
+    static const bool is_dense = boost::is_arithmetic<V>::value;
+    static const bool is_fixed_size = true;
+    typedef V value_type;
+    static size_t size(const T&) { return sizeof(T) / sizeof(V); }
+    static void resize(T&, size_t) { }
+    static V* data(T& t) { return reinterpret_cast<V*>(&t); }
+  };
+
+  /**
+   * Treats a std::vector<E> of an arithmetic type E as an array of E.
+   */
+  template <typename E>
+  struct vector_dense_reduction_traits {
+    static const bool is_dense = boost::is_arithmetic<E>::value;
+    static const bool is_fixed_size = false;
+    typedef E value_type;
+    static size_t size(const std::vector<E>& v) { return v.size(); }
+    static void resize(std::vector<E>& v, size_t n) { v.resize(n); }
+    static E* data(std::vector<E>& v) { return v.empty() ? NULL : &(v[0]); }
+  };
+
+  /**
+   * graphlab::atomic<V> holds nothing but the value, so a vector of
+   * atomics can be summed as a plain array of V. The reduction must not
+   * run concurrently with other writers of the vector.
+   */
+  template <typename V>
+  struct vector_dense_reduction_traits<atomic<V> > {
+    BOOST_STATIC_ASSERT(sizeof(atomic<V>) == sizeof(V));
+    static const bool is_dense = boost::is_arithmetic<V>::value;
+    static const bool is_fixed_size = false;
+    typedef V value_type;
+    static size_t size(const std::vector<atomic<V> >& v) { return v.size(); }
+    static void resize(std::vector<atomic<V> >& v, size_t n) { v.resize(n); }
+    static V* data(std::vector<atomic<V> >& v) {
+      return v.empty() ? NULL : reinterpret_cast<V*>(&(v[0]));
+    }
+  };
+
+  /**
+   * \brief Describes types whose operator+= is an elementwise sum over a
+   * contiguous array of arithmetic values.
+   *
+   * Such types can be reduced with
+   * dc_dist_object::all_reduce_dense(), which sums the raw array in
+   * place instead of going through generic serialization and
+   * operator+=, and the aggregators then use it in place of the
+   * generic reduction. The default is "not dense": a type opts in by
+   * inheriting from IS_DENSE_SUM_TYPE, or by specializing this trait
+   * with pod_dense_reduction_traits or vector_dense_reduction_traits.
+   * Nothing opts in on its own, since the operator+= of a std::vector
+   * is whatever the user defined it to be. Specializations expose
+   *  - \c is_dense: true
+   *  - \c is_fixed_size: true if all instances have the same length.
+   *    Otherwise the machines first agree on the longest length.
+   *  - \c value_type: the arithmetic element type
+   *  - \c size(t), \c resize(t, n) and \c data(t)
+   *
+   * For instance, an aggregator of counts summed elementwise:
+   * \code
+   * namespace graphlab {
+   *   template <>
+   *   struct dense_reduction_traits<std::vector<double> >
+   *     : public vector_dense_reduction_traits<double> { };
+   * }
+   * \endcode
+   */
+  template <typename T,
+            bool IsDenseSum = boost::is_base_of<IS_DENSE_SUM_TYPE_BASE, T>::value>
+  struct dense_reduction_traits {
+    static const bool is_dense = false;
+  };
+
+  template <typename T>
+  struct dense_reduction_traits<T, true>
+    : public pod_dense_reduction_traits<T, typename T::dense_value_type> { };
+
+} // namespace graphlab
+#endif
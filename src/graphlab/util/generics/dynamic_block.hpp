@@ -110,6 +110,11 @@ namespace graphlab {
        return _next;
      }
 
+     /// returns a pointer to the contiguous values of the block
+     const valuetype* data() const {
+       return values;
+     }
+
      void clear() {
        _size = 0;
      }
@@ -0,0 +1,151 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_HYPERLOGLOG_HPP
+#define GRAPHLAB_HYPERLOGLOG_HPP
+#include <cmath>
+#include <cstring>
+#include <stdint.h>
+#include <boost/static_assert.hpp>
+#include <graphlab/serialization/is_pod.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup util
+   * \brief A HyperLogLog counter which estimates the number of distinct
+   * keys added to it, or to any of the counters merged into it.
+   *
+   * The counter has 2^Precision registers and a relative standard error
+   * of about 1.04 / sqrt(2^Precision). Each register is a byte, and the
+   * registers are packed eight to a 64 bit word in a fixed size array,
+   * so a counter can be kept inline in vertex data and is serialized as
+   * a POD. Merging two counters takes the register-wise maximum. It is
+   * computed a word at a time with broadword arithmetic and no branches,
+   * which the compiler further vectorizes.
+   *
+   * Keys are hashed with a 64 bit mixing function, so the top Precision
+   * bits of the hash select a register and the remaining bits keep the
+   * rank below 128.
+   */
+  template <size_t Precision>
+  class hyperloglog : public IS_POD_TYPE {
+    BOOST_STATIC_ASSERT(Precision >= 4 && Precision <= 16);
+  public:
+    enum { NUM_REGISTERS = 1 << Precision, NUM_WORDS = NUM_REGISTERS / 8 };
+
+    /** Creates an empty counter */
+    hyperloglog() { clear(); }
+
+    /** Empties the counter */
+    void clear() { memset(words, 0, sizeof(words)); }
+
+    /** Adds a key */
+    void add(uint64_t key) { add_hash(hash(key)); }
+
+    /** Adds a key which has already been hashed */
+    void add_hash(uint64_t h) {
+      const size_t idx = h >> (64 - Precision);
+      // the guard bit bounds the rank by 64 - Precision + 1
+      const uint64_t rest = (h << Precision) | (uint64_t(1) << (Precision - 1));
+      const uint64_t rank = __builtin_clzll(rest) + 1;
+      uint64_t& word = words[idx / 8];
+      const size_t shift = 8 * (idx % 8);
+      if (((word >> shift) & 0xFF) < rank) {
+        word = (word & ~(uint64_t(0xFF) << shift)) | (rank << shift);
+      }
+    }
+
+    /** Returns register i */
+    size_t get(size_t i) const { return (words[i / 8] >> (8 * (i % 8))) & 0xFF; }
+
+    /** Merges the other counter into this one */
+    hyperloglog& operator|=(const hyperloglog& other) {
+      for (size_t i = 0; i < NUM_WORDS; ++i) {
+        words[i] = byte_max(words[i], other.words[i]);
+      }
+      return *this;
+    }
+
+    /** A synonym for operator|=, so that the counter is a gather type */
+    hyperloglog& operator+=(const hyperloglog& other) { return (*this) |= other; }
+
+    bool operator==(const hyperloglog& other) const {
+      return memcmp(words, other.words, sizeof(words)) == 0;
+    }
+
+    bool operator!=(const hyperloglog& other) const { return !(*this == other); }
+
+    /** Returns the estimated number of distinct keys */
+    double estimate() const {
+      const double m = NUM_REGISTERS;
+      double sum = 0;
+      size_t zeros = 0;
+      for (size_t i = 0; i < NUM_REGISTERS; ++i) {
+        const size_t r = get(i);
+        sum += std::ldexp(1.0, -int(r));
+        zeros += (r == 0);
+      }
+      const double e = alpha() * m * m / sum;
+      // linear counting is more accurate for small cardinalities
+      if (e <= 2.5 * m && zeros > 0) return m * std::log(m / zeros);
+      return e;
+    }
+
+    /** A 64 bit mixing function (the finalizer of MurmurHash3) */
+    static uint64_t hash(uint64_t x) {
+      x ^= x >> 33;
+      x *= 0xff51afd7ed558ccdULL;
+      x ^= x >> 33;
+      x *= 0xc4ceb9fe1a85ec53ULL;
+      x ^= x >> 33;
+      return x;
+    }
+
+  private:
+    uint64_t words[NUM_WORDS];
+
+    static double alpha() {
+      switch (NUM_REGISTERS) {
+        case 16: return 0.673;
+        case 32: return 0.697;
+        case 64: return 0.709;
+        default: return 0.7213 / (1.0 + 1.079 / NUM_REGISTERS);
+      }
+    }
+
+    /**
+     * The byte-wise maximum of two words of registers.  Registers are
+     * below 128, so adding 128 to each byte of x and subtracting the
+     * byte of y never borrows, and leaves the high bit of the byte set
+     * exactly where x >= y.
+     */
+    static uint64_t byte_max(uint64_t x, uint64_t y) {
+      const uint64_t high = 0x8080808080808080ULL;
+      const uint64_t ge = ((x | high) - y) & high;
+      const uint64_t mask = (ge >> 7) * 0xFF;
+      return (x & mask) | (y & ~mask);
+    }
+  }; // end of hyperloglog
+
+} // namespace graphlab
+#endif
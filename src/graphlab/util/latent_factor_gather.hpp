@@ -0,0 +1,200 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_LATENT_FACTOR_GATHER_HPP
+#define GRAPHLAB_LATENT_FACTOR_GATHER_HPP
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/serialization/iarchive.hpp>
+#include <graphlab/serialization/oarchive.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup util
+   * \brief A gather type which accumulates the normal equations X'X and
+   * X'y of a least squares problem over latent factors of a fixed rank.
+   *
+   * Alternating least squares vertex programs gather, for each neighbor
+   * with factor x and observation y, the rank-1 term (w x x', w y x) and
+   * sum the terms. Returning each term as a dense matrix allocates and
+   * adds a rank x rank matrix per edge. Instead, the value returned by
+   * gather is a view of the neighbor's factor, and operator+= applies it
+   * to the accumulator as an in place rank-1 update:
+   * \code
+   * latent_factor_gather gather(icontext_type& context,
+   *                             const vertex_type& vertex,
+   *                             edge_type& edge) const {
+   *   const vertex_data& nbr = get_other_vertex(edge, vertex).data();
+   *   return latent_factor_gather(nbr.factor.data(), nbr.factor.size(),
+   *                               edge.data().obs);
+   * }
+   * \endcode
+   * A view is only valid while the factor it points to is, so copying,
+   * assigning or serializing a view materializes it. An accumulator
+   * therefore never refers to vertex data.
+   *
+   * The accumulator keeps the packed upper triangle of X'X followed by
+   * X'y in one cache line aligned buffer, allocated once. Row i of the
+   * triangle holds the entries (i, i) to (i, rank - 1). The update loops
+   * run over contiguous rows so that the compiler vectorizes them, and
+   * the buffer is serialized as a raw array.
+   */
+  class latent_factor_gather {
+  public:
+    /** Creates an empty accumulator, the identity of operator+= */
+    latent_factor_gather() :
+      rank(0), storage(NULL), view(NULL), obs(0), weight(0) { }
+
+    /**
+     * Creates a view of the term (weight x x', weight y x) for a factor
+     * x of length rank. x must outlive the view.
+     */
+    latent_factor_gather(const double* x, size_t rank, double y,
+                         double weight = 1.0) :
+      rank(rank), storage(NULL), view(x), obs(y), weight(weight) { }
+
+    latent_factor_gather(const latent_factor_gather& other) :
+      rank(0), storage(NULL), view(NULL), obs(0), weight(0) {
+      (*this) += other;
+    }
+
+    latent_factor_gather& operator=(const latent_factor_gather& other) {
+      if (this != &other) {
+        clear();
+        (*this) += other;
+      }
+      return *this;
+    }
+
+    ~latent_factor_gather() { clear(); }
+
+    /** Returns true if nothing has been accumulated */
+    bool empty() const { return rank == 0; }
+
+    /** Returns the length of the factors */
+    size_t size() const { return rank; }
+
+    /** Returns entry (i, j) of X'X */
+    double xtx(size_t i, size_t j) const {
+      DASSERT_TRUE(view == NULL);
+      if (i > j) std::swap(i, j);
+      return storage[i * rank - i * (i - 1) / 2 + (j - i)];
+    }
+
+    /** Returns entry i of X'y */
+    double xty(size_t i) const {
+      DASSERT_TRUE(view == NULL);
+      return storage[packed_size(rank) + i];
+    }
+
+    /** Adds the terms of the other accumulator or view */
+    latent_factor_gather& operator+=(const latent_factor_gather& other) {
+      if (other.empty()) return *this;
+      if (view != NULL) materialize();
+      if (empty()) allocate(other.rank);
+      ASSERT_EQ(rank, other.rank);
+      if (other.view != NULL) {
+        add_rank1(other.view, other.obs, other.weight);
+      } else {
+        const size_t len = buffer_size(rank);
+        const double* src = other.storage;
+        for (size_t i = 0; i < len; ++i) storage[i] += src[i];
+      }
+      return *this;
+    }
+
+    void save(oarchive& oarc) const {
+      if (view != NULL) {
+        latent_factor_gather owned(*this);
+        owned.save(oarc);
+        return;
+      }
+      oarc << rank;
+      if (rank > 0) serialize(oarc, storage, sizeof(double) * buffer_size(rank));
+    }
+
+    void load(iarchive& iarc) {
+      clear();
+      size_t len;
+      iarc >> len;
+      if (len > 0) {
+        allocate(len);
+        deserialize(iarc, storage, sizeof(double) * buffer_size(rank));
+      }
+    }
+
+  private:
+    size_t rank;
+    double* storage;
+    const double* view;
+    double obs;
+    double weight;
+
+    static size_t packed_size(size_t n) { return n * (n + 1) / 2; }
+    static size_t buffer_size(size_t n) { return packed_size(n) + n; }
+
+    void clear() {
+      free(storage);
+      rank = 0; storage = NULL; view = NULL;
+    }
+
+    /** Allocates a zeroed buffer for factors of length n */
+    void allocate(size_t n) {
+      ASSERT_TRUE(storage == NULL);
+      void* ptr = NULL;
+      const size_t bytes = sizeof(double) * buffer_size(n);
+      const int ret = posix_memalign(&ptr, 64, bytes);
+      ASSERT_EQ(ret, 0);
+      memset(ptr, 0, bytes);
+      storage = reinterpret_cast<double*>(ptr);
+      rank = n;
+    }
+
+    void materialize() {
+      const double* x = view;
+      view = NULL;
+      const size_t n = rank;
+      rank = 0;
+      allocate(n);
+      add_rank1(x, obs, weight);
+    }
+
+    /** X'X += w x x' on the upper triangle, X'y += w y x */
+    void add_rank1(const double* x, double y, double w) {
+      double* row = storage;
+      for (size_t i = 0; i < rank; ++i) {
+        const double a = w * x[i];
+        const double* xi = x + i;
+        const size_t len = rank - i;
+        for (size_t j = 0; j < len; ++j) row[j] += a * xi[j];
+        row += len;
+      }
+      const double wy = w * y;
+      for (size_t i = 0; i < rank; ++i) row[i] += wy * x[i];
+    }
+  }; // end of latent_factor_gather
+
+} // namespace graphlab
+#endif
@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_SHARDED_HOPSCOTCH_MAP_HPP
+#define GRAPHLAB_SHARDED_HOPSCOTCH_MAP_HPP
+#include <vector>
+#include <boost/functional/hash.hpp>
+#include <graphlab/util/hopscotch_map.hpp>
+#include <graphlab/util/integer_mix.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+
+namespace graphlab {
+
+/**
+ * \ingroup util_internal
+ * A concurrent map made of independently locked hopscotch_map shards.
+ * Each operation locks exactly one shard with a spinlock, so threads
+ * touching different shards never contend. The shard is picked from a
+ * mix of the key hash, so keys which share their low bits (for instance
+ * all the keys a dht machine owns) still spread over all shards.
+ *
+ * The interface returns values by copy, so no reference into a shard
+ * escapes its lock.
+ */
+template <typename Key, typename Value,
+          typename Hash = boost::hash<Key> >
+class sharded_hopscotch_map {
+ public:
+  typedef hopscotch_map<Key, Value, Hash> shard_type;
+  typedef Key key_type;
+  typedef Value value_type;
+
+ private:
+  std::vector<shard_type> shards;
+  std::vector<simple_spinlock> locks;
+  size_t shardmask;
+  Hash hasher;
+
+  size_t shard_of(const Key& key) const {
+    size_t h = hasher(key);
+    return integer_mix((uint32_t)(h ^ (h >> 32))) & shardmask;
+  }
+
+ public:
+  /// Creates a map with the number of shards rounded up to a power of two
+  explicit sharded_hopscotch_map(size_t numshards = 64) {
+    size_t n = 1;
+    while (n < numshards) n *= 2;
+    shards.resize(n);
+    locks.resize(n);
+    shardmask = n - 1;
+  }
+
+  /// Returns (true, value) if the key is present, (false, undefined) otherwise
+  std::pair<bool, Value> get(const Key& key) const {
+    size_t b = shard_of(key);
+    std::pair<bool, Value> ret;
+    locks[b].lock();
+    typename shard_type::const_iterator iter = shards[b].find(key);
+    ret.first = iter != shards[b].end();
+    if (ret.first) ret.second = iter->second;
+    locks[b].unlock();
+    return ret;
+  }
+
+  /// Associates the value with the key
+  void set(const Key& key, const Value& val) {
+    size_t b = shard_of(key);
+    locks[b].lock();
+    shards[b][key] = val;
+    locks[b].unlock();
+  }
+
+  /// Removes the key. Returns true if it was present
+  bool erase(const Key& key) {
+    size_t b = shard_of(key);
+    locks[b].lock();
+    bool ret = shards[b].erase(key);
+    locks[b].unlock();
+    return ret;
+  }
+
+  size_t size() const {
+    size_t ret = 0;
+    for (size_t i = 0; i < shards.size(); ++i) {
+      locks[i].lock();
+      ret += shards[i].size();
+      locks[i].unlock();
+    }
+    return ret;
+  }
+
+  size_t num_shards() const {
+    return shards.size();
+  }
+
+  /// Not safe to call concurrently with other operations
+  void clear() {
+    for (size_t i = 0; i < shards.size(); ++i) shards[i].clear();
+  }
+};
+
+} // namespace graphlab
+#endif
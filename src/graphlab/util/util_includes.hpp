@@ -25,6 +25,7 @@
 #include <graphlab/util/binary_parser.hpp>
 #include <graphlab/util/timer.hpp>
 #include <graphlab/util/random.hpp>
+#include <graphlab/util/alias_table.hpp>
 #include <graphlab/util/small_set.hpp>
 // #include <graphlab/util/charstream.hpp>
 // #include <graphlab/util/cache.hpp>
@@ -32,4 +33,6 @@
 #include <graphlab/util/hdfs.hpp>
 #include <graphlab/util/mpi_tools.hpp>
 #include <graphlab/util/empty.hpp>
+#include <graphlab/util/latent_factor_gather.hpp>
+#include <graphlab/util/hyperloglog.hpp>
 #include <graphlab/util/web_util.hpp>
@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_STATIC_EDGE_TRAITS_HPP
+#define GRAPHLAB_STATIC_EDGE_TRAITS_HPP
+#include <graphlab/graph/graph_basic_types.hpp>
+
+namespace graphlab {
+
+  /**
+   * \brief Declares at compile time the edges a vertex program gathers
+   * and scatters on.
+   *
+   * By default the engine asks every vertex program for
+   * ivertex_program::gather_edges() and ivertex_program::scatter_edges()
+   * and then calls the virtual gather and scatter through the generic
+   * edge iterators. A vertex program which always gathers on the same
+   * edges can opt in to a specialized path, where the synchronous_engine
+   * walks the local adjacency arrays directly and calls gather, scatter
+   * and scatter_edges without virtual dispatch, so that a small gather
+   * is inlined into the edge loop:
+   * \code
+   * namespace graphlab {
+   *   template <>
+   *   struct static_edge_traits<pagerank>
+   *     : public static_gather_dir<IN_EDGES> { };
+   * }
+   * \endcode
+   * A vertex program whose scatter direction is fixed as well derives
+   * from static_edge_dirs<GatherDir, ScatterDir> instead, and
+   * scatter_edges() is then not called at all.
+   *
+   * By opting in, the vertex program also promises that a default
+   * constructed gather_type is the identity of its operator+= (0 for a
+   * sum, +infinity for a min), and that pre_local_gather() leaves the
+   * accumulator unchanged. The engine then starts from gather_type() and
+   * adds every edge, rather than branching on the first edge. This suits
+   * small POD gather types best.
+   *
+   * The runtime gather_edges() and scatter_edges() are still checked
+   * against the declared directions in debug builds.
+   */
+  template <typename VertexProgram>
+  struct static_edge_traits {
+    static const bool is_static = false;
+    static const bool is_static_scatter = false;
+    static const edge_dir_type gather_dir = ALL_EDGES;
+    static const edge_dir_type scatter_dir = ALL_EDGES;
+  };
+
+  /**
+   * Base class for static_edge_traits specializations which fix the
+   * gather direction only.
+   */
+  template <edge_dir_type GatherDir>
+  struct static_gather_dir {
+    static const bool is_static = true;
+    static const bool is_static_scatter = false;
+    static const edge_dir_type gather_dir = GatherDir;
+    static const edge_dir_type scatter_dir = ALL_EDGES;
+  };
+
+  /**
+   * Base class for static_edge_traits specializations which fix both
+   * the gather and the scatter directions.
+   */
+  template <edge_dir_type GatherDir, edge_dir_type ScatterDir>
+  struct static_edge_dirs {
+    static const bool is_static = true;
+    static const bool is_static_scatter = true;
+    static const edge_dir_type gather_dir = GatherDir;
+    static const edge_dir_type scatter_dir = ScatterDir;
+  };
+
+} // namespace graphlab
+#endif
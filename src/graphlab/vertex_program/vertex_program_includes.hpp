@@ -25,5 +25,6 @@
 #include <graphlab/vertex_program/ivertex_program.hpp>
 #include <graphlab/vertex_program/messages.hpp>
 #include <graphlab/vertex_program/icontext.hpp>
+#include <graphlab/vertex_program/static_edge_traits.hpp>
 
 
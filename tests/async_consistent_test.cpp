@@ -28,6 +28,7 @@
 // #include <cxxtest/TestSuite.h>
 
 #include <graphlab.hpp>
+#include <graphlab/macros_def.hpp>
 
 typedef graphlab::distributed_graph<int,int> graph_type;
 
@@ -150,6 +151,91 @@ void test_all_neighbors(graphlab::distributed_control& dc,
 
 
 
+/*
+ * Full consistency. Each vertex sums its neighbors in gather and checks
+ * in apply that the sum still holds, then signals its neighbors for a few
+ * rounds so that neighboring updates keep overlapping. Only vertices with
+ * no mirrors see all their neighbors locally, so only those are checked.
+ * With the gather cache, each update posts its increment to the cached
+ * sums of its neighbors.
+ */
+graph_type* exclusion_graph = NULL;
+bool exclusion_post_deltas = false;
+
+class neighborhood_sum :
+  public graphlab::ivertex_program<graph_type, int>,
+  public graphlab::IS_POD_TYPE {
+public:
+  edge_dir_type
+  gather_edges(icontext_type& context, const vertex_type& vertex) const {
+    return graphlab::ALL_EDGES;
+  }
+  gather_type
+  gather(icontext_type& context, const vertex_type& vertex,
+         edge_type& edge) const {
+    // a slow gather leaves neighbors time to update in between
+    volatile double x = 1;
+    for (size_t i = 0;i < 50000; ++i) x *= 1.0000001;
+    return edge.source().id() == vertex.id() ? edge.target().data()
+                                             : edge.source().data();
+  }
+  void apply(icontext_type& context, vertex_type& vertex,
+             const gather_type& total) {
+    graph_type::local_vertex_type lvertex =
+        exclusion_graph->l_vertex(exclusion_graph->local_vid(vertex.id()));
+    if (lvertex.num_mirrors() == 0) {
+      int sum = 0;
+      foreach(graph_type::local_edge_type edge, lvertex.in_edges()) {
+        sum += edge.source().data();
+      }
+      foreach(graph_type::local_edge_type edge, lvertex.out_edges()) {
+        sum += edge.target().data();
+      }
+      ASSERT_EQ(total, sum);
+    }
+    ++vertex.data();
+  }
+  edge_dir_type
+  scatter_edges(icontext_type& context, const vertex_type& vertex) const {
+    return graphlab::ALL_EDGES;
+  }
+  void scatter(icontext_type& context, const vertex_type& vertex,
+               edge_type& edge) const {
+    const vertex_type other = edge.source().id() == vertex.id() ?
+      edge.target() : edge.source();
+    if (exclusion_post_deltas) context.post_delta(other, 1);
+    if (vertex.data() < 5) context.signal(other);
+  }
+}; // end of neighborhood sum
+
+void set_vertex_to_zero(graph_type::vertex_type vtx) {
+  vtx.data() = 0;
+}
+
+void test_neighborhood_exclusion(graphlab::distributed_control& dc,
+                                 graphlab::command_line_options& clopts,
+                                 graph_type& graph,
+                                 bool transactional,
+                                 bool use_cache) {
+  std::cout << "Constructing an engine for neighborhood exclusion"
+            << (transactional ? " with transactions" : "")
+            << (use_cache ? " with the gather cache" : "") << std::endl;
+  graphlab::graphlab_options opts = clopts;
+  opts.get_engine_args().set_option("factorized", false);
+  opts.get_engine_args().set_option("transactional", transactional);
+  opts.get_engine_args().set_option("use_cache", use_cache);
+  exclusion_graph = &graph;
+  exclusion_post_deltas = use_cache;
+  graph.transform_vertices(set_vertex_to_zero);
+  typedef graphlab::async_consistent_engine<neighborhood_sum> engine_type;
+  engine_type engine(dc, graph, opts);
+  engine.signal_all();
+  std::cout << "Running!" << std::endl;
+  engine.start();
+  std::cout << "Finished" << std::endl;
+}
+
+
 
 
 
@@ -328,6 +414,10 @@ int main(int argc, char** argv) {
   test_in_neighbors(dc, clopts, graph);
   test_out_neighbors(dc, clopts, graph);
   test_all_neighbors(dc, clopts, graph);
+  test_neighborhood_exclusion(dc, clopts, graph, false, false);
+  test_neighborhood_exclusion(dc, clopts, graph, true, false);
+  test_neighborhood_exclusion(dc, clopts, graph, false, true);
+  test_neighborhood_exclusion(dc, clopts, graph, true, true);
   test_aggregator(dc, clopts, graph);
   graphlab::mpi_tools::finalize();
 } // end of main
@@ -1,4 +1,11 @@
 #include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <unistd.h>
+#include <boost/bind.hpp>
 #include <graphlab/parallel/fiber_group.hpp>
 #include <graphlab/util/timer.hpp>
 using namespace graphlab;
@@ -24,7 +31,150 @@ void threadfn2() {
   }
 }
 
+
+/*
+ * Imbalanced load: a single fiber launches all the workers' fibers, so
+ * they all start out on its worker's queue. Without stealing, the other
+ * workers stay idle.
+ */
+const size_t NUM_IMBALANCED_FIBERS = 10000;
+const size_t YIELDS_PER_FIBER = 100;
+std::vector<double> start_latency;
+
+void busy_fiber(size_t id, double launch_time) {
+  start_latency[id] = timer::sec_of_day() - launch_time;
+  volatile double x = 1.0;
+  for (size_t i = 0;i < YIELDS_PER_FIBER; ++i) {
+    for (size_t j = 0;j < 200; ++j) x = x * 1.0000001;
+    fiber_control::yield();
+  }
+}
+
+void spawner(fiber_group* group) {
+  for (size_t i = 0;i < NUM_IMBALANCED_FIBERS; ++i) {
+    group->launch(boost::bind(busy_fiber, i, timer::sec_of_day()));
+  }
+}
+
+void print_worker_stats() {
+  fiber_control& fc = fiber_control::get_instance();
+  size_t steals = 0, failed = 0, idle = 0;
+  for (size_t i = 0;i < fc.num_workers(); ++i) {
+    fiber_control::worker_stats s = fc.get_worker_stats(i);
+    steals += s.steals; failed += s.failed_steals; idle += s.idle_waits;
+  }
+  std::cout << "  steals: " << steals << "  failed steal rounds: " << failed
+            << "  idle waits: " << idle << "\n";
+}
+
+void run_imbalanced(bool stealing) {
+  fiber_control& fc = fiber_control::get_instance();
+  fc.set_work_stealing(stealing);
+  fc.reset_worker_stats();
+  start_latency.assign(NUM_IMBALANCED_FIBERS, 0.0);
+  timer ti; ti.start();
+  fiber_group group;
+  fiber_group spawn_group;
+  spawn_group.launch(boost::bind(spawner, &group), 0);
+  spawn_group.join();
+  group.join();
+  double runtime = ti.current_time();
+
+  std::sort(start_latency.begin(), start_latency.end());
+  double mean = 0;
+  for (size_t i = 0;i < start_latency.size(); ++i) mean += start_latency[i];
+  mean /= start_latency.size();
+  std::cout << (stealing ? "With" : "Without") << " work stealing:\n"
+            << "  completion in " << runtime << "s, "
+            << NUM_IMBALANCED_FIBERS * YIELDS_PER_FIBER / runtime
+            << " context switches/s\n"
+            << "  launch to start latency: mean " << mean * 1000
+            << "ms, p99 " << start_latency[start_latency.size() * 99 / 100] * 1000
+            << "ms\n";
+  print_worker_stats();
+}
+
+
+/*
+ * Launch cost: many short fibers, launched in waves as the warp engine
+ * launches a fiber per task. Measured with the stack pool enabled and with
+ * every stack unmapped on exit, together with the resident set size once
+ * the launches settle.
+ */
+const size_t NUM_SHORT_FIBERS = 100000;
+const size_t FIBERS_PER_WAVE = 1000;
+volatile size_t short_fiber_sum = 0;
+
+void short_fiber(size_t i) {
+  // touch a few KB of stack, as a typical task would
+  char buf[4096];
+  memset(buf, (int)i, sizeof(buf));
+  __sync_fetch_and_add(&short_fiber_sum, (size_t)buf[i % sizeof(buf)]);
+}
+
+double resident_mb() {
+  size_t pages = 0, resident = 0;
+  std::ifstream fin("/proc/self/statm");
+  fin >> pages >> resident;
+  return double(resident) * sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+void run_launch_cost(size_t max_pooled) {
+  fiber_control& fc = fiber_control::get_instance();
+  fc.set_max_pooled_fibers(max_pooled);
+  fiber_control::stack_pool_stats before = fc.get_stack_pool_stats();
+  double resident_before = resident_mb();
+  const size_t rounds = 5;
+  double best = 1e10;
+  for (size_t r = 0;r < rounds; ++r) {
+    timer ti; ti.start();
+    fiber_group group;
+    group.set_stacksize(16384);
+    for (size_t i = 0;i < NUM_SHORT_FIBERS; ++i) {
+      group.launch(boost::bind(short_fiber, i));
+      if ((i + 1) % FIBERS_PER_WAVE == 0) group.join();
+    }
+    group.join();
+    best = std::min(best, ti.current_time());
+  }
+  fiber_control::stack_pool_stats after = fc.get_stack_pool_stats();
+  std::cout << "Pool of " << max_pooled << " fibers per worker:\n"
+            << "  launch + run + exit: " << best * 1e9 / NUM_SHORT_FIBERS
+            << " ns per fiber\n"
+            << "  reused launches: " << after.reused_launches - before.reused_launches
+            << "  mapped launches: " << after.allocated_launches - before.allocated_launches
+            << "\n  pooled fibers: " << after.pooled_fibers
+            << "  mapped stacks: " << after.mapped_stacks
+            << " (" << after.mapped_bytes / (1024 * 1024) << " MB reserved)"
+            << "  unguarded stacks: " << after.unguarded_stacks
+            << "\n  resident: " << resident_before << " MB before, "
+            << resident_mb() << " MB after\n";
+}
+
+
+/*
+ * Recurses until the stack runs out. The guard page below the stack
+ * turns this into an immediate, reported failure.
+ */
+size_t recurse(size_t depth) {
+  volatile char buf[512];
+  buf[0] = (char)depth;
+  return recurse(depth + 1) + buf[0];
+}
+
+void overflow_fiber() {
+  std::cout << recurse(0) << std::endl;
+}
+
 int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "--overflow") == 0) {
+    // expected to abort with a "Fiber stack overflow" message
+    fiber_group group;
+    group.set_stacksize(16384);
+    group.launch(overflow_fiber);
+    group.join();
+    return 0;
+  }
   timer ti; ti.start();
   fiber_group group;
   fiber_group group2;
@@ -38,4 +188,15 @@ int main(int argc, char** argv) {
   group2.join();
   std::cout << "Completion in " << ti.current_time() << "s\n";
   std::cout << "Context Switches: " << numticks << "\n";
+  print_worker_stats();
+
+  std::cout << "\n" << NUM_IMBALANCED_FIBERS << " fibers launched from one worker on "
+            << fiber_control::get_instance().num_workers() << " workers\n";
+  run_imbalanced(false);
+  run_imbalanced(true);
+
+  std::cout << "\n" << NUM_SHORT_FIBERS << " short fibers with 16KB stacks in waves of "
+            << FIBERS_PER_WAVE << "\n";
+  run_launch_cost(0);
+  run_launch_cost(1024);
 }
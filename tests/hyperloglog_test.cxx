@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <cmath>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/util/hyperloglog.hpp>
+
+
+class HyperLogLogTest: public CxxTest::TestSuite {
+ public:
+  void test_estimate() {
+    graphlab::hyperloglog<10> counter;
+    TS_ASSERT_EQUALS(counter.estimate(), 0);
+    for (size_t i = 0; i < 100000; ++i) counter.add(i);
+    // ten standard errors
+    TS_ASSERT_DELTA(counter.estimate() / 100000, 1.0, 10 * 1.04 / 32);
+    // adding the same keys again changes nothing
+    graphlab::hyperloglog<10> copy = counter;
+    for (size_t i = 0; i < 100000; ++i) copy.add(i);
+    TS_ASSERT(copy == counter);
+  }
+
+  void test_small_cardinality() {
+    graphlab::hyperloglog<6> counter;
+    for (size_t i = 0; i < 10; ++i) counter.add(i * 7919);
+    TS_ASSERT_DELTA(counter.estimate(), 10, 2);
+  }
+
+  void test_merge() {
+    graphlab::hyperloglog<8> a, b, both;
+    for (size_t i = 0; i < 5000; ++i) {
+      a.add(i);
+      both.add(i);
+    }
+    for (size_t i = 3000; i < 9000; ++i) {
+      b.add(i);
+      both.add(i);
+    }
+    graphlab::hyperloglog<8> merged = a;
+    merged |= b;
+    // the merge is the register-wise maximum
+    for (size_t i = 0; i < graphlab::hyperloglog<8>::NUM_REGISTERS; ++i) {
+      TS_ASSERT_EQUALS(merged.get(i), std::max(a.get(i), b.get(i)));
+    }
+    TS_ASSERT(merged == both);
+    merged |= a;
+    TS_ASSERT(merged == both);
+  }
+};
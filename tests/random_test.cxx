@@ -152,6 +152,28 @@ class RandomTestSuite: public CxxTest::TestSuite {
 
 
 
+  void test_alias_table() {
+    namespace random = graphlab::random;
+    random::seed(12345);
+    std::vector<double> weights(10);
+    for(size_t i = 0; i < weights.size(); ++i) weights[i] = double(i % 4);
+    graphlab::alias_table table(weights);
+    TS_ASSERT_EQUALS(table.size(), weights.size());
+    TS_ASSERT_DELTA(table.total(), 13, 1e-9);
+    const size_t ndraws = 1000000;
+    std::vector<size_t> counts(weights.size());
+    for(size_t i = 0; i < ndraws; ++i) ++counts[table.sample()];
+    for(size_t i = 0; i < weights.size(); ++i) {
+      if(weights[i] == 0) TS_ASSERT_EQUALS(counts[i], 0);
+      TS_ASSERT_DELTA(double(counts[i]) / ndraws,
+                      weights[i] / table.total(), 0.005);
+    }
+    // a single outcome
+    table.build(std::vector<double>(1, 0.5));
+    TS_ASSERT_EQUALS(table.sample(), 0);
+  }
+
+
   // void test_speed() {
   //   namespace random = graphlab::random;
   //   std::cout << "speed test run: " << std::endl;
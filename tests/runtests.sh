@@ -322,3 +322,15 @@ echo "---------distributed_graph_test-------------" >> $stderrfname
 mpiexec -n 2 -host $localhostname ./distributed_graph_test -b >> $stdoutfname 2>> $stderrfname
 quit_if_bad_retvalue
 rm -f dg*
+
+if [ -f ../toolkits/graph_analytics/kcore_decomposition ]; then
+  # On 2 machines, vertex 1 of data/kcore_tsv drops below the smallest
+  # degree bucket of its machine while K is 1.
+  echo "Testing K-core decomposition ..."
+  echo "---------kcore_decomposition-------------" >> $stdoutfname
+  echo "---------kcore_decomposition-------------" >> $stderrfname
+  mpiexec -n 2 -host $localhostname ../toolkits/graph_analytics/kcore_decomposition --graph=data/kcore_tsv --format=tsv --check=true >> $stdoutfname 2>> $stderrfname
+  quit_if_bad_retvalue
+  mpiexec -n 2 -host $localhostname ../toolkits/graph_analytics/kcore_decomposition --powerlaw=10000 --check=true >> $stdoutfname 2>> $stderrfname
+  quit_if_bad_retvalue
+fi
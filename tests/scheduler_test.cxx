@@ -21,35 +21,21 @@
  */
 
 
-#include <fstream>
+#include <iostream>
+#include <iomanip>
 #include <vector>
+#include <algorithm>
+#include <boost/bind.hpp>
 #include <graphlab/scheduler/scheduler_includes.hpp>
-#include <graphlab/rpc/async_consensus.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/parallel/atomic.hpp>
+#include <graphlab/util/random.hpp>
+#include <graphlab/util/timer.hpp>
 #include <cxxtest/TestSuite.h>
 
 
 using namespace graphlab;
 
-distributed_control dc;
-
-struct message_type {
-  int value;
-  double pr;
-
-  explicit message_type(int value = 0, double pr = 0):value(value),pr(pr) { }
-  
-  double priority() const {
-    return pr;
-  }
-  message_type& operator+=(const message_type& other) {
-    value += other.value;
-    pr = other.value;
-    return *this;
-  }
-};
-
-
 const size_t NCPUS = 4;
 const size_t NUM_VERTICES = 101;
 std::vector<atomic<int> > correctness_counter;
@@ -60,85 +46,60 @@ void test_scheduler_basic_functionality_single_threaded() {
   graphlab_options opts;
   opts.set_ncpus(NCPUS);
   SchedulerType sched(NUM_VERTICES, opts);
-  const size_t target_value = 100;
-  
-  // inject a sequence of messages which will sum to 100 per vertex
-  for (size_t c = 0;c < target_value; ++c) {
+  const size_t repetitions = 100;
+
+  // repeated schedulings of a vertex are merged into one
+  for (size_t c = 0;c < repetitions; ++c) {
     for (size_t i = 0; i < NUM_VERTICES; ++i) {
-      sched.schedule(i, message_type(1, 1.0));
+      sched.schedule(i, 1.0);
     }
   }
   correctness_counter.clear();
   correctness_counter.resize(NUM_VERTICES, atomic<int>(0));
-  sched.start();
-  
+
   // pull stuff out
-  bool allcpus_done = false; 
+  bool allcpus_done = false;
   while(!allcpus_done) {
     allcpus_done = true;
     for (size_t i = 0; i < NCPUS; ++i) {
-      vertex_id_type v; message_type m;
-      sched_status::status_enum ret = sched.get_next(i, v, m);
+      lvid_type v;
+      sched_status::status_enum ret = sched.get_next(i, v);
       if (ret == sched_status::NEW_TASK) {
         allcpus_done = false;
-        correctness_counter[v].inc(m.value);
+        correctness_counter[v].inc();
       }
     }
   }
 
   // check the counters
   for(size_t i = 0; i < NUM_VERTICES; ++i) {
-    TS_ASSERT_EQUALS(correctness_counter[i].value, (int)target_value);
+    TS_ASSERT_EQUALS(correctness_counter[i].value, 1);
   }
+  TS_ASSERT(sched.empty());
 }
 
 
 
-
-
 template <typename SchedulerType>
-void test_basic_functionality_thread(SchedulerType& sched, 
-                                     async_consensus& consensus, 
+void test_basic_functionality_thread(SchedulerType& sched,
+                                     barrier& done_scheduling,
                                      size_t schedule_count,
                                      size_t threadid) {
-  size_t c = 0;
-  vertex_id_type v; message_type m;
-  while(1) {
-    // process as many tasks as I can
-    while(1) {
-      sched_status::status_enum ret = sched.get_next(threadid, v, m);
-      if (ret == sched_status::NEW_TASK) {
-        correctness_counter[v].inc(m.value);
-      }
-      else {
-        break;
-      }
-    }
-    
-    // schedule 1 cycle. If I schedule stuff I go back to processing tasks
-    if (c < schedule_count) {
-      for (size_t i = 0; i < NUM_VERTICES; ++i) {
-        sched.schedule(i, message_type(1, 1.0));
-        consensus.cancel();
-      }
-      ++c;
-      continue;
-    }
-    
-    // nothing to schedule, nothing to run. try to quit
-    consensus.begin_done_critical_section(threadid);
-    sched_status::status_enum ret = sched.get_next(threadid, v, m);
-    if (ret == sched_status::NEW_TASK) {
-      // there is task. cancel, process it, and look back
-      consensus.cancel_critical_section(threadid);
-      correctness_counter[v].inc(m.value);
+  lvid_type v;
+  for (size_t c = 0; c < schedule_count; ++c) {
+    // schedule 1 cycle, then process as many tasks as I can
+    for (size_t i = 0; i < NUM_VERTICES; ++i) {
+      sched.schedule(i, 1.0);
     }
-    else {
-      // no more tasks try to finish up
-      bool ret = consensus.end_done_critical_section(threadid);
-      if (ret) break;
+    while(sched.get_next(threadid, v) == sched_status::NEW_TASK) {
+      correctness_counter[v].inc();
     }
   }
+  // nothing is scheduled anymore. Drain what is left
+  done_scheduling.wait();
+  while(sched.get_next(threadid, v) == sched_status::NEW_TASK) {
+    correctness_counter[v].inc();
+  }
 }
 
 
@@ -147,149 +108,229 @@ void test_scheduler_basic_functionality_parallel() {
   graphlab_options opts;
   opts.set_ncpus(NCPUS);
   SchedulerType sched(NUM_VERTICES, opts);
-  async_consensus consensus(dc, NCPUS);
-  
-  const size_t schedule_count = 10000;
-  const size_t target_value = schedule_count * NCPUS + 1;
+  barrier done_scheduling(NCPUS);
+
+  const size_t schedule_count = 1000;
+  const int max_value = schedule_count * NCPUS;
 
   correctness_counter.clear();
   correctness_counter.resize(NUM_VERTICES, atomic<int>(0));
 
-  // inject a sequence of messages which will sum to 100 per vertex
-  for (size_t i = 0; i < NUM_VERTICES; ++i) {
-    sched.schedule(i, message_type(1, 1.0));
-  }
-  sched.start();
-  
   thread_group group;
   for (size_t i = 0;i < NCPUS;++i) {
     group.launch(boost::bind(test_basic_functionality_thread<SchedulerType>,
-                             boost::ref(sched), boost::ref(consensus), schedule_count, i));
+                             boost::ref(sched), boost::ref(done_scheduling),
+                             schedule_count, i));
   }
 
   group.join();
-  // check the counters
+  // every vertex ran, and no more often than it was scheduled
   for(size_t i = 0; i < NUM_VERTICES; ++i) {
-    TS_ASSERT_EQUALS(correctness_counter[i].value, (int)target_value);
+    TS_ASSERT_LESS_THAN_EQUALS(1, correctness_counter[i].value);
+    TS_ASSERT_LESS_THAN_EQUALS(correctness_counter[i].value, max_value);
   }
+  TS_ASSERT(sched.empty());
 }
 
 
 
+/*
+ * Vertices scheduled below min_priority are never returned
+ */
+template <typename SchedulerType>
+void test_scheduler_min_priority_single_threaded() {
+  graphlab_options opts;
+  opts.set_ncpus(NCPUS);
+  opts.get_scheduler_args().set_option("min_priority", 100.0);
+  SchedulerType sched(NUM_VERTICES, opts);
 
-
+  correctness_counter.clear();
+  correctness_counter.resize(NUM_VERTICES, atomic<int>(0));
+  for (size_t i = 0; i < NUM_VERTICES; ++i) {
+    sched.schedule(i, i % 2 ? 101.0 : 1.0);
+  }
+  lvid_type v;
+  for (size_t i = 0; i < NCPUS; ++i) {
+    while(sched.get_next(i, v) == sched_status::NEW_TASK) {
+      correctness_counter[v].inc();
+    }
+  }
+  for(size_t i = 0; i < NUM_VERTICES; ++i) {
+    TS_ASSERT_EQUALS(correctness_counter[i].value, (int)(i % 2));
+  }
+  TS_ASSERT(sched.empty());
+}
 
 
 /*
- * Like test_basic_functionality_thread, but only increments the 
- * correctness_counter by 1, and checks to make sure the priority is at least
- * 100.0
+ * With a single queue the multiqueue scheduler is an exact priority
+ * queue, also when priorities of scheduled vertices are raised.
  */
-template <typename SchedulerType>
-void test_scheduler_min_priority_thread(SchedulerType& sched, 
-                                        async_consensus& consensus, 
-                                        size_t schedule_count,
-                                        size_t threadid) {
-  size_t c = 0;
-  vertex_id_type v; message_type m;
-  while(1) {
-    // process as many tasks as I can
-    while(1) {
-      sched_status::status_enum ret = sched.get_next(threadid, v, m);
-      if (ret == sched_status::NEW_TASK) {
-        TS_ASSERT_LESS_THAN_EQUALS(100.0, m.priority());
-        correctness_counter[v].inc(1);
-      }
-      else {
-        break;
-      }
-    }
-    
-    // schedule 1 cycle. If I schedule stuff I go back to processing tasks
-    if (c < schedule_count) {
-      for (size_t i = 0; i < NUM_VERTICES; ++i) {
-        sched.schedule(i, message_type(1, 1.0));
-        consensus.cancel();
-      }
-      ++c;
-      continue;
-    }
-    
-    // nothing to schedule, nothing to run. try to quit
-    consensus.begin_done_critical_section(threadid);
-    sched_status::status_enum ret = sched.get_next(threadid, v, m);
-    if (ret == sched_status::NEW_TASK) {
-      TS_ASSERT_LESS_THAN_EQUALS(100.0, m.priority());
-      // there is task. cancel, process it, and look back
-      consensus.cancel_critical_section(threadid);
-      correctness_counter[v].inc(1);
-    }
-    else {
-      // no more tasks try to finish up
-      bool ret = consensus.end_done_critical_section(threadid);
-      if (ret) break;
+void test_multiqueue_priority_order() {
+  graphlab_options opts;
+  opts.set_ncpus(1);
+  opts.get_scheduler_args().set_option("multi", 1);
+  multiqueue_scheduler sched(NUM_VERTICES, opts);
+  for (size_t i = 0; i < NUM_VERTICES; ++i) {
+    sched.schedule(i, (double)i);
+  }
+  // raise the priority of the even vertices above all the odd ones.
+  // Lowering a priority has no effect
+  for (size_t i = 0; i < NUM_VERTICES; i += 2) {
+    sched.schedule(i, 1000.0 + i);
+    sched.schedule(i, 0.0);
+  }
+  std::vector<lvid_type> order;
+  lvid_type v;
+  while(sched.get_next(0, v) == sched_status::NEW_TASK) order.push_back(v);
+  TS_ASSERT_EQUALS(order.size(), NUM_VERTICES);
+  TS_ASSERT(sched.empty());
+  size_t numeven = (NUM_VERTICES + 1) / 2;
+  for (size_t i = 0; i < order.size(); ++i) {
+    if (i < numeven) {
+      TS_ASSERT_EQUALS(order[i], 2 * (numeven - 1 - i));
+    } else {
+      TS_ASSERT_EQUALS(order[i], NUM_VERTICES - 2 - 2 * (i - numeven));
     }
   }
 }
 
 
-template <typename SchedulerType>
-void test_scheduler_min_priority_parallel() {
+/*
+ * The delta stepping scheduler returns vertices bucket by bucket, and a
+ * vertex scheduled into the current bucket runs before the next bucket.
+ * Moving a vertex to a lower bucket takes effect.
+ */
+void test_delta_stepping_bucket_order() {
   graphlab_options opts;
   opts.set_ncpus(NCPUS);
-  opts.get_scheduler_args().set_option("min_priority", 100.0);
-  
-  SchedulerType sched(NUM_VERTICES, opts);
-  async_consensus consensus(dc, NCPUS);
-  
-  const size_t schedule_count = 10000;
-  const size_t maximum_value = (size_t)((schedule_count * NCPUS + 101.0) / 100.0);
+  opts.get_scheduler_args().set_option("delta", 10.0);
+  opts.get_scheduler_args().set_option("buckets", 8);
+  delta_stepping_scheduler sched(NUM_VERTICES, opts);
+  // priorities are negated distances. Vertex i at distance i, except
+  // that the last vertex is moved to distance 0.5. Distances of 80 and
+  // beyond are past the window of 8 buckets and go in bucket 7.
+  for (size_t i = 0; i < NUM_VERTICES; ++i) {
+    sched.schedule(i, -(double)i);
+  }
+  sched.schedule(NUM_VERTICES - 1, -0.5);
+  sched.schedule(NUM_VERTICES - 1, -50.0);
+
+  std::vector<size_t> popped_bucket(NUM_VERTICES, 0);
+  size_t last_bucket = 0;
+  lvid_type v;
+  size_t npopped = 0;
+  bool rescheduled = false;
+  while(sched.get_next(npopped % NCPUS, v) == sched_status::NEW_TASK) {
+    size_t bucket = sched.get_current_bucket();
+    TS_ASSERT_LESS_THAN_EQUALS(last_bucket, bucket);
+    last_bucket = bucket;
+    popped_bucket[v] = bucket;
+    ++npopped;
+    if (v == 45 && !rescheduled) {
+      // a "light edge" into the current bucket runs in the same bucket
+      sched.schedule(3, -41.0);
+      rescheduled = true;
+    }
+  }
+  TS_ASSERT(sched.empty());
+  TS_ASSERT_EQUALS(npopped, NUM_VERTICES + 1);
+  for (size_t i = 0; i < NUM_VERTICES - 1; ++i) {
+    if (i != 3) TS_ASSERT_EQUALS(popped_bucket[i], std::min<size_t>(i / 10, 7));
+  }
+  TS_ASSERT_EQUALS(popped_bucket[3], 4);
+  TS_ASSERT_EQUALS(popped_bucket[NUM_VERTICES - 1], 0);
+}
 
-  correctness_counter.clear();
-  correctness_counter.resize(NUM_VERTICES, atomic<int>(0));
 
-  // inject a sequence of messages which will sum to 100 per vertex
-  for (size_t i = 0; i < NUM_VERTICES; ++i) {
-    sched.schedule(i, message_type(1, 101.0));
+/*
+ * Throughput of a residual-style workload: every executed vertex raises
+ * the priority of two random vertices.
+ */
+const size_t BENCH_VERTICES = 100000;
+const size_t BENCH_TASKS = 200000;
+
+template <typename SchedulerType>
+void scheduler_throughput_thread(SchedulerType& sched,
+                                 atomic<size_t>& tasks_done,
+                                 size_t threadid) {
+  lvid_type v;
+  while(tasks_done.value < BENCH_TASKS) {
+    if (sched.get_next(threadid, v) == sched_status::NEW_TASK) {
+      tasks_done.inc();
+      for (size_t i = 0; i < 2; ++i) {
+        sched.schedule(random::fast_uniform<lvid_type>(0, BENCH_VERTICES - 1),
+                       random::rand01());
+      }
+    }
   }
-  sched.start();
-  
+}
+
+template <typename SchedulerType>
+double scheduler_throughput(size_t nthreads) {
+  graphlab_options opts;
+  opts.set_ncpus(nthreads);
+  SchedulerType sched(BENCH_VERTICES, opts);
+  for (size_t i = 0; i < BENCH_VERTICES; ++i) {
+    sched.schedule(i, random::rand01());
+  }
+  atomic<size_t> tasks_done;
+  timer ti;
+  ti.start();
   thread_group group;
-  for (size_t i = 0;i < NCPUS;++i) {
-    group.launch(boost::bind(test_scheduler_min_priority_thread<SchedulerType>,
-                             boost::ref(sched), boost::ref(consensus), schedule_count, i));
+  for (size_t i = 0;i < nthreads;++i) {
+    group.launch(boost::bind(scheduler_throughput_thread<SchedulerType>,
+                             boost::ref(sched), boost::ref(tasks_done), i));
   }
-
   group.join();
-  // check the counters
-  for(size_t i = 0; i < NUM_VERTICES; ++i) {
-    TS_ASSERT_LESS_THAN_EQUALS(correctness_counter[i].value, (int)maximum_value);
-  }
+  return tasks_done.value / ti.current_time();
 }
 
-class SerializeTestSuite : public CxxTest::TestSuite {
+
+class SchedulerTestSuite : public CxxTest::TestSuite {
 public:
   void test_scheduler_basic_single_threaded() {
-    test_scheduler_basic_functionality_single_threaded<sweep_scheduler<message_type> >();
-    test_scheduler_basic_functionality_single_threaded<fifo_scheduler<message_type> >();
-    test_scheduler_basic_functionality_single_threaded<priority_scheduler<message_type> >();
-    test_scheduler_basic_functionality_single_threaded<queued_fifo_scheduler<message_type> >();
+    test_scheduler_basic_functionality_single_threaded<sweep_scheduler>();
+    test_scheduler_basic_functionality_single_threaded<fifo_scheduler>();
+    test_scheduler_basic_functionality_single_threaded<priority_scheduler>();
+    test_scheduler_basic_functionality_single_threaded<queued_fifo_scheduler>();
+    test_scheduler_basic_functionality_single_threaded<multiqueue_scheduler>();
+    test_scheduler_basic_functionality_single_threaded<delta_stepping_scheduler>();
   }
-  
+
   void test_scheduler_basic_parallel() {
-    test_scheduler_basic_functionality_parallel<sweep_scheduler<message_type> >();
-    test_scheduler_basic_functionality_parallel<fifo_scheduler<message_type> >();
-    test_scheduler_basic_functionality_parallel<priority_scheduler<message_type> >();
-    test_scheduler_basic_functionality_parallel<queued_fifo_scheduler<message_type> >();
+    test_scheduler_basic_functionality_parallel<sweep_scheduler>();
+    test_scheduler_basic_functionality_parallel<fifo_scheduler>();
+    test_scheduler_basic_functionality_parallel<priority_scheduler>();
+    test_scheduler_basic_functionality_parallel<queued_fifo_scheduler>();
+    test_scheduler_basic_functionality_parallel<multiqueue_scheduler>();
+    test_scheduler_basic_functionality_parallel<delta_stepping_scheduler>();
   }
-  
-    
+
   void test_scheduler_min_priority() {
-    test_scheduler_min_priority_parallel<sweep_scheduler<message_type> >();
-    test_scheduler_min_priority_parallel<fifo_scheduler<message_type> >();
-    test_scheduler_min_priority_parallel<priority_scheduler<message_type> >();
-    test_scheduler_min_priority_parallel<queued_fifo_scheduler<message_type> >();
+    test_scheduler_min_priority_single_threaded<priority_scheduler>();
+    test_scheduler_min_priority_single_threaded<multiqueue_scheduler>();
   }
 
+  void test_multiqueue_order() {
+    test_multiqueue_priority_order();
+  }
+
+  void test_delta_stepping_order() {
+    test_delta_stepping_bucket_order();
+  }
+
+  void test_priority_scheduler_throughput() {
+    std::cout << "\n" << std::setw(8) << "threads"
+              << std::setw(16) << "priority/s"
+              << std::setw(16) << "multiqueue/s" << std::endl;
+    for (size_t nthreads = 1; nthreads <= 64; nthreads *= 2) {
+      double priority_rate = scheduler_throughput<priority_scheduler>(nthreads);
+      double multiqueue_rate = scheduler_throughput<multiqueue_scheduler>(nthreads);
+      std::cout << std::setw(8) << nthreads
+                << std::setw(16) << (size_t)priority_rate
+                << std::setw(16) << (size_t)multiqueue_rate << std::endl;
+    }
+  }
 };
 
@@ -36,6 +36,8 @@
 
 #include <graphlab/util/generics/any.hpp>
 #include <graphlab/serialization/serialization_includes.hpp>
+#include <graphlab/util/timer.hpp>
+#include <graphlab/util/latent_factor_gather.hpp>
 
 
 using namespace graphlab;
@@ -76,6 +78,60 @@ struct pod_class_2 {
 }; 
 SERIALIZABLE_POD(pod_class_2);
 
+/// Mirrors distributed_ingress_base::edge_buffer_record
+template <typename EdgeData>
+struct edge_record :
+  public conditional_pod_type<
+    gl_is_packed_pod_pair<std::pair<uint32_t, uint32_t>, EdgeData>::value> {
+  uint32_t source, target;
+  EdgeData edata;
+  void save(oarchive& arc) const { arc << source << target << edata; }
+  void load(iarchive& arc) { arc >> source >> target >> edata; }
+};
+
+/// Same record, always written field by field
+struct fieldwise_edge_record {
+  uint32_t source, target;
+  float edata;
+  void save(oarchive& arc) const { arc << source << target << edata; }
+  void load(iarchive& arc) { arc >> source >> target >> edata; }
+};
+
+/// Mirrors distributed_ingress_base::vertex_buffer_record
+template <typename VertexData>
+struct vertex_record :
+  public conditional_pod_type<
+    gl_is_packed_pod_pair<uint32_t, VertexData>::value> {
+  uint32_t vid;
+  VertexData vdata;
+  void save(oarchive& arc) const { arc << vid << vdata; }
+  void load(iarchive& arc) { arc >> vid >> vdata; }
+};
+
+/**
+ * Serializes and deserializes v in memory a number of times and returns
+ * the throughput in bytes of archive per second. The buffers are reused
+ * across iterations so that the allocator is not measured.
+ */
+template <typename T>
+double round_trip_throughput(const T& v, size_t iterations) {
+  size_t bytes = 0;
+  oarchive oarc;
+  T w;
+  timer ti;
+  ti.start();
+  for (size_t i = 0;i < iterations; ++i) {
+    oarc.off = 0;
+    oarc << v;
+    iarchive iarc(oarc.buf, oarc.off);
+    iarc >> w;
+    bytes += oarc.off;
+  }
+  double elapsed = ti.current_time();
+  free(oarc.buf);
+  return bytes / elapsed;
+}
+
 
 class SerializeTestSuite : public CxxTest::TestSuite {
 public:
@@ -414,5 +470,145 @@ public:
         TS_ASSERT_EQUALS(p1[i].x, p2[i].x);
     }
   }
+  void test_trivially_serializable_traits() {
+    TS_ASSERT(gl_is_trivially_serializable<int>::value);
+    TS_ASSERT(gl_is_trivially_serializable<pod_class_1>::value);
+    TS_ASSERT((gl_is_trivially_serializable<std::pair<int, std::pair<double, pod_class_1> > >::value));
+    TS_ASSERT((!gl_is_trivially_serializable<std::pair<int, std::string> >::value));
+    TS_ASSERT(!gl_is_trivially_serializable<A>::value);
+    TS_ASSERT(gl_is_pod<edge_record<float> >::value);
+    TS_ASSERT(gl_is_pod<edge_record<double> >::value);
+    TS_ASSERT(!gl_is_pod<vertex_record<double> >::value);
+    TS_ASSERT(!gl_is_pod<edge_record<std::string> >::value);
+    TS_ASSERT(gl_is_pod<vertex_record<uint32_t> >::value);
+  }
+
+  void test_vector_of_pod_pairs() {
+    std::vector<std::pair<size_t, pod_class_1> > v(1000), w;
+    for (size_t i = 0;i < v.size(); ++i) {
+      v[i].first = i;
+      v[i].second.x = 3 * i;
+    }
+    oarchive oarc;
+    oarc << v;
+    // pairs keep the element by element format of earlier archives
+    oarchive elementwise;
+    // the length is followed by the serialize_iterator() of the pairs
+    elementwise << size_t(v.size()) << size_t(v.size());
+    for (size_t i = 0;i < v.size(); ++i) {
+      elementwise << v[i].first << v[i].second;
+    }
+    TS_ASSERT_EQUALS(oarc.off, elementwise.off);
+    TS_ASSERT_SAME_DATA(oarc.buf, elementwise.buf, oarc.off);
+    free(elementwise.buf);
+    iarchive iarc(oarc.buf, oarc.off);
+    iarc >> w;
+    TS_ASSERT_EQUALS(w.size(), v.size());
+    for (size_t i = 0;i < w.size(); ++i) {
+      TS_ASSERT_EQUALS(w[i].first, i);
+      TS_ASSERT_EQUALS(w[i].second.x, 3 * i);
+    }
+    free(oarc.buf);
+  }
+
+  void test_serialized_size_bound() {
+    std::vector<std::string> v;
+    for (size_t i = 0;i < 100; ++i) v.push_back(std::string(i, 'a'));
+    std::vector<std::pair<int, std::string> > p(10, std::make_pair(1, "hello"));
+    std::vector<A> a(10);
+    TS_ASSERT(serialized_size<std::vector<std::string> >::is_known);
+    TS_ASSERT(!serialized_size<std::vector<A> >::is_known);
+    oarchive oarc;
+    oarc << v;
+    TS_ASSERT_LESS_THAN_EQUALS(oarc.off, serialized_size<std::vector<std::string> >::get(v));
+    size_t off = oarc.off;
+    oarc << p;
+    TS_ASSERT_LESS_THAN_EQUALS(oarc.off - off,
+                               (serialized_size<std::vector<std::pair<int, std::string> > >::get(p)));
+    oarc << a;
+    iarchive iarc(oarc.buf, oarc.off);
+    std::vector<std::string> v2;
+    std::vector<std::pair<int, std::string> > p2;
+    iarc >> v2 >> p2;
+    TS_ASSERT(v == v2);
+    TS_ASSERT(p == p2);
+    free(oarc.buf);
+  }
+
+  void test_reserve_grows_geometrically() {
+    oarchive oarc;
+    size_t reallocs = 0, len = 0;
+    for (size_t i = 0;i < 1000; ++i) {
+      oarc.reserve(8);
+      if (oarc.len != len) { ++reallocs; len = oarc.len; }
+      oarc.advance(8);
+    }
+    TS_ASSERT_LESS_THAN(reallocs, 20);
+    free(oarc.buf);
+  }
+
+  void test_latent_factor_gather() {
+    const size_t rank = 7, n = 5;
+    double x[n][rank], y[n], w[n];
+    for (size_t k = 0;k < n; ++k) {
+      for (size_t i = 0;i < rank; ++i) x[k][i] = 0.5 * k - 0.25 * i + 1;
+      y[k] = 2.0 * k - 3;
+      w[k] = 1.0 + 0.1 * k;
+    }
+    latent_factor_gather sum;
+    TS_ASSERT(sum.empty());
+    for (size_t k = 0;k < n; ++k) sum += latent_factor_gather(x[k], rank, y[k], w[k]);
+    // an empty term is the identity
+    sum += latent_factor_gather();
+    TS_ASSERT_EQUALS(sum.size(), rank);
+
+    // views are materialized when copied or serialized
+    oarchive oarc;
+    oarc << sum << latent_factor_gather(x[0], rank, y[0]) << latent_factor_gather();
+    iarchive iarc(oarc.buf, oarc.off);
+    latent_factor_gather sum2, first, empty;
+    iarc >> sum2 >> first >> empty;
+    TS_ASSERT(empty.empty());
+    latent_factor_gather half(sum2);
+    half += sum2;
+    for (size_t i = 0;i < rank; ++i) {
+      for (size_t j = 0;j < rank; ++j) {
+        double xtx = 0;
+        for (size_t k = 0;k < n; ++k) xtx += w[k] * x[k][i] * x[k][j];
+        TS_ASSERT_DELTA(sum.xtx(i, j), xtx, 1e-9);
+        TS_ASSERT_DELTA(sum2.xtx(i, j), xtx, 1e-9);
+        TS_ASSERT_DELTA(half.xtx(i, j), 2 * xtx, 1e-9);
+        TS_ASSERT_DELTA(first.xtx(i, j), x[0][i] * x[0][j], 1e-9);
+      }
+      double xty = 0;
+      for (size_t k = 0;k < n; ++k) xty += w[k] * y[k] * x[k][i];
+      TS_ASSERT_DELTA(sum.xty(i), xty, 1e-9);
+      TS_ASSERT_DELTA(sum2.xty(i), xty, 1e-9);
+      TS_ASSERT_DELTA(first.xty(i), y[0] * x[0][i], 1e-9);
+    }
+    free(oarc.buf);
+  }
+
+  void test_record_throughput() {
+    const size_t n = 1 << 20;
+    std::vector<edge_record<float> > edges(n);
+    std::vector<fieldwise_edge_record> fieldwise_edges(n);
+    std::vector<vertex_record<uint32_t> > vertices(n);
+    std::vector<std::pair<uint32_t, uint32_t> > pairs(n);
+    std::vector<std::string> strings(n / 16, std::string(64, 'x'));
+    for (size_t i = 0;i < n; ++i) {
+      edges[i].source = fieldwise_edges[i].source = i;
+      edges[i].target = fieldwise_edges[i].target = n - i;
+      edges[i].edata = fieldwise_edges[i].edata = i * 0.5;
+      vertices[i].vid = i; vertices[i].vdata = i;
+      pairs[i] = std::make_pair(i, n - i);
+    }
+    std::cout << "\nRound trip throughput (MB/s)\n"
+              << "  edge records:            " << round_trip_throughput(edges, 10) / 1e6 << "\n"
+              << "  field-wise edge records: " << round_trip_throughput(fieldwise_edges, 10) / 1e6 << "\n"
+              << "  vertex records:          " << round_trip_throughput(vertices, 10) / 1e6 << "\n"
+              << "  vertex id pairs:         " << round_trip_throughput(pairs, 10) / 1e6 << "\n"
+              << "  64 byte strings:         " << round_trip_throughput(strings, 10) / 1e6 << "\n";
+  }
 };
 
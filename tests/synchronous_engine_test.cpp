@@ -27,6 +27,14 @@
 
 // #include <cxxtest/TestSuite.h>
 
+// The vertex ids aggregator below appends vectors. Like any operator+=
+// for a std type, it has to be declared before the rest of GraphLab.
+inline std::vector<int>& operator+=(std::vector<int>& lvalue,
+                                    const std::vector<int>& rvalue) {
+  lvalue.insert(lvalue.end(), rvalue.begin(), rvalue.end());
+  return lvalue;
+}
+
 #include <graphlab.hpp>
 
 typedef graphlab::distributed_graph<int,int> graph_type;
@@ -317,6 +325,172 @@ void test_count_aggregators(graphlab::distributed_control& dc,
 
 
 
+/*
+ * A std::vector aggregator is reduced with its own operator+=, here a
+ * concatenation, while a type which opts in with IS_DENSE_SUM_TYPE is
+ * summed in place.
+ */
+struct degree_sums : public graphlab::IS_DENSE_SUM_TYPE<double> {
+  double in_edges, out_edges;
+  degree_sums() : in_edges(0), out_edges(0) { }
+  degree_sums& operator+=(const degree_sums& other) {
+    in_edges += other.in_edges;
+    out_edges += other.out_edges;
+    return *this;
+  }
+};
+
+std::vector<int> vertex_ids(count_aggregators::icontext_type& context,
+                            const graph_type::vertex_type& vertex) {
+  return std::vector<int>(1, vertex.id());
+}
+size_t finalized_ids = 0;
+void vertex_ids_finalize(count_aggregators::icontext_type& context,
+                         const std::vector<int>& total) {
+  std::vector<int> ids = total;
+  std::sort(ids.begin(), ids.end());
+  ASSERT_EQ(ids.size(), context.num_vertices());
+  for (size_t i = 0; i < ids.size(); ++i) ASSERT_EQ(ids[i], int(i));
+  ++finalized_ids;
+}
+
+degree_sums degrees(count_aggregators::icontext_type& context,
+                    const graph_type::vertex_type& vertex) {
+  degree_sums ret;
+  ret.in_edges = vertex.num_in_edges();
+  ret.out_edges = vertex.num_out_edges();
+  return ret;
+}
+size_t finalized_degrees = 0;
+void degrees_finalize(count_aggregators::icontext_type& context,
+                      const degree_sums& total) {
+  ASSERT_EQ(total.in_edges, double(context.num_edges()));
+  ASSERT_EQ(total.out_edges, double(context.num_edges()));
+  ++finalized_degrees;
+}
+
+void test_vector_aggregators(graphlab::distributed_control& dc,
+                             graphlab::command_line_options& clopts,
+                             graph_type& graph) {
+  typedef graphlab::synchronous_engine<count_aggregators> engine_type;
+  engine_type engine(dc, graph, clopts);
+  engine.add_vertex_aggregator<std::vector<int> >("vertex_ids",
+                                                  vertex_ids,
+                                                  vertex_ids_finalize);
+  engine.add_vertex_aggregator<degree_sums>("degrees",
+                                            degrees, degrees_finalize);
+  ASSERT_TRUE(engine.aggregate_now("vertex_ids"));
+  ASSERT_TRUE(engine.aggregate_now("degrees"));
+  ASSERT_EQ(finalized_ids, 1);
+  ASSERT_EQ(finalized_degrees, 1);
+  std::cout << "Finished" << std::endl;
+}
+
+
+
+/*
+ * The same counts through the engine's specialized path for vertex
+ * programs with static_edge_traits.
+ */
+class static_count_in_neighbors : public count_in_neighbors { };
+class static_count_all_neighbors : public count_all_neighbors { };
+
+namespace graphlab {
+  template <>
+  struct static_edge_traits<static_count_in_neighbors>
+    : public static_edge_dirs<IN_EDGES, NO_EDGES> { };
+  template <>
+  struct static_edge_traits<static_count_all_neighbors>
+    : public static_gather_dir<ALL_EDGES> { };
+}
+
+template <typename VertexProgram>
+void test_static_neighbors(graphlab::distributed_control& dc,
+                           graphlab::command_line_options& clopts,
+                           graph_type& graph) {
+  std::cout << "Constructing a syncrhonous engine with static edge directions"
+            << std::endl;
+  typedef graphlab::synchronous_engine<VertexProgram> engine_type;
+  engine_type engine(dc, graph, clopts);
+  engine.signal_all();
+  std::cout << "Running!" << std::endl;
+  engine.start();
+  std::cout << "Finished" << std::endl;
+}
+
+
+void reset_vertex(graph_type::vertex_type& vertex) { vertex.data() = 0; }
+
+/*
+ * A vertex program and gather type that are not POD, so that both
+ * travel through the serialized path of the exchanges.
+ */
+struct count_vector {
+  std::vector<int> values;
+  count_vector& operator+=(const count_vector& other) {
+    if (values.size() < other.values.size()) values.resize(other.values.size());
+    for (size_t i = 0; i < other.values.size(); ++i) values[i] += other.values[i];
+    return *this;
+  }
+  void save(graphlab::oarchive& oarc) const { oarc << values; }
+  void load(graphlab::iarchive& iarc) { iarc >> values; }
+};
+
+class serialized_in_neighbors :
+  public graphlab::ivertex_program<graph_type, count_vector> {
+  std::vector<int> iteration_copies;
+public:
+  void init(icontext_type& context, const vertex_type& vertex,
+            const message_type& msg) {
+    iteration_copies.assign(3, context.iteration());
+  }
+  edge_dir_type
+  gather_edges(icontext_type& context, const vertex_type& vertex) const {
+    return graphlab::IN_EDGES;
+  }
+  gather_type
+  gather(icontext_type& context, const vertex_type& vertex,
+         edge_type& edge) const {
+    ASSERT_EQ(iteration_copies.size(), 3);
+    ASSERT_EQ(iteration_copies[2], context.iteration());
+    gather_type ret;
+    ret.values.push_back(1);
+    ret.values.push_back(edge.source().data());
+    return ret;
+  }
+  void apply(icontext_type& context, vertex_type& vertex,
+             const gather_type& total) {
+    if (vertex.num_in_edges() > 0) {
+      ASSERT_EQ(total.values.size(), 2);
+      ASSERT_EQ(total.values[0], int(vertex.num_in_edges()));
+      ASSERT_EQ(total.values[1],
+                context.iteration() * int(vertex.num_in_edges()));
+    }
+    vertex.data() = context.iteration() + 1;
+    if(context.iteration() < 10) context.signal(vertex);
+  }
+  edge_dir_type
+  scatter_edges(icontext_type& context, const vertex_type& vertex) const {
+    return graphlab::NO_EDGES;
+  }
+  void save(graphlab::oarchive& oarc) const { oarc << iteration_copies; }
+  void load(graphlab::iarchive& iarc) { iarc >> iteration_copies; }
+}; // end of serialized in neighbors
+
+void test_serialized_exchange(graphlab::distributed_control& dc,
+                              graphlab::command_line_options& clopts,
+                              graph_type& graph) {
+  std::cout << "Constructing a syncrhonous engine with serialized exchanges"
+            << std::endl;
+  graph.transform_vertices(reset_vertex);
+  typedef graphlab::synchronous_engine<serialized_in_neighbors> engine_type;
+  engine_type engine(dc, graph, clopts);
+  engine.signal_all();
+  std::cout << "Running!" << std::endl;
+  engine.start();
+  std::cout << "Finished" << std::endl;
+}
+
 
 int main(int argc, char** argv) {
   ///! Initialize control plain using mpi
@@ -334,8 +508,12 @@ int main(int argc, char** argv) {
   test_in_neighbors(dc, clopts, graph);
   test_out_neighbors(dc, clopts, graph);
   test_all_neighbors(dc, clopts, graph);
+  test_static_neighbors<static_count_in_neighbors>(dc, clopts, graph);
+  test_static_neighbors<static_count_all_neighbors>(dc, clopts, graph);
   test_messages(dc, clopts, graph);
   test_count_aggregators(dc, clopts, graph);
+  test_vector_aggregators(dc, clopts, graph);
+  test_serialized_exchange(dc, clopts, graph);
 
   graphlab::mpi_tools::finalize();
 } // end of main
@@ -43,7 +43,9 @@
 #include <boost/spirit/include/phoenix_stl.hpp>
 #include <boost/tokenizer.hpp>
 
+#include <cmath>
 #include <limits>
+#include <numeric>
 #include <vector>
 #include <map>
 #include <iostream>
@@ -56,11 +58,23 @@ size_t NUM_CLUSTERS = 0;
 bool IS_SPARSE = false;
 
 struct cluster {
-  cluster(): count(0), changed(false) { }
+  cluster(): count(0), changed(false), moved(0), half_gap(0) { }
   std::vector<double> center;
   std::map<size_t, double> center_sparse;
   size_t count;
   bool changed;
+  // Not serialized, and set by prepare() and compute_center_gaps():
+  // the sparse center as a sorted array, how far the center moved in
+  // the last update, and half the distance to the nearest other center
+  std::vector<std::pair<size_t, double> > sparse_entries;
+  double moved;
+  double half_gap;
+
+  bool empty() const { return center.empty() && center_sparse.empty(); }
+
+  void prepare() {
+    sparse_entries.assign(center_sparse.begin(), center_sparse.end());
+  }
 
   void save(graphlab::oarchive& oarc) const {
     oarc << center << count << changed << center_sparse;
@@ -73,21 +87,56 @@ struct cluster {
 
 std::vector<cluster> CLUSTERS;
 
-// the current cluster to initialize
-size_t KMEANS_INITIALIZATION;
+// The largest distance a center moved in the last update, the cluster
+// which moved it, and the largest distance any other center moved
+double MAX_MOVED = 0;
+size_t MAX_MOVED_CLUSTER = 0;
+double SECOND_MAX_MOVED = 0;
+
+// If set, the distance bounds of the data points are valid for CLUSTERS
+// before their last update
+bool BOUNDS_VALID = false;
+
+// The number of distances to centers computed by this machine
+graphlab::atomic<size_t> NUM_DISTANCES;
 
+// The candidate centers of the k-means|| initialization. The data
+// points have not yet seen the candidates from NEW_CANDIDATES on.
+std::vector<cluster> CANDIDATES;
+size_t NEW_CANDIDATES = 0;
+// A data point is sampled as a candidate with probability
+// SAMPLING_SCALE times its distance to the nearest candidate
+double SAMPLING_SCALE = 0;
+
+// The probability that a data point is in a minibatch
+double MINIBATCH_PROB = 0;
+
+/*
+ * best_distance is the squared distance to the assigned center, as of
+ * the last time it was computed.
+ * upper_bound is at least the distance to the assigned center, and
+ * lower_bound at most the distance to any other center (Hamerly).
+ */
 struct vertex_data{
   std::vector<double> point;
   std::map<size_t, double> point_sparse;
   size_t best_cluster;
   double best_distance;
   bool changed;
+  double upper_bound;
+  double lower_bound;
+
+  vertex_data(): best_cluster(-1),
+                 best_distance(std::numeric_limits<double>::infinity()),
+                 changed(false), upper_bound(0), lower_bound(0) { }
 
   void save(graphlab::oarchive& oarc) const {
-    oarc << point << best_cluster << best_distance << changed << point_sparse;
+    oarc << point << best_cluster << best_distance << changed << point_sparse
+         << upper_bound << lower_bound;
   }
   void load(graphlab::iarchive& iarc) {
-    iarc >> point >> best_cluster >> best_distance >> changed >> point_sparse;
+    iarc >> point >> best_cluster >> best_distance >> changed >> point_sparse
+         >> upper_bound >> lower_bound;
   }
 };
 
@@ -110,41 +159,53 @@ struct edge_data {
   }
 };
 
-// helper function to compute distance between points
+// helper function to compute distance between points.
+// Four independent sums let the compiler vectorize the loop.
 double sqr_distance(const std::vector<double>& a,
                     const std::vector<double>& b) {
   ASSERT_EQ(a.size(), b.size());
-  double total = 0;
-  for (size_t i = 0;i < a.size(); ++i) {
-    double d = a[i] - b[i];
-    total += d * d;
+  const size_t n = a.size();
+  const double* pa = n > 0 ? &a[0] : NULL;
+  const double* pb = n > 0 ? &b[0] : NULL;
+  double t0 = 0, t1 = 0, t2 = 0, t3 = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    const double d0 = pa[i] - pb[i];
+    const double d1 = pa[i + 1] - pb[i + 1];
+    const double d2 = pa[i + 2] - pb[i + 2];
+    const double d3 = pa[i + 3] - pb[i + 3];
+    t0 += d0 * d0; t1 += d1 * d1; t2 += d2 * d2; t3 += d3 * d3;
   }
-  return total;
+  for (; i < n; ++i) {
+    const double d = pa[i] - pb[i];
+    t0 += d * d;
+  }
+  return (t0 + t1) + (t2 + t3);
 }
 
-double sqr_distance(const std::map<size_t, double>& a,
-                    const std::map<size_t, double>& b) {
+// distance between two sparse vectors given as sorted (id, value)
+// ranges, in one merge
+template <typename IterA, typename IterB>
+double sqr_distance_sparse(IterA a, IterA a_end, IterB b, IterB b_end) {
   double total = 0.0;
-  for(std::map<size_t, double>::const_iterator iter = a.begin();
-      iter != a.end(); ++iter){
-    size_t id = (*iter).first;
-    double val = (*iter).second;
-    if(b.find(id) != b.end()){
-      double d = val - b.at(id);
-      total += d*d;
-    }else{
-      total += val * val;
-    }
-  }
-  for(std::map<size_t, double>::const_iterator iter = b.begin();
-      iter != b.end(); ++iter){
-    double val = (*iter).second;
-    if(a.find((*iter).first) == a.end()){
-      total += val * val;
+  while (a != a_end && b != b_end) {
+    if (a->first < b->first) {
+      total += a->second * a->second; ++a;
+    } else if (b->first < a->first) {
+      total += b->second * b->second; ++b;
+    } else {
+      const double d = a->second - b->second;
+      total += d * d; ++a; ++b;
     }
   }
-
+  for (; a != a_end; ++a) total += a->second * a->second;
+  for (; b != b_end; ++b) total += b->second * b->second;
   return total;
+}
+
+double sqr_distance(const std::map<size_t, double>& a,
+                    const std::map<size_t, double>& b) {
+  return sqr_distance_sparse(a.begin(), a.end(), b.begin(), b.end());
 
 ////   cosine distance is better for sparse datapoints?
 //    double ip = 0.0;
@@ -224,6 +285,50 @@ std::map<size_t, double>& scale_vector(std::map<size_t, double>& a, double d) {
 }
 
 
+// squared distance from a data point to a prepared center
+double point_distance(const vertex_data& v, const cluster& c) {
+  if (IS_SPARSE) {
+    return sqr_distance_sparse(v.point_sparse.begin(), v.point_sparse.end(),
+                               c.sparse_entries.begin(),
+                               c.sparse_entries.end());
+  }
+  return sqr_distance(v.point, c.center);
+}
+
+// squared distance between two prepared centers
+double center_distance(const cluster& a, const cluster& b) {
+  if (IS_SPARSE) {
+    return sqr_distance_sparse(a.sparse_entries.begin(), a.sparse_entries.end(),
+                               b.sparse_entries.begin(), b.sparse_entries.end());
+  }
+  return sqr_distance(a.center, b.center);
+}
+
+/*
+ * Finds the nearest of the non-empty centers from begin on, if it is
+ * nearer than best_distance, and the distance to the second nearest.
+ * Returns the number of distances computed.
+ */
+size_t nearest_centers(const vertex_data& v, const std::vector<cluster>& centers,
+                       size_t begin, size_t& best_cluster,
+                       double& best_distance, double& second_distance) {
+  size_t ndistances = 0;
+  for (size_t i = begin; i < centers.size(); ++i) {
+    if (centers[i].empty()) continue;
+    const double d = point_distance(v, centers[i]);
+    ++ndistances;
+    if (d < best_distance) {
+      second_distance = best_distance;
+      best_distance = d;
+      best_cluster = i;
+    } else if (d < second_distance) {
+      second_distance = d;
+    }
+  }
+  return ndistances;
+}
+
+
 typedef graphlab::distributed_graph<vertex_data, edge_data> graph_type;
 
 graphlab::atomic<graphlab::vertex_id_type> NEXT_VID;
@@ -395,26 +500,18 @@ struct min_point_size_reducer: public graphlab::IS_POD_TYPE {
 /*
  * This transform vertices call is only used during
  * the initialization phase. It computes distance to
- * cluster[KMEANS_INITIALIZATION] and assigns itself
- * to the new cluster KMEANS_INITIALIZATION if the new distance
- * is smaller that its previous cluster assignment
+ * the new candidates and assigns itself to the nearest
+ * if it is nearer than its previous candidate
  */
-void kmeans_pp_initialization(graph_type::vertex_type& v) {
-  double d = sqr_distance(v.data().point,
-                          CLUSTERS[KMEANS_INITIALIZATION].center);
-  if (v.data().best_distance > d) {
-    v.data().best_distance = d;
-    v.data().best_cluster = KMEANS_INITIALIZATION;
-  }
+void kmeans_parallel_update(graph_type::vertex_type& v) {
+  double second = std::numeric_limits<double>::infinity();
+  NUM_DISTANCES.inc(nearest_centers(v.data(), CANDIDATES, NEW_CANDIDATES,
+                                    v.data().best_cluster,
+                                    v.data().best_distance, second));
 }
 
-void kmeans_pp_initialization_sparse(graph_type::vertex_type& v) {
-  double d = sqr_distance(v.data().point_sparse,
-                          CLUSTERS[KMEANS_INITIALIZATION].center_sparse);
-  if (v.data().best_distance > d) {
-    v.data().best_distance = d;
-    v.data().best_cluster = KMEANS_INITIALIZATION;
-  }
+double get_best_distance(const graph_type::vertex_type& v) {
+  return v.data().best_distance;
 }
 
 
@@ -512,51 +609,112 @@ struct random_sample_reducer_sparse{
 
 
 /*
- * This transform vertices call is used during the 
- * actual k-means iteration. It computes distance to 
- * all "changed" clusters and reassigns itself if necessary
+ * Samples each data point as a new candidate center of the k-means||
+ * initialization, with probability proportional to its distance to the
+ * nearest candidate.
  */
-void kmeans_iteration(graph_type::vertex_type& v) {
-  // if current vertex's cluster was modified, we invalidate the distance.
-  // and we need to recompute to all existing clusters
-  // otherwise, we just need to recompute to changed cluster centers.
-  size_t prev_asg = v.data().best_cluster;
-  if (CLUSTERS[v.data().best_cluster].changed) {
-    // invalidate. recompute to all
-    v.data().best_cluster = (size_t)(-1);
-    v.data().best_distance = std::numeric_limits<double>::infinity();
-    for (size_t i = 0;i < NUM_CLUSTERS; ++i) {
-      if (CLUSTERS[i].center.size() > 0 || CLUSTERS[i].center_sparse.size() > 0) {
-        double d = 0.0;
-        if(IS_SPARSE == true)
-          d = sqr_distance(v.data().point_sparse, CLUSTERS[i].center_sparse);
-        else
-          d = sqr_distance(v.data().point, CLUSTERS[i].center);
-        if (d < v.data().best_distance) {
-          v.data().best_distance = d;
-          v.data().best_cluster = i;
-        }
-      }
+struct candidate_sample_reducer {
+  std::vector<cluster> points;
+
+  static candidate_sample_reducer get_sample(const graph_type::vertex_type& v) {
+    candidate_sample_reducer rs;
+    const double p = std::min(1.0, SAMPLING_SCALE * v.data().best_distance);
+    if (p > 0 && graphlab::random::bernoulli(p)) {
+      rs.points.resize(1);
+      rs.points[0].center = v.data().point;
+      rs.points[0].center_sparse = v.data().point_sparse;
     }
+    return rs;
   }
-  else {
-    // just compute distance to what has changed
-    for (size_t i = 0;i < NUM_CLUSTERS; ++i) {
-      if (CLUSTERS[i].changed &&
-          (CLUSTERS[i].center.size() > 0 || CLUSTERS[i].center_sparse.size() > 0)) {
-        double d = 0.0;
-        if(IS_SPARSE == true)
-          d = sqr_distance(v.data().point_sparse, CLUSTERS[i].center_sparse);
-        else
-          d= sqr_distance(v.data().point, CLUSTERS[i].center);
-        if (d < v.data().best_distance) {
-          v.data().best_distance = d;
-          v.data().best_cluster = i;
-        }
-      }
+
+  candidate_sample_reducer& operator+=(const candidate_sample_reducer& other) {
+    points.insert(points.end(), other.points.begin(), other.points.end());
+    return *this;
+  }
+
+  void save(graphlab::oarchive& oarc) const { oarc << points; }
+  void load(graphlab::iarchive& iarc) { iarc >> points; }
+};
+
+/*
+ * Counts the data points nearest to each candidate.
+ */
+struct candidate_weight_reducer {
+  std::map<size_t, double> weights;
+
+  static candidate_weight_reducer get_weight(const graph_type::vertex_type& v) {
+    candidate_weight_reducer rw;
+    rw.weights[v.data().best_cluster] = 1;
+    return rw;
+  }
+
+  candidate_weight_reducer& operator+=(const candidate_weight_reducer& other) {
+    for (std::map<size_t, double>::const_iterator iter = other.weights.begin();
+         iter != other.weights.end(); ++iter) {
+      weights[iter->first] += iter->second;
     }
+    return *this;
   }
-  v.data().changed = (prev_asg != v.data().best_cluster);
+
+  void save(graphlab::oarchive& oarc) const { oarc << weights; }
+  void load(graphlab::iarchive& iarc) { iarc >> weights; }
+};
+
+
+/*
+ * This transform vertices call is used during the
+ * actual k-means iteration. Following
+ *
+ *   G. Hamerly. Making k-means even faster. SDM 2010.
+ *
+ * the bounds of the data point are loosened by how far the centers
+ * moved. Only if the upper bound on the distance to the assigned
+ * center exceeds both the lower bound on the distance to any other
+ * center and half the distance from the assigned center to its
+ * nearest other center can another center be nearer, and the
+ * distances to all the centers are recomputed.
+ */
+void kmeans_iteration(graph_type::vertex_type& v) {
+  vertex_data& vdata = v.data();
+  size_t prev_asg = vdata.best_cluster;
+  size_t ndistances = 0;
+  if (BOUNDS_VALID && prev_asg != (size_t)(-1)) {
+    vdata.upper_bound += CLUSTERS[prev_asg].moved;
+    vdata.lower_bound -= prev_asg == MAX_MOVED_CLUSTER ?
+                         SECOND_MAX_MOVED : MAX_MOVED;
+    const double bound = std::max(vdata.lower_bound,
+                                  CLUSTERS[prev_asg].half_gap);
+    if (vdata.upper_bound > bound) {
+      // tighten the upper bound before giving up
+      vdata.best_distance = point_distance(vdata, CLUSTERS[prev_asg]);
+      vdata.upper_bound = std::sqrt(vdata.best_distance);
+      ++ndistances;
+    }
+    if (vdata.upper_bound <= bound) {
+      vdata.changed = false;
+      if (ndistances > 0) NUM_DISTANCES.inc(ndistances);
+      return;
+    }
+  }
+  // recompute to all
+  vdata.best_cluster = (size_t)(-1);
+  vdata.best_distance = std::numeric_limits<double>::infinity();
+  double second = std::numeric_limits<double>::infinity();
+  ndistances += nearest_centers(vdata, CLUSTERS, 0, vdata.best_cluster,
+                                vdata.best_distance, second);
+  NUM_DISTANCES.inc(ndistances);
+  vdata.upper_bound = std::sqrt(vdata.best_distance);
+  vdata.lower_bound = std::sqrt(second);
+  vdata.changed = (prev_asg != vdata.best_cluster);
+}
+
+/*
+ * Sets best_distance to the exact distance to the assigned center,
+ * which the bounds may have skipped.
+ */
+void exact_distance(graph_type::vertex_type& v) {
+  v.data().best_distance = point_distance(v.data(),
+                                          CLUSTERS[v.data().best_cluster]);
 }
 
 //gathered information
@@ -622,12 +780,8 @@ public:
     vertex.data().best_cluster = (size_t) (-1);
     vertex.data().best_distance = std::numeric_limits<double>::infinity();
     for (size_t i = 0; i < NUM_CLUSTERS; ++i) {
-      if (CLUSTERS[i].center.size() > 0 || CLUSTERS[i].center_sparse.size() > 0) {
-        double d = 0.0;
-        if(IS_SPARSE == true)
-          d = sqr_distance(vertex.data().point_sparse, CLUSTERS[i].center_sparse);
-        else
-          d = sqr_distance(vertex.data().point, CLUSTERS[i].center);
+      if (!CLUSTERS[i].empty()) {
+        double d = point_distance(vertex.data(), CLUSTERS[i]);
         //consider neighbors
         const std::map<size_t, double>& cw_map = total.cw_map;
         for (std::map<size_t, double>::const_iterator iter = cw_map.begin();
@@ -666,53 +820,258 @@ public:
  * computes new cluster centers
  * Also accumulates a counter counting the number of vertices which
  * assignments changed.
+ * Only the clusters with data points are kept, so that a data point
+ * contributes a single cluster.
  */
 struct cluster_center_reducer {
-  std::vector<cluster> new_clusters;
+  std::map<size_t, cluster> new_clusters;
   size_t num_changed;
-  double cost;
 
-  cluster_center_reducer():new_clusters(NUM_CLUSTERS), num_changed(0), cost(0) { }
+  cluster_center_reducer():num_changed(0) { }
+
+  // adds the data point to cluster i
+  void add_point(size_t i, const vertex_data& vdata) {
+    cluster& c = new_clusters[i];
+    if(IS_SPARSE == true)
+      c.center_sparse = vdata.point_sparse;
+    else
+      c.center = vdata.point;
+    c.count = 1;
+  }
 
   static cluster_center_reducer get_center(const graph_type::vertex_type& v) {
     cluster_center_reducer cc;
     ASSERT_NE(v.data().best_cluster, (size_t)(-1));
-
-    if(IS_SPARSE == true)
-      cc.new_clusters[v.data().best_cluster].center_sparse = v.data().point_sparse;
-    else
-      cc.new_clusters[v.data().best_cluster].center = v.data().point;
-    cc.new_clusters[v.data().best_cluster].count = 1;
+    cc.add_point(v.data().best_cluster, v.data());
     cc.num_changed = v.data().changed;
-    cc.cost = v.data().best_distance;
+    return cc;
+  }
+
+  /*
+   * Samples the data point into the minibatch with probability
+   * MINIBATCH_PROB, and adds it to its nearest cluster.
+   */
+  static cluster_center_reducer get_minibatch_sample(const graph_type::vertex_type& v) {
+    cluster_center_reducer cc;
+    if (!graphlab::random::bernoulli(MINIBATCH_PROB)) return cc;
+    size_t best = (size_t)(-1);
+    double best_distance = std::numeric_limits<double>::infinity();
+    double second = std::numeric_limits<double>::infinity();
+    NUM_DISTANCES.inc(nearest_centers(v.data(), CLUSTERS, 0, best,
+                                      best_distance, second));
+    if (best != (size_t)(-1)) cc.add_point(best, v.data());
     return cc;
   }
 
   cluster_center_reducer& operator+=(const cluster_center_reducer& other) {
-    for (size_t i = 0;i < NUM_CLUSTERS; ++i) {
-      if (new_clusters[i].count == 0) new_clusters[i] = other.new_clusters[i];
-      else if (other.new_clusters[i].count > 0) {
+    for (std::map<size_t, cluster>::const_iterator iter = other.new_clusters.begin();
+         iter != other.new_clusters.end(); ++iter) {
+      std::map<size_t, cluster>::iterator mine = new_clusters.find(iter->first);
+      if (mine == new_clusters.end()) new_clusters.insert(*iter);
+      else {
         if(IS_SPARSE == true)
-          plus_equal_vector(new_clusters[i].center_sparse, other.new_clusters[i].center_sparse);
+          plus_equal_vector(mine->second.center_sparse, iter->second.center_sparse);
         else
-          plus_equal_vector(new_clusters[i].center, other.new_clusters[i].center);
-        new_clusters[i].count += other.new_clusters[i].count;
+          plus_equal_vector(mine->second.center, iter->second.center);
+        mine->second.count += iter->second.count;
       }
     }
     num_changed += other.num_changed;
-    cost += other.cost;
     return *this;
   }
 
   void save(graphlab::oarchive& oarc) const {
-    oarc << new_clusters << num_changed <<cost;
+    oarc << new_clusters << num_changed;
   }
 
   void load(graphlab::iarchive& iarc) {
-    iarc >> new_clusters >> num_changed >> cost;
+    iarc >> new_clusters >> num_changed;
   }
 };
 
+
+/*
+ * Computes how far the centers moved and half the distance from each
+ * center to its nearest other center, for the bounds of
+ * kmeans_iteration().
+ */
+void compute_center_gaps() {
+  MAX_MOVED = SECOND_MAX_MOVED = 0;
+  MAX_MOVED_CLUSTER = 0;
+  for (size_t i = 0; i < NUM_CLUSTERS; ++i) {
+    const double moved = CLUSTERS[i].moved;
+    if (moved > MAX_MOVED) {
+      SECOND_MAX_MOVED = MAX_MOVED;
+      MAX_MOVED = moved;
+      MAX_MOVED_CLUSTER = i;
+    } else if (moved > SECOND_MAX_MOVED) {
+      SECOND_MAX_MOVED = moved;
+    }
+  }
+#ifdef _OPENMP
+  #pragma omp parallel for
+#endif
+  for (int i = 0; i < (int)NUM_CLUSTERS; ++i) {
+    double gap = std::numeric_limits<double>::infinity();
+    if (!CLUSTERS[i].empty()) {
+      for (size_t j = 0; j < NUM_CLUSTERS; ++j) {
+        if (j != (size_t)i && !CLUSTERS[j].empty()) {
+          gap = std::min(gap, center_distance(CLUSTERS[i], CLUSTERS[j]));
+        }
+      }
+    }
+    CLUSTERS[i].half_gap = 0.5 * std::sqrt(gap);
+  }
+}
+
+
+/*
+ * Replaces each center by the mean of its data points.
+ */
+void update_centers(graphlab::distributed_control& dc,
+                    cluster_center_reducer& cc) {
+  for (size_t i = 0;i < NUM_CLUSTERS; ++i) {
+    std::map<size_t, cluster>::iterator iter = cc.new_clusters.find(i);
+    if (iter == cc.new_clusters.end()) {
+      if (CLUSTERS[i].count > 0) {
+        dc.cout() << "Cluster " << i << " lost" << std::endl;
+        CLUSTERS[i] = cluster();
+      }
+      CLUSTERS[i].moved = 0;
+      continue;
+    }
+    cluster& c = iter->second;
+    double d = c.count;
+    if(IS_SPARSE)
+      scale_vector(c.center_sparse, 1.0 / d);
+    else
+      scale_vector(c.center, 1.0 / d);
+    c.prepare();
+    c.changed = true;
+    c.moved = CLUSTERS[i].empty() ? 0 : std::sqrt(center_distance(CLUSTERS[i], c));
+    CLUSTERS[i] = c;
+  }
+  compute_center_gaps();
+}
+
+
+/*
+ * Moves each center towards the mean of its data points in the
+ * minibatch, with a learning rate of one over the number of data
+ * points ever assigned to it (D. Sculley. Web-scale k-means
+ * clustering. WWW 2010).
+ */
+void update_centers_minibatch(cluster_center_reducer& cc) {
+  for (std::map<size_t, cluster>::iterator iter = cc.new_clusters.begin();
+       iter != cc.new_clusters.end(); ++iter) {
+    cluster& c = CLUSTERS[iter->first];
+    cluster& batch = iter->second;
+    c.count += batch.count;
+    const double rate = double(batch.count) / c.count;
+    if(IS_SPARSE) {
+      scale_vector(c.center_sparse, 1.0 - rate);
+      scale_vector(batch.center_sparse, 1.0 / c.count);
+      plus_equal_vector(c.center_sparse, batch.center_sparse);
+    } else {
+      scale_vector(c.center, 1.0 - rate);
+      scale_vector(batch.center, 1.0 / c.count);
+      plus_equal_vector(c.center, batch.center);
+    }
+    c.prepare();
+  }
+}
+
+
+/*
+ * Picks the K centers among the weighted candidates by k-means++.
+ */
+std::vector<cluster> kmeans_pp_candidates(const std::vector<cluster>& candidates,
+                                          const std::vector<double>& weights) {
+  std::vector<cluster> centers;
+  std::vector<double> distances(candidates.size(),
+                                std::numeric_limits<double>::infinity());
+  std::vector<double> p(candidates.size());
+  while (centers.size() < NUM_CLUSTERS) {
+    for (size_t i = 0; i < candidates.size(); ++i) {
+      p[i] = centers.empty() ? weights[i] : weights[i] * distances[i];
+    }
+    if (std::accumulate(p.begin(), p.end(), 0.0) <= 0) break;
+    const size_t next = graphlab::random::multinomial(p);
+    centers.push_back(candidates[next]);
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int i = 0; i < (int)candidates.size(); ++i) {
+      distances[i] = std::min(distances[i],
+                              center_distance(candidates[i], candidates[next]));
+    }
+  }
+  return centers;
+}
+
+
+/*
+ * k-means|| (B. Bahmani et al. Scalable k-means++. VLDB 2012). In each
+ * of a few rounds, every data point is sampled at once as a candidate
+ * center, with probability proportional to its distance to the nearest
+ * candidate, so that about oversampling * K candidates are added. The
+ * K centers are then picked among the candidates by k-means++, with
+ * each candidate weighted by the number of data points nearest to it.
+ */
+void kmeans_parallel_initialization(graphlab::distributed_control& dc,
+                                    graph_type& graph, size_t rounds,
+                                    double oversampling) {
+  CANDIDATES.resize(1);
+  if(IS_SPARSE == true){
+    random_sample_reducer_sparse rs = graph.map_reduce_vertices<random_sample_reducer_sparse>
+                                      (random_sample_reducer_sparse::get_weight);
+    CANDIDATES[0].center_sparse = rs.vtx;
+  }else{
+    random_sample_reducer rs = graph.map_reduce_vertices<random_sample_reducer>
+                                      (random_sample_reducer::get_weight);
+    CANDIDATES[0].center = rs.vtx;
+  }
+  CANDIDATES[0].prepare();
+  NEW_CANDIDATES = 0;
+  graph.transform_vertices(kmeans_parallel_update);
+
+  for (size_t round = 0;
+       round < rounds || CANDIDATES.size() < NUM_CLUSTERS; ++round) {
+    const double cost = graph.map_reduce_vertices<double>(get_best_distance);
+    if (cost <= 0) break;
+    SAMPLING_SCALE = oversampling * NUM_CLUSTERS / cost;
+    candidate_sample_reducer rs = graph.map_reduce_vertices<candidate_sample_reducer>
+                                  (candidate_sample_reducer::get_sample);
+    NEW_CANDIDATES = CANDIDATES.size();
+    for (size_t i = 0; i < rs.points.size(); ++i) {
+      rs.points[i].prepare();
+      CANDIDATES.push_back(rs.points[i]);
+    }
+    graph.transform_vertices(kmeans_parallel_update);
+    dc.cout() << "Initialization round " << round + 1 << ": "
+              << CANDIDATES.size() << " candidates" << std::endl;
+  }
+
+  candidate_weight_reducer rw = graph.map_reduce_vertices<candidate_weight_reducer>
+                                (candidate_weight_reducer::get_weight);
+  std::vector<double> weights(CANDIDATES.size(), 0);
+  for (std::map<size_t, double>::const_iterator iter = rw.weights.begin();
+       iter != rw.weights.end(); ++iter) {
+    weights[iter->first] = iter->second;
+  }
+  std::vector<cluster> centers;
+  if (dc.procid() == 0) centers = kmeans_pp_candidates(CANDIDATES, weights);
+  dc.broadcast(centers, dc.procid() == 0);
+  if (centers.size() < NUM_CLUSTERS) {
+    dc.cout() << "Only " << centers.size() << " distinct centers" << std::endl;
+  }
+  for (size_t i = 0; i < NUM_CLUSTERS; ++i) {
+    CLUSTERS[i] = i < centers.size() ? centers[i] : cluster();
+    CLUSTERS[i].prepare();
+  }
+  std::vector<cluster>().swap(CANDIDATES);
+}
+
 struct vertex_writer {
   std::string save_vertex(graph_type::vertex_type v) {
     std::stringstream strm;
@@ -773,6 +1132,9 @@ int main(int argc, char** argv) {
   std::string outdata_file;
   std::string edgedata_file;
   size_t MAX_ITERATION = 0;
+  size_t minibatch = 0;
+  size_t init_rounds = 5;
+  double oversampling = 2;
   bool use_id = false;
   clopts.attach_option("data", datafile,
                        "Input file. Each line holds a white-space or comma separated numeric vector");
@@ -803,6 +1165,15 @@ int main(int argc, char** argv) {
                        "[reward]. This mode must be used with --id option.");
   clopts.attach_option("max-iteration", MAX_ITERATION,
                        "The max number of iterations");
+  clopts.attach_option("minibatch", minibatch,
+                       "If set, will run mini-batch K-means, where each iteration "
+                       "moves the centers towards about this many sampled data points. "
+                       "The max number of iterations then defaults to 100.");
+  clopts.attach_option("init-rounds", init_rounds,
+                       "The number of sampling rounds of the K-means|| initialization.");
+  clopts.attach_option("oversampling", oversampling,
+                       "Each round of the K-means|| initialization samples about "
+                       "oversampling * clusters data points as candidate centers.");
 
   if(!clopts.parse(argc, argv)) return EXIT_FAILURE;
   if (datafile == "") {
@@ -818,6 +1189,10 @@ int main(int argc, char** argv) {
       std::cout << "--id is not optional when you use edge data\n";
       return EXIT_FAILURE;
     }
+    if (minibatch > 0) {
+      std::cout << "--minibatch cannot be used with edge data\n";
+      return EXIT_FAILURE;
+    }
   }
 
   graphlab::mpi_tools::init(argc, argv);
@@ -870,77 +1245,54 @@ int main(int argc, char** argv) {
     }
   }
 
-  dc.cout() << "Initializing using Kmeans++\n";
-  // ok. perform kmeans++ initialization
-  for (KMEANS_INITIALIZATION = 0;
-       KMEANS_INITIALIZATION < NUM_CLUSTERS;
-       ++KMEANS_INITIALIZATION) {
+  graphlab::timer ti;
+  dc.cout() << "Initializing using Kmeans||\n";
+  kmeans_parallel_initialization(dc, graph, init_rounds, oversampling);
 
-    if(IS_SPARSE == true){
-      random_sample_reducer_sparse rs = graph.map_reduce_vertices<random_sample_reducer_sparse>
-                                        (random_sample_reducer_sparse::get_weight);
-      CLUSTERS[KMEANS_INITIALIZATION].center_sparse = rs.vtx;
-      graph.transform_vertices(kmeans_pp_initialization_sparse);
-    }else{
-      random_sample_reducer rs = graph.map_reduce_vertices<random_sample_reducer>
-                                        (random_sample_reducer::get_weight);
-      CLUSTERS[KMEANS_INITIALIZATION].center = rs.vtx;
-      graph.transform_vertices(kmeans_pp_initialization);
+  size_t iteration_count = 0;
+  if (minibatch > 0) {
+    dc.cout() << "Running mini-batch Kmeans...\n";
+    if (MAX_ITERATION == 0) MAX_ITERATION = 100;
+    MINIBATCH_PROB = std::min(1.0, double(minibatch) / graph.num_vertices());
+    for (size_t i = 0; i < NUM_CLUSTERS; ++i) CLUSTERS[i].count = 0;
+    for (; iteration_count < MAX_ITERATION; ++iteration_count) {
+      cluster_center_reducer cc = graph.map_reduce_vertices<cluster_center_reducer>
+                                      (cluster_center_reducer::get_minibatch_sample);
+      update_centers_minibatch(cc);
     }
   }
 
-  // "reset" all clusters
-  for (size_t i = 0; i < NUM_CLUSTERS; ++i) CLUSTERS[i].changed = true;
-  // perform Kmeans iteration
+  // assign every data point to its nearest center
+  BOUNDS_VALID = false;
+  graph.transform_vertices(kmeans_iteration);
+  BOUNDS_VALID = true;
 
+  // perform Kmeans iteration
   dc.cout() << "Running Kmeans...\n";
-  bool clusters_changed = true;
-  size_t iteration_count = 0;
+  bool clusters_changed = minibatch == 0;
   while(clusters_changed) {
 		if(MAX_ITERATION > 0 && iteration_count >= MAX_ITERATION)
 			break;
 
     cluster_center_reducer cc = graph.map_reduce_vertices<cluster_center_reducer>
                                     (cluster_center_reducer::get_center);
+    size_t num_distances = NUM_DISTANCES.value;
+    NUM_DISTANCES.value = 0;
+    dc.all_reduce(num_distances);
     // the first round (iteration_count == 0) is not so meaningful
-    // since I am just recomputing the centers from the output of the KMeans++
+    // since I am just recomputing the centers from the output of the Kmeans||
     // initialization
     if (iteration_count > 0) {
       dc.cout() << "Kmeans iteration " << iteration_count << ": " <<
-                 "# points with changed assignments = " << cc.num_changed << 
-		 " total cost: " << cc.cost << std::endl;
-    }
-    for (size_t i = 0;i < NUM_CLUSTERS; ++i) {
-      double d = cc.new_clusters[i].count;
-      if(IS_SPARSE){
-        if (d > 0) scale_vector(cc.new_clusters[i].center_sparse, 1.0 / d);
-        if (cc.new_clusters[i].count == 0 && CLUSTERS[i].count > 0) {
-          dc.cout() << "Cluster " << i << " lost" << std::endl;
-          CLUSTERS[i].center_sparse.clear();
-          CLUSTERS[i].count = 0;
-          CLUSTERS[i].changed = false;
-        }
-        else {
-          CLUSTERS[i] = cc.new_clusters[i];
-          CLUSTERS[i].changed = true;
-        }
-      }else{
-        if (d > 0) scale_vector(cc.new_clusters[i].center, 1.0 / d);
-        if (cc.new_clusters[i].count == 0 && CLUSTERS[i].count > 0) {
-          dc.cout() << "Cluster " << i << " lost" << std::endl;
-          CLUSTERS[i].center.clear();
-          CLUSTERS[i].count = 0;
-          CLUSTERS[i].changed = false;
-        }
-        else {
-          CLUSTERS[i] = cc.new_clusters[i];
-          CLUSTERS[i].changed = true;
-        }
-      }
+                 "# points with changed assignments = " << cc.num_changed <<
+                 " distance computations: " << num_distances << std::endl;
     }
+    update_centers(dc, cc);
     clusters_changed = iteration_count == 0 || cc.num_changed > 0;
 
     if(edgedata_file.size() > 0){
+      // the engine does not maintain the bounds
+      BOUNDS_VALID = false;
       clopts.engine_args.set_option("factorized", true);
       graphlab::omni_engine<cluster_assignment> engine(dc, graph, "async", clopts);
       engine.signal_all();
@@ -952,6 +1304,10 @@ int main(int argc, char** argv) {
     ++iteration_count;
   }
 
+  graph.transform_vertices(exact_distance);
+  dc.cout() << "Total cost: "
+            << graph.map_reduce_vertices<double>(get_best_distance) << std::endl
+            << "Kmeans in " << ti.current_time() << " seconds" << std::endl;
 
   if (!outcluster_file.empty() && dc.procid() == 0) {
     dc.cout() << "Writing Cluster Centers..." << std::endl;
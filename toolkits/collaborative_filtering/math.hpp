@@ -818,6 +818,8 @@ gather_type map_reduce_ortho(const graph_type::vertex_type & vertex){
         END_TRACEPOINT(orth1);
         //pgraph->transform_vertices(transform_ortho, nodes);
         mat[_curoffset] = mat[_curoffset].orthogonalize(); 
+        // the assignment leaves pcurrent pointing at a temporary
+        pcurrent = &current;
       } //for ortho_repeast 
     }
 
@@ -339,7 +339,7 @@ class sgd_vertex_program :
 	}; // end of sgd vertex program
 
 
-struct error_aggregator : public graphlab::IS_POD_TYPE {
+struct error_aggregator : public graphlab::IS_DENSE_SUM_TYPE<double> {
 	typedef sgd_vertex_program::icontext_type icontext_type;
 	typedef graph_type::edge_type edge_type;
 	double train_error, validation_error;
@@ -461,7 +461,7 @@ double als_vertex_program::MINVAL = -1e+100;
  * error_aggregators and are used by the engine.add_edge_aggregator
  * api.
  */
-struct error_aggregator : public graphlab::IS_POD_TYPE {
+struct error_aggregator : public graphlab::IS_DENSE_SUM_TYPE<double> {
   typedef als_vertex_program::icontext_type icontext_type;
   typedef graph_type::edge_type edge_type;
   double train_error, validation_error;
@@ -33,6 +33,7 @@
 #include "eigen_serialization.hpp"
 #include <graphlab/util/stl_util.hpp>
 #include <graphlab.hpp>
+#include <graphlab/macros_def.hpp>
 
 
 
@@ -66,6 +67,7 @@ mat a,PT;
 bool v_vector = false;
 int input_file_offset = 0; //if set to non zero, each row/col id will be reduced the input_file_offset
 vec singular_values;
+std::string method = "lanczos";
 
 DECLARE_TRACER(svd_bidiagonal);
 DECLARE_TRACER(svd_error_estimate);
@@ -351,6 +353,45 @@ void compute_ritz(graph_type::vertex_type & vertex){
 
 
 
+/**
+ * \brief Saves the singular vectors and the predictions, when requested.
+ * The first nconv entries of pvec hold the singular vectors.
+ */
+void save_output(){
+  if (save_vectors){
+    if (nconv == 0)
+      logstream(LOG_FATAL)<<"No converged vectors. Aborting the save operation" << std::endl;
+    if (predictions == "")
+      logstream(LOG_FATAL)<<"Please specify prediction output fie name using the --predictions=filename command"<<std::endl;
+
+    BEGIN_TRACEPOINT(svd_vectors);
+    std::cout << "Saving singular value triplets to files: " << predictions << ".U.* and "<< predictions << ".V.*" <<std::endl;
+    const bool gzip_output = false;
+    const bool save_vertices = false;
+    const bool save_edges = true;
+    const size_t threads_per_machine = 1;
+    pgraph->save(predictions + ".U", linear_model_saver_U(),
+          gzip_output, save_edges, save_vertices, threads_per_machine);
+      pgraph->save(predictions + ".V", linear_model_saver_V(),
+          gzip_output, save_edges, save_vertices, threads_per_machine);
+    END_TRACEPOINT(svd_vectors);
+  }
+
+  if(!predictions.empty()) {
+    std::cout << "Saving predictions" << std::endl;
+    const bool gzip_output = false;
+    const bool save_vertices = false;
+    const bool save_edges = true;
+    const size_t threads_per_machine = 1;
+
+    //save the predictions
+    pgraph->save(predictions, prediction_saver(),
+               gzip_output, save_vertices, 
+               save_edges, threads_per_machine);
+  }
+}
+
+
 void lanczos(bipartite_graph_descriptor & info, timer & mytimer, vec & errest, 
     const std::string & vecfile){
 
@@ -542,40 +583,207 @@ void lanczos(bipartite_graph_descriptor & info, timer & mytimer, vec & errest,
   }
   END_TRACEPOINT(svd_error2);
 
-  if (save_vectors){
-    if (nconv == 0)
-      logstream(LOG_FATAL)<<"No converged vectors. Aborting the save operation" << std::endl;
-    if (predictions == "")
-      logstream(LOG_FATAL)<<"Please specify prediction output fie name using the --predictions=filename command"<<std::endl;
+  sigma.conservativeResize(nconv);
+  singular_values = sigma;
+  save_output();
+}
 
-    BEGIN_TRACEPOINT(svd_vectors);
-    std::cout << "Saving singular value triplets to files: " << predictions << ".U.* and "<< predictions << ".V.*" <<std::endl;
-    const bool gzip_output = false;
-    const bool save_vertices = false;
-    const bool save_edges = true;
-    const size_t threads_per_machine = 1;
-    pgraph->save(predictions + ".U", linear_model_saver_U(),
-          gzip_output, save_edges, save_vertices, threads_per_machine);
-      pgraph->save(predictions + ".V", linear_model_saver_V(),
-          gzip_output, save_edges, save_vertices, threads_per_machine);
-    END_TRACEPOINT(svd_vectors);
+/**
+ * \brief A row of a block of nv vectors, summed over the replicas of a
+ * vertex. An empty block adds nothing.
+ */
+struct block_gather {
+  vec v;
+  block_gather() { }
+  explicit block_gather(const vec& v) : v(v) { }
+  block_gather& operator+=(const block_gather& other) {
+    if (v.size() == 0) v = other.v;
+    else if (other.v.size() > 0) v += other.v;
+    return *this;
   }
+  void save(graphlab::oarchive& arc) const { arc << v; }
+  void load(graphlab::iarchive& arc) { arc >> v; }
+};
 
-  sigma.conservativeResize(nconv);
-  singular_values = sigma;
-  if(!predictions.empty()) {
-    std::cout << "Saving predictions" << std::endl;
-    const bool gzip_output = false;
-    const bool save_vertices = false;
-    const bool save_edges = true;
-    const size_t threads_per_machine = 1;
+// where a block product is written in pvec
+int block_offset = 0;
 
-    //save the predictions
-    pgraph->save(predictions, prediction_saver(),
-               gzip_output, save_vertices, 
-               save_edges, threads_per_machine);
+bool is_row(const graph_type::vertex_type& vertex) {
+  return vertex.id() < (uint)rows;
+}
+
+bool is_col(const graph_type::vertex_type& vertex) {
+  return vertex.id() >= (uint)rows;
+}
+
+/**
+ * \brief A row of A V for a row vertex, or of A^T U for a column
+ * vertex, where U and V are the blocks in pvec[0, nv).
+ */
+block_gather block_product_gather(graph_type::lvid_type lvid, graph_type& graph) {
+  graph_type::local_vertex_type vertex = graph.l_vertex(lvid);
+  vec sum = zeros(nv);
+  if (vertex.global_id() < (uint)rows) {
+    foreach(graph_type::local_edge_type edge, vertex.out_edges()) {
+      if (edge.data().role != edge_data::PREDICT)
+        sum += edge.data().obs * edge.target().data().pvec.head(nv);
+    }
+  } else {
+    foreach(graph_type::local_edge_type edge, vertex.in_edges()) {
+      if (edge.data().role != edge_data::PREDICT)
+        sum += edge.data().obs * edge.source().data().pvec.head(nv);
+    }
   }
- 
+  return block_gather(sum);
+}
+
+void block_product_apply(graph_type::lvid_type lvid, const block_gather& sum,
+                         graph_type& graph) {
+  graph.l_vertex(lvid).data().pvec.segment(block_offset, nv) = sum.v;
+}
+
+/**
+ * \brief Sends the block of the owner of a vertex to its mirrors.
+ */
+block_gather block_sync_gather(graph_type::lvid_type lvid, graph_type& graph) {
+  if (!graph.l_is_master(lvid)) return block_gather();
+  return block_gather(graph.l_vertex(lvid).data().pvec.head(nv));
+}
+
+void block_sync_apply(graph_type::lvid_type lvid, const block_gather& block,
+                      graph_type& graph) {
+  graph.l_vertex(lvid).data().pvec.head(nv) = block.v;
+}
+
+/**
+ * \brief Orthonormalizes in place the block of the vertices in lvids,
+ * the rows or the columns owned by this machine, and returns R.
+ *
+ * TSQR: each machine computes the QR of its local block, and all the
+ * machines compute the same QR of the stacked local R factors. The Q of
+ * the local block times its part of the second Q is the local part of
+ * the orthonormal block.
+ */
+mat tsqr(graphlab::distributed_control& dc, graph_type& graph,
+         const std::vector<graph_type::lvid_type>& lvids) {
+  const int m = lvids.size();
+  const int r = std::min(m, nv);
+  mat Y(m, nv);
+  for (int i = 0; i < m; i++)
+    Y.row(i) = graph.l_vertex(lvids[i]).data().pvec.head(nv).transpose();
+  HouseholderQR<mat> local_qr;
+  std::vector<mat> local_r(dc.numprocs());
+  local_r[dc.procid()] = zeros(nv, nv);
+  if (r > 0) {
+    local_qr.compute(Y);
+    local_r[dc.procid()].topRows(r) =
+      local_qr.matrixQR().topRows(r).triangularView<Upper>();
+  }
+  dc.all_gather(local_r);
+
+  mat stacked(nv * dc.numprocs(), nv);
+  for (size_t p = 0; p < local_r.size(); p++)
+    stacked.middleRows(p * nv, nv) = local_r[p];
+  HouseholderQR<mat> qr(stacked);
+  if (r > 0) {
+    const mat Q2 = qr.householderQ() * mat::Identity(stacked.rows(), nv);
+    const mat Q1 = local_qr.householderQ() * mat::Identity(m, r);
+    Y = Q1 * Q2.middleRows(dc.procid() * nv, r);
+    for (int i = 0; i < m; i++)
+      graph.l_vertex(lvids[i]).data().pvec.head(nv) = Y.row(i).transpose();
+  }
+  return qr.matrixQR().topRows(nv).triangularView<Upper>();
+}
+
+/**
+ * \brief Randomized block Krylov SVD, following
+ *   N. Halko, P. G. Martinsson and J. A. Tropp. Finding Structure with
+ *   Randomness: Probabilistic Algorithms for Constructing Approximate
+ *   Matrix Decompositions. SIAM Review, 2011.
+ *
+ * The rows of U and V are blocks of nv vectors kept contiguously in
+ * pvec[0, nv) of the row and the column vertices. Each product with A
+ * or A^T multiplies the whole block in a single pass over the graph,
+ * and each block is orthonormalized by TSQR, so a pass advances nv
+ * vectors instead of one. max_iter is the number of power iterations.
+ */
+void block_svd(graphlab::distributed_control& dc, graph_type& graph,
+               const graphlab::graphlab_options& opts){
+  data_size = 2*nv;
+  std::vector<graph_type::lvid_type> row_masters, col_masters;
+  for (graph_type::lvid_type lvid = 0; lvid < graph.num_local_vertices(); lvid++){
+    vertex_data& vdata = graph.l_vertex(lvid).data();
+    vdata.pvec = zeros(data_size);
+    if (!graph.l_is_master(lvid))
+      continue;
+    if (graph.global_vid(lvid) < (uint)rows)
+      row_masters.push_back(lvid);
+    else {
+      col_masters.push_back(lvid);
+      for (int i = 0; i < nv; i++)
+        vdata.pvec[i] = graphlab::random::gaussian();
+    }
+  }
+  vertex_set row_set = graph.select(is_row);
+  vertex_set col_set = graph.select(is_col);
+  graphlab::graph_gather_apply<graph_type, block_gather>
+    product(graph, block_product_gather, block_product_apply, opts);
+  graphlab::graph_gather_apply<graph_type, block_gather>
+    sync(graph, block_sync_gather, block_sync_apply, opts);
+
+  // U = orth(A V) for a random V
+  sync.exec(col_set);
+  product.exec(row_set);
+  tsqr(dc, graph, row_masters);
+  sync.exec(row_set);
+  for (int i = 0; i < max_iter; i++){
+    logstream(LOG_EMPH)<<"Starting power iteration: " << i << std::endl;
+    product.exec(col_set);
+    tsqr(dc, graph, col_masters);
+    sync.exec(col_set);
+    product.exec(row_set);
+    tsqr(dc, graph, row_masters);
+    sync.exec(row_set);
+  }
+  // A^T U = V R, so A ~ U R^T V^T, and the SVD of R^T rotates U and V
+  product.exec(col_set);
+  const mat R = tsqr(dc, graph, col_masters);
+  sync.exec(col_set);
+  JacobiSVD<mat> small_svd(R.transpose(), ComputeFullU | ComputeFullV);
+  const mat rotate_u = small_svd.matrixU().transpose();
+  const mat rotate_v = small_svd.matrixV().transpose();
+  for (graph_type::lvid_type lvid = 0; lvid < graph.num_local_vertices(); lvid++){
+    vec& pvec = graph.l_vertex(lvid).data().pvec;
+    const bool row = graph.global_vid(lvid) < (uint)rows;
+    pvec.head(nv) = (row ? rotate_u : rotate_v) * pvec.head(nv);
+  }
+  nconv = nsv;
+  singular_values = small_svd.singularValues().head(nconv);
+
+  // A V and A^T U in a single pass, for the error estimates
+  block_offset = nv;
+  product.exec();
+  vec err = zeros(2*nconv);
+  for (size_t i = 0; i < row_masters.size() + col_masters.size(); i++){
+    const bool row = i < row_masters.size();
+    const vec& pvec = graph.l_vertex(row ? row_masters[i] :
+                                     col_masters[i - row_masters.size()]).data().pvec;
+    for (int j = 0; j < nconv; j++){
+      const double diff = pvec[nv + j] - singular_values[j] * pvec[j];
+      err[row ? j : nconv + j] += diff * diff;
+    }
+  }
+  dc.all_reduce(err);
+  if (dc.procid() == 0){
+    printf(" Number of computed signular values %d\n", nconv);
+    for (int i = 0; i < nconv; i++){
+      double e = sqrt(err[i] + err[nconv + i]);
+      if (singular_values[i] > tol)
+        e /= singular_values[i];
+      printf("Singular value %d \t%13.6g\tError estimate: %13.6g\n", i, singular_values[i], e);
+    }
+  }
+  save_output();
 }
 
 void start_engine(){
@@ -635,6 +843,7 @@ int main(int argc, char** argv) {
   clopts.attach_option("predictions", predictions, "predictions file prefix");
   clopts.attach_option("binary", binary, "If true, all edges are weighted as one");
   clopts.attach_option("input_file_offset", input_file_offset, "input file node id offset (default 0)");
+  clopts.attach_option("method", method, "lanczos, or block for a randomized block Krylov SVD with max_iter power iterations");
   if(!clopts.parse(argc, argv) || input_dir == "") {
     std::cout << "Error in parsing command line arguments." << std::endl;
     clopts.print_description();
@@ -689,6 +898,9 @@ int main(int argc, char** argv) {
   info.rows = rows;
   info.cols = cols;
 
+  if (method != "lanczos" && method != "block")
+    logstream(LOG_FATAL)<<"--method should be lanczos or block" << std::endl;
+
   if (nv < nsv){
     logstream(LOG_FATAL)<<"Please set the number of vectors --nv=XX, to be at least the number of support vectors --nsv=XX or larger" << std::endl;
   }
@@ -735,33 +947,37 @@ int main(int argc, char** argv) {
   engine_type engine(dc, graph, exec_type, clopts);
   pengine = &engine;
 
-  dc.cout() << "Running SVD (gklanczos)" << std::endl;
+  dc.cout() << "Running SVD (" << (method == "block" ? "block" : "gklanczos") << ")" << std::endl;
   dc.cout() << "(C) Code by Danny Bickson, CMU " << std::endl;
   dc.cout() << "Please send bug reports to danny.bickson@gmail.com" << std::endl;
   timer.start();
 
-  init_lanczos(&graph, info);
-  init_math(&graph, info, ortho_repeats, update_function);
-  if (vecfile.size() > 0){
-    std::cout << "Load inital vector from file" << vecfile << std::endl;
-    FILE * file = fopen((vecfile).c_str(), "r");
-    if (file == NULL)
-      logstream(LOG_FATAL)<<"Failed to open initial vector"<< std::endl;
-    vec input = vec::Zero(rows);
-    double val = 0;
-    for (int i=0; i< rows; i++){
-      int rc = fscanf(file, "%lg\n", &val);
-      if (rc != 1)
-        logstream(LOG_FATAL)<<"Failed to read initial vector (on line: "<< i << " ) " << std::endl;
-      input[i] = val;
-    }
-    fclose(file);
-    DistVec v0(info, 0, false, "v0");
-    v0 = input;
-  }  
-
   vec errest;
-  lanczos( info, timer, errest, vecfile);
+  if (method == "block")
+    block_svd(dc, graph, clopts);
+  else {
+    init_lanczos(&graph, info);
+    init_math(&graph, info, ortho_repeats, update_function);
+    if (vecfile.size() > 0){
+      std::cout << "Load inital vector from file" << vecfile << std::endl;
+      FILE * file = fopen((vecfile).c_str(), "r");
+      if (file == NULL)
+        logstream(LOG_FATAL)<<"Failed to open initial vector"<< std::endl;
+      vec input = vec::Zero(rows);
+      double val = 0;
+      for (int i=0; i< rows; i++){
+        int rc = fscanf(file, "%lg\n", &val);
+        if (rc != 1)
+          logstream(LOG_FATAL)<<"Failed to read initial vector (on line: "<< i << " ) " << std::endl;
+        input[i] = val;
+      }
+      fclose(file);
+      DistVec v0(info, 0, false, "v0");
+      v0 = input;
+    }  
+
+    lanczos( info, timer, errest, vecfile);
+  }
 
   if (graphlab::mpi_tools::rank()==0)
     write_output_vector(predictions + ".singular_values", singular_values, false, "%GraphLab SVD Solver library. This file contains the singular values.");
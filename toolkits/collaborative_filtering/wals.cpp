@@ -195,69 +195,12 @@ get_other_vertex(graph_type::edge_type& edge,
  *
  * To do this in the Gather-Apply-Scatter model the gather function
  * computes and returns a pair consisting of XtX and Xy which are then
- * added. The gather type represents that tuple and provides the
- * necessary gather_type::operator+= operation.
+ * added. graphlab::latent_factor_gather represents that tuple. gather
+ * returns a view of the neighbor's factor, which operator+= applies to
+ * the sum as an in place rank-1 update.
  *
  */
-class gather_type {
-public:
-  /**
-   * \brief Stores the current sum of nbr.factor.transpose() *
-   * nbr.factor
-   */
-  mat_type XtX;
-
-  /**
-   * \brief Stores the current sum of nbr.factor * edge.obs
-   */
-  vec_type Xy;
-
-  /**
-   * \brief Stores the weight of this edge
-   */
-  float weight;
-
-  /** \brief basic default constructor */
-  gather_type() { }
-
-  /**
-   * \brief This constructor computes XtX and Xy and stores the result
-   * in XtX and Xy
-   */
-  gather_type(const vec_type& X, const double y, const float weight) :
-    XtX(X.size(), X.size()), Xy(X.size()) {
-    XtX.triangularView<Eigen::Upper>() = X * X.transpose() * weight;
-    Xy = X * y * weight;
-  } // end of constructor for gather type
-
-  /** \brief Save the values to a binary archive */
-  void save(graphlab::oarchive& arc) const { arc << XtX << Xy << weight; }
-
-  /** \brief Read the values from a binary archive */
-  void load(graphlab::iarchive& arc) { arc >> XtX >> Xy >> weight; }  
-
-  /** 
-   * \brief Computes XtX += other.XtX and Xy += other.Xy updating this
-   * tuples value
-   */
-  gather_type& operator+=(const gather_type& other) {
-    if(other.Xy.size() == 0) {
-      ASSERT_EQ(other.XtX.rows(), 0);
-      ASSERT_EQ(other.XtX.cols(), 0);
-    } else {
-      if(Xy.size() == 0) {
-        ASSERT_EQ(XtX.rows(), 0); 
-        ASSERT_EQ(XtX.cols(), 0);
-        XtX = other.XtX; Xy = other.Xy;
-      } else {
-        XtX.triangularView<Eigen::Upper>() += other.XtX;  
-        Xy += other.Xy;
-      }
-    }
-    return *this;
-  } // end of operator+=
-
-}; // end of gather type
+typedef graphlab::latent_factor_gather gather_type;
 
 
 
@@ -313,7 +256,9 @@ public:
                      edge_type& edge) const {
     if(edge.data().role == edge_data::TRAIN) {
       const vertex_type other_vertex = get_other_vertex(edge, vertex);
-      return gather_type(other_vertex.data().factor, edge.data().obs, edge.data().weight);
+      const vec_type& factor = other_vertex.data().factor;
+      return gather_type(factor.data(), factor.size(), edge.data().obs,
+                         edge.data().weight);
     } else return gather_type();
   } // end of gather function
 
@@ -324,9 +269,14 @@ public:
     vertex_data& vdata = vertex.data(); 
     // Determine the number of neighbors.  Each vertex has only in or
     // out edges depending on which side of the graph it is located
-    if(sum.Xy.size() == 0) { vdata.residual = 0; ++vdata.nupdates; return; }
-    mat_type XtX = sum.XtX;
-    vec_type Xy = sum.Xy;
+    if(sum.empty()) { vdata.residual = 0; ++vdata.nupdates; return; }
+    const int n = sum.size();
+    mat_type XtX(n, n);
+    vec_type Xy(n);
+    for(int i = 0; i < n; ++i) {
+      for(int j = i; j < n; ++j) XtX(i,j) = sum.xtx(i, j);
+      Xy(i) = sum.xty(i);
+    }
     // Add regularization
     for(int i = 0; i < XtX.rows(); ++i) XtX(i,i) += LAMBDA; // /nneighbors;
     // Solve the least squares problem using eigen ----------------------------
@@ -372,6 +322,17 @@ public:
 
 }; // end of als vertex program
 
+/**
+ * \brief ALS always gathers and scatters on all edges, and an empty
+ * gather_type is the identity of its sum, which lets the synchronous
+ * engine inline gather into its edge loop.
+ */
+namespace graphlab {
+  template <>
+  struct static_edge_traits<als_vertex_program>
+    : public static_edge_dirs<ALL_EDGES, ALL_EDGES> { };
+}
+
 
 
 /**
@@ -449,7 +410,7 @@ double als_vertex_program::MINVAL = -1e+100;
  * error_aggregators and are used by the engine.add_edge_aggregator
  * api.
  */
-struct error_aggregator : public graphlab::IS_POD_TYPE {
+struct error_aggregator : public graphlab::IS_DENSE_SUM_TYPE<double> {
   typedef als_vertex_program::icontext_type icontext_type;
   typedef graph_type::edge_type edge_type;
   double train_error, validation_error;
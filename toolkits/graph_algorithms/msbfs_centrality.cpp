@@ -0,0 +1,632 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+#include <graphlab.hpp>
+
+/*
+ * Closeness and betweenness centrality over unweighted shortest paths,
+ * from many sources at once, following
+ *
+ *    M. Then et al. The More the Merrier: Efficient Multi-Source Graph
+ *    Traversal. VLDB 2015.
+ *
+ *    U. Brandes. A Faster Algorithm for Betweenness Centrality. Journal
+ *    of Mathematical Sociology, 2001.
+ *
+ * The sources are processed in batches of 64 * W.  Each vertex keeps,
+ * as W words of bits, the set of sources of the batch which have
+ * reached it and the set which reached it at the current level.  One
+ * run of the synchronous engine advances all the breadth first
+ * searches of a batch together, one level per iteration: a vertex
+ * ORs the frontier words of its in-neighbors and keeps the bits it has
+ * not seen.
+ *
+ * For betweenness, a vertex also keeps for each level at which it was
+ * reached the bits of the sources which reached it then, and for each
+ * of those sources the number of shortest paths sigma and the
+ * dependency delta.  The forward searches sum sigma over the
+ * predecessors, and the dependencies are accumulated backwards one
+ * level at a time, from the out-neighbors one level further from the
+ * source.  Only the sources which reach a vertex take any space.
+ *
+ * Both passes share the one engine run of the batch.  Each vertex
+ * signals itself for the deepest of its levels still to accumulate,
+ * and the engine runs in delta-stepping bucket mode, so that the
+ * searches run first and then the levels from the deepest back to the
+ * sources (see batch_step).
+ *
+ * With --samples the sources are a random sample and the betweenness
+ * is scaled up by the number of vertices over the number of samples.
+ * The closeness of a vertex is the number of sources which reach it
+ * over the sum of their distances to it.
+ */
+
+
+/*
+ * The message of the vertex program: the step at which the vertex runs
+ * next.  Step 0 is the breadth first searches, and step
+ * BACKWARD_STEP - level accumulates the dependencies of the sources
+ * which reached the vertex at that level.  With the engine option
+ * delta = 1 each super-step runs the lowest step pending on any vertex.
+ */
+const size_t BACKWARD_STEP = size_t(1) << 32;
+
+struct batch_step : public graphlab::IS_POD_TYPE {
+  size_t step;
+  batch_step(size_t step = 0) : step(step) { }
+  batch_step& operator+=(const batch_step& other) {
+    step = std::min(step, other.step);
+    return *this;
+  }
+  double priority() const { return -double(step); }
+};
+
+// Follow edges in both directions
+bool UNDIRECTED = false;
+// Also compute betweenness
+bool BETWEENNESS = true;
+
+// The sources of the current batch, sorted
+std::vector<graphlab::vertex_id_type> BATCH;
+
+
+/*
+ * Returns the number of bits of the W words below bit s.
+ */
+inline size_t rank_below(const uint64_t* bits, size_t s) {
+  size_t ret = 0;
+  for (size_t i = 0; i < s / 64; ++i) ret += __builtin_popcountl(bits[i]);
+  const uint64_t low = (uint64_t(1) << (s % 64)) - 1;
+  return ret + __builtin_popcountl(bits[s / 64] & low);
+}
+
+template <size_t W>
+inline bool any_bit(const uint64_t* bits) {
+  uint64_t ret = 0;
+  for (size_t i = 0; i < W; ++i) ret |= bits[i];
+  return ret != 0;
+}
+
+
+/*
+ * A set of the sources of a batch, as W words of bits, with an
+ * optional value for each source in the set, in the order of the
+ * bits.  operator+= takes the union of the sets and sums the values
+ * of the sources in both.
+ */
+template <size_t W>
+struct source_set {
+  uint64_t bits[W];
+  std::vector<double> values;
+
+  source_set() { std::fill(bits, bits + W, 0); }
+
+  source_set& operator+=(const source_set& other) {
+    if (other.values.empty()) {
+      for (size_t i = 0; i < W; ++i) bits[i] |= other.bits[i];
+      return *this;
+    }
+    std::vector<double> merged;
+    merged.reserve(values.size() + other.values.size());
+    size_t a = 0, b = 0;
+    for (size_t i = 0; i < W; ++i) {
+      uint64_t both = bits[i] | other.bits[i];
+      while (both) {
+        const uint64_t mask = both & (~both + 1);
+        double val = 0;
+        if (bits[i] & mask) val += values[a++];
+        if (other.bits[i] & mask) val += other.values[b++];
+        merged.push_back(val);
+        both ^= mask;
+      }
+      bits[i] |= other.bits[i];
+    }
+    values.swap(merged);
+    return *this;
+  }
+
+  void save(graphlab::oarchive& oarc) const {
+    graphlab::serialize(oarc, bits, sizeof(bits));
+    oarc << values;
+  }
+  void load(graphlab::iarchive& iarc) {
+    graphlab::deserialize(iarc, bits, sizeof(bits));
+    iarc >> values;
+  }
+};
+
+
+/*
+ * The sources which reached a vertex at a level.  Their sigma and
+ * delta are at offset, offset + 1, ... in the vertex data.
+ */
+template <size_t W>
+struct level_entry : public graphlab::IS_POD_TYPE {
+  uint32_t level;
+  uint32_t offset;
+  uint64_t bits[W];
+};
+
+
+template <size_t W>
+struct vertex_data {
+  // The sources of the batch which reached this vertex
+  uint64_t seen[W];
+  // The sources which reached this vertex at level stamp
+  uint64_t frontier[W];
+  uint32_t stamp;
+  // Per level sources, sigma and delta, for betweenness
+  std::vector<level_entry<W> > entries;
+  std::vector<double> sigma;
+  std::vector<double> delta;
+  // Results accumulated over the batches
+  double farness;
+  double reached;
+  double betweenness;
+
+  vertex_data() : stamp(0), farness(0), reached(0), betweenness(0) {
+    clear_batch();
+  }
+
+  void clear_batch() {
+    std::fill(seen, seen + W, 0);
+    std::fill(frontier, frontier + W, 0);
+    stamp = 0;
+    entries.clear();
+    sigma.clear();
+    delta.clear();
+  }
+
+  /* Returns the entry at the level, or NULL */
+  const level_entry<W>* find_level(size_t level) const {
+    for (size_t i = 0; i < entries.size(); ++i) {
+      if (entries[i].level == level) return &entries[i];
+    }
+    return NULL;
+  }
+
+  /* Returns the deepest level above 0 and below the given one, or 0 */
+  size_t level_below(size_t level) const {
+    for (size_t i = entries.size(); i > 0; --i) {
+      if (entries[i - 1].level < level) return entries[i - 1].level;
+    }
+    return 0;
+  }
+
+  void save(graphlab::oarchive& oarc) const {
+    graphlab::serialize(oarc, seen, sizeof(seen));
+    graphlab::serialize(oarc, frontier, sizeof(frontier));
+    oarc << stamp << entries << sigma << delta
+         << farness << reached << betweenness;
+  }
+  void load(graphlab::iarchive& iarc) {
+    graphlab::deserialize(iarc, seen, sizeof(seen));
+    graphlab::deserialize(iarc, frontier, sizeof(frontier));
+    iarc >> stamp >> entries >> sigma >> delta
+         >> farness >> reached >> betweenness;
+  }
+};
+
+
+template <size_t W>
+struct msbfs {
+  typedef vertex_data<W> vdata_type;
+  typedef graphlab::distributed_graph<vdata_type, graphlab::empty> graph_type;
+  typedef typename graph_type::vertex_type vertex_type;
+  typedef source_set<W> gather_type;
+
+  class msbfs_program :
+    public graphlab::ivertex_program<graph_type, gather_type, batch_step>,
+    public graphlab::IS_POD_TYPE {
+    // The step of the message the vertex was signaled with
+    size_t step;
+  public:
+    typedef graphlab::ivertex_program<graph_type, gather_type, batch_step> base;
+    typedef typename base::icontext_type icontext_type;
+    typedef typename base::edge_type edge_type;
+    typedef typename base::edge_dir_type edge_dir_type;
+
+    msbfs_program() : step(0) { }
+
+    void init(icontext_type& context, const vertex_type& vertex,
+              const batch_step& msg) {
+      step = msg.step;
+    }
+
+    /*
+     * The searches move along out edges, so the frontier is gathered
+     * from the in edges and the dependencies from the out edges.
+     */
+    edge_dir_type gather_edges(icontext_type& context,
+                               const vertex_type& vertex) const {
+      if (forward() && context.iteration() == 0) return graphlab::NO_EDGES;
+      if (UNDIRECTED) return graphlab::ALL_EDGES;
+      return forward() ? graphlab::IN_EDGES : graphlab::OUT_EDGES;
+    }
+
+    gather_type gather(icontext_type& context, const vertex_type& vertex,
+                       edge_type& edge) const {
+      const vertex_type other = edge.source().id() == vertex.id() ?
+                                edge.target() : edge.source();
+      if (forward()) return gather_frontier(context, vertex, other);
+      else return gather_dependency(vertex, other);
+    }
+
+    void apply(icontext_type& context, vertex_type& vertex,
+               const gather_type& total) {
+      if (forward()) apply_frontier(context, vertex, total);
+      else apply_dependency(vertex, total);
+      // run again for the deepest level left to accumulate; level 0,
+      // the sources themselves, is not counted
+      if (BETWEENNESS) {
+        const size_t level = vertex.data().level_below(
+            forward() ? size_t(-1) : accumulate_level());
+        if (level > 0) context.signal(vertex, batch_step(BACKWARD_STEP - level));
+      }
+    }
+
+    edge_dir_type scatter_edges(icontext_type& context,
+                                const vertex_type& vertex) const {
+      if (!forward() || vertex.data().stamp != context.iteration() ||
+          !any_bit<W>(vertex.data().frontier)) {
+        return graphlab::NO_EDGES;
+      }
+      return UNDIRECTED ? graphlab::ALL_EDGES : graphlab::OUT_EDGES;
+    }
+
+    void scatter(icontext_type& context, const vertex_type& vertex,
+                 edge_type& edge) const {
+      context.signal(edge.source().id() == vertex.id() ?
+                     edge.target() : edge.source());
+    }
+
+  private:
+    bool forward() const { return step < BACKWARD_STEP / 2; }
+    size_t accumulate_level() const { return BACKWARD_STEP - step; }
+
+    /*
+     * The sources which reached the other vertex at the previous level
+     * and not yet this one, with the number of shortest paths to the
+     * other vertex.
+     */
+    gather_type gather_frontier(icontext_type& context,
+                                const vertex_type& vertex,
+                                const vertex_type& other) const {
+      gather_type ret;
+      const vdata_type& odata = other.data();
+      if (odata.stamp + 1 != context.iteration()) return ret;
+      const vdata_type& vdata = vertex.data();
+      for (size_t i = 0; i < W; ++i) {
+        ret.bits[i] = odata.frontier[i] & ~vdata.seen[i];
+      }
+      if (BETWEENNESS && any_bit<W>(ret.bits)) {
+        const level_entry<W>& entry = odata.entries.back();
+        for (size_t i = 0; i < W; ++i) {
+          for (uint64_t b = ret.bits[i]; b; b &= b - 1) {
+            const size_t s = 64 * i + __builtin_ctzl(b);
+            ret.values.push_back(
+                odata.sigma[entry.offset + rank_below(entry.bits, s)]);
+          }
+        }
+      }
+      return ret;
+    }
+
+    void apply_frontier(icontext_type& context, vertex_type& vertex,
+                        const gather_type& total) {
+      if (context.iteration() == 0) return;
+      vdata_type& vdata = vertex.data();
+      size_t count = 0;
+      for (size_t i = 0; i < W; ++i) {
+        vdata.frontier[i] = total.bits[i] & ~vdata.seen[i];
+        vdata.seen[i] |= vdata.frontier[i];
+        count += __builtin_popcountl(vdata.frontier[i]);
+      }
+      if (count == 0) return;
+      vdata.stamp = context.iteration();
+      vdata.farness += double(count) * context.iteration();
+      vdata.reached += count;
+      if (BETWEENNESS) {
+        level_entry<W> entry;
+        entry.level = vdata.stamp;
+        entry.offset = vdata.sigma.size();
+        std::copy(vdata.frontier, vdata.frontier + W, entry.bits);
+        vdata.entries.push_back(entry);
+        // every bit of the frontier is in the total
+        size_t j = 0;
+        for (size_t i = 0; i < W; ++i) {
+          for (uint64_t b = total.bits[i]; b; b &= b - 1, ++j) {
+            if (vdata.frontier[i] & (b & (~b + 1))) {
+              vdata.sigma.push_back(total.values[j]);
+              vdata.delta.push_back(0);
+            }
+          }
+        }
+      }
+    }
+
+    /*
+     * For the sources which reached this vertex at the level being
+     * accumulated and the other vertex at the next level,
+     * (1 + delta) / sigma of the other vertex.
+     */
+    gather_type gather_dependency(const vertex_type& vertex,
+                                  const vertex_type& other) const {
+      gather_type ret;
+      const level_entry<W>* mine = vertex.data().find_level(accumulate_level());
+      const level_entry<W>* next =
+        other.data().find_level(accumulate_level() + 1);
+      if (mine == NULL || next == NULL) return ret;
+      const vdata_type& odata = other.data();
+      for (size_t i = 0; i < W; ++i) {
+        ret.bits[i] = mine->bits[i] & next->bits[i];
+        for (uint64_t b = ret.bits[i]; b; b &= b - 1) {
+          const size_t s = 64 * i + __builtin_ctzl(b);
+          const size_t idx = next->offset + rank_below(next->bits, s);
+          ret.values.push_back((1 + odata.delta[idx]) / odata.sigma[idx]);
+        }
+      }
+      return ret;
+    }
+
+    void apply_dependency(vertex_type& vertex, const gather_type& total) {
+      vdata_type& vdata = vertex.data();
+      const level_entry<W>* mine = vdata.find_level(accumulate_level());
+      if (mine == NULL) return;
+      size_t j = 0;
+      for (size_t i = 0; i < W; ++i) {
+        for (uint64_t b = total.bits[i]; b; b &= b - 1, ++j) {
+          const size_t s = 64 * i + __builtin_ctzl(b);
+          const size_t idx = mine->offset + rank_below(mine->bits, s);
+          vdata.delta[idx] = vdata.sigma[idx] * total.values[j];
+          vdata.betweenness += vdata.delta[idx];
+        }
+      }
+    }
+  };
+
+  typedef graphlab::synchronous_engine<msbfs_program> engine_type;
+
+  // Marks the vertex as reached at level 0 if it is a source of the batch
+  static void start_batch(vertex_type& v) {
+    vdata_type& vdata = v.data();
+    vdata.clear_batch();
+    const std::vector<graphlab::vertex_id_type>::const_iterator iter =
+      std::lower_bound(BATCH.begin(), BATCH.end(), v.id());
+    if (iter == BATCH.end() || *iter != v.id()) return;
+    const size_t s = iter - BATCH.begin();
+    vdata.seen[s / 64] = vdata.frontier[s / 64] = uint64_t(1) << (s % 64);
+    if (BETWEENNESS) {
+      level_entry<W> entry;
+      entry.level = 0;
+      entry.offset = 0;
+      std::copy(vdata.frontier, vdata.frontier + W, entry.bits);
+      vdata.entries.push_back(entry);
+      vdata.sigma.push_back(1);
+      vdata.delta.push_back(0);
+    }
+  }
+
+  static bool is_source(const vertex_type& v) {
+    return std::binary_search(BATCH.begin(), BATCH.end(), v.id());
+  }
+
+  static void free_batch(vertex_type& v) {
+    v.data().clear_batch();
+  }
+
+  /*
+   * Runs the searches from the sources, BATCH_SIZE at a time, and
+   * saves the scores.
+   */
+  static void run(graphlab::distributed_control& dc, graph_type& graph,
+                  graphlab::command_line_options& clopts,
+                  const std::vector<graphlab::vertex_id_type>& sources,
+                  double scale, const std::string& saveprefix) {
+    // run the lowest pending batch_step first
+    clopts.get_engine_args().set_option("delta", 1.0);
+    engine_type engine(dc, graph, clopts);
+    graphlab::timer ti;
+    const size_t batch_size = 64 * W;
+    for (size_t first = 0; first < sources.size(); first += batch_size) {
+      const size_t last = std::min(first + batch_size, sources.size());
+      BATCH.assign(sources.begin() + first, sources.begin() + last);
+      std::sort(BATCH.begin(), BATCH.end());
+      graph.transform_vertices(start_batch);
+      engine.signal_vset(graph.select(is_source));
+      engine.start();
+      dc.cout() << last << " of " << sources.size() << " sources in "
+                << ti.current_time() << " seconds" << std::endl;
+    }
+    graph.transform_vertices(free_batch);
+    if (saveprefix != "") {
+      graph.save(saveprefix, centrality_writer(scale),
+                 false,  // do not gzip
+                 true,   // save vertices
+                 false); // do not save edges
+    }
+  }
+
+  /*
+   * Writes the closeness and, if computed, the betweenness of each
+   * vertex.
+   */
+  struct centrality_writer {
+    double scale;
+    centrality_writer(double scale) : scale(scale) { }
+    std::string save_vertex(vertex_type v) {
+      std::stringstream strm;
+      const vdata_type& vdata = v.data();
+      strm << v.id() << "\t"
+           << (vdata.farness > 0 ? vdata.reached / vdata.farness : 0.0);
+      if (BETWEENNESS) strm << "\t" << vdata.betweenness * scale;
+      strm << "\n";
+      return strm.str();
+    }
+    std::string save_edge(typename graph_type::edge_type e) { return ""; }
+  };
+};
+
+
+/*
+ * Collects the ids of all the vertices
+ */
+struct vid_collector {
+  std::vector<graphlab::vertex_id_type> vids;
+  vid_collector& operator+=(const vid_collector& other) {
+    vids.insert(vids.end(), other.vids.begin(), other.vids.end());
+    return *this;
+  }
+  void save(graphlab::oarchive& oarc) const { oarc << vids; }
+  void load(graphlab::iarchive& iarc) { iarc >> vids; }
+};
+
+template <typename GraphType>
+vid_collector collect_vid(const typename GraphType::vertex_type& v) {
+  vid_collector ret;
+  ret.vids.push_back(v.id());
+  return ret;
+}
+
+
+/*
+ * Loads graphs in the form 'id (id edge_strength)*'.  The edge
+ * strengths are ignored.
+ */
+template <typename GraphType>
+bool line_parser(GraphType& graph, const std::string& filename,
+                 const std::string& textline) {
+  std::stringstream strm(textline);
+  graphlab::vertex_id_type vid;
+  strm >> vid;
+  if (strm.fail()) return true;
+  graph.add_vertex(vid);
+  double edge_val = 1.0;
+  while(1){
+    graphlab::vertex_id_type other_vid;
+    strm >> other_vid;
+    strm >> edge_val;
+    if (strm.fail())
+      break;
+    graph.add_edge(vid, other_vid);
+  }
+  return true;
+}
+
+
+template <size_t W>
+int run_centrality(graphlab::distributed_control& dc,
+                   graphlab::command_line_options& clopts,
+                   const std::string& graph_dir, const std::string& format,
+                   size_t samples, size_t seed,
+                   const std::string& saveprefix) {
+  typedef typename msbfs<W>::graph_type graph_type;
+  graph_type graph(dc, clopts);
+  dc.cout() << "Loading graph" << std::endl;
+  if (format == "") graph.load(graph_dir, line_parser<graph_type>);
+  else graph.load_format(graph_dir, format);
+  graph.finalize();
+  dc.cout() << "#vertices: " << graph.num_vertices()
+            << " #edges:" << graph.num_edges() << std::endl;
+
+  std::vector<graphlab::vertex_id_type> sources =
+    graph.template map_reduce_vertices<vid_collector>(
+        collect_vid<graph_type>).vids;
+  std::sort(sources.begin(), sources.end());
+  double scale = 1;
+  if (samples > 0 && samples < sources.size()) {
+    // every machine draws the same sample
+    graphlab::random::generator gen;
+    gen.seed(seed);
+    gen.shuffle(sources);
+    sources.resize(samples);
+    scale = double(graph.num_vertices()) / samples;
+  }
+  msbfs<W>::run(dc, graph, clopts, sources, scale, saveprefix);
+  return EXIT_SUCCESS;
+}
+
+
+int main(int argc, char** argv) {
+  // Initialize control plain using mpi
+  graphlab::mpi_tools::init(argc, argv);
+  graphlab::distributed_control dc;
+  global_logger().set_log_level(LOG_INFO);
+
+  // Parse command line options -----------------------------------------------
+  graphlab::command_line_options clopts(
+      "Closeness and betweenness centrality by multi-source breadth first "
+      "search. Edge strengths are ignored.");
+  std::string graph_dir;
+  std::string format;
+  std::string saveprefix;
+  size_t batch = 64;
+  size_t samples = 0;
+  size_t seed = 0;
+  clopts.attach_option("graph", graph_dir, "The graph file. Required ");
+  clopts.add_positional("graph");
+  clopts.attach_option("format", format,
+                       "The graph format. If not set, lines of "
+                       "'id (id edge_strength)*' are read.");
+  clopts.attach_option("batch", batch,
+                       "The number of sources searched at once: "
+                       "64, 128, 256 or 512.");
+  clopts.attach_option("samples", samples,
+                       "If set, the number of randomly sampled sources. "
+                       "Otherwise every vertex is a source.");
+  clopts.attach_option("seed", seed, "The seed of the source sample.");
+  clopts.attach_option("betweenness", BETWEENNESS,
+                       "If false, only closeness is computed.");
+  clopts.attach_option("undirected", UNDIRECTED,
+                       "If true, edges are followed in both directions.");
+  clopts.attach_option("saveprefix", saveprefix,
+                       "If set, will save the resultant centrality scores "
+                       "to a sequence of files with prefix saveprefix");
+
+  if(!clopts.parse(argc, argv)) {
+    dc.cout() << "Error in parsing command line arguments." << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (graph_dir == "") {
+    dc.cout() << "Graph not specified. Cannot continue";
+    return EXIT_FAILURE;
+  }
+
+  int ret = EXIT_FAILURE;
+  switch (batch) {
+    case 64: ret = run_centrality<1>(dc, clopts, graph_dir, format,
+                                     samples, seed, saveprefix); break;
+    case 128: ret = run_centrality<2>(dc, clopts, graph_dir, format,
+                                      samples, seed, saveprefix); break;
+    case 256: ret = run_centrality<4>(dc, clopts, graph_dir, format,
+                                      samples, seed, saveprefix); break;
+    case 512: ret = run_centrality<8>(dc, clopts, graph_dir, format,
+                                      samples, seed, saveprefix); break;
+    default:
+      dc.cout() << "--batch must be 64, 128, 256 or 512" << std::endl;
+  }
+
+  graphlab::mpi_tools::finalize();
+  return ret;
+}
@@ -31,246 +31,213 @@
 
 #include <graphlab.hpp>
 
-//helper function
-float myrand() {
-  return static_cast<float>(rand() / (RAND_MAX + 1.0));
-}
+/*
+ * The neighborhood function N(h) of a graph is the number of pairs of
+ * vertices (u, v) such that v is reachable from u in at most h hops.
+ * Following HyperANF
+ *
+ *    P. Boldi, M. Rosa and S. Vigna. HyperANF: Approximating the
+ *    Neighbourhood Function of Very Large Graphs on a Budget. WWW 2011.
+ *
+ * each vertex keeps a counter of the vertices within h hops, which is
+ * updated at hop h + 1 by merging the counters of its out-neighbors:
+ *    c(h + 1; i) = c(h; i) UNION {c(h; k) | source = i & target = k}.
+ * N(h) is the sum of the counters.
+ *
+ * The counters are HyperLogLog counters of a fixed number of registers,
+ * kept inline in the vertex data.  An exact counter, a bitset over all
+ * the vertices, is available for small graphs.
+ */
 
-//helper function to return a hash value for Flajolet & Martin bitmask
-size_t hash_value() {
-  size_t ret = 0;
-  while (myrand() < 0.5) {
-    ret++;
-  }
-  return ret;
-}
+/*
+ * The number of bits in an exact counter: one more than the largest
+ * vertex id.
+ */
+size_t NUM_IDS = 0;
 
-const size_t DUPULICATION_OF_BITMASKS = 10;
+/*
+ * A counter of the exact set of vertices reached.  Requires NUM_IDS
+ * bits per vertex.
+ */
+struct exact_counter {
+  graphlab::dense_bitset bits;
 
-struct vdata {
-  //use two bitmasks for consistency
-  std::vector<std::vector<bool> > bitmask1;
-  std::vector<std::vector<bool> > bitmask2;
-  //indicate which is the bitmask for reading (or writing)
-  bool odd_iteration;
-  vdata() :
-      bitmask1(), bitmask2(), odd_iteration(true) {
-  }
-  //for exact counting (but needs large memory)
-  void create_bitmask(size_t id) {
-    std::vector<bool> mask1(id + 2, 0);
-    mask1[id] = 1;
-    bitmask1.push_back(mask1);
-    std::vector<bool> mask2(id + 2, 0);
-    mask2[id] = 1;
-    bitmask2.push_back(mask2);
-  }
-  //for approximate Flajolet & Martin counting
-  void create_hashed_bitmask(size_t id) {
-    for (size_t i = 0; i < DUPULICATION_OF_BITMASKS; ++i) {
-      size_t hash_val = hash_value();
-      std::vector<bool> mask1(hash_val + 2, 0);
-      mask1[hash_val] = 1;
-      bitmask1.push_back(mask1);
-      std::vector<bool> mask2(hash_val + 2, 0);
-      mask2[hash_val] = 1;
-      bitmask2.push_back(mask2);
-    }
+  void add(graphlab::vertex_id_type vid) {
+    if (bits.size() == 0) bits.resize(NUM_IDS);
+    bits.clear();
+    bits.set_bit_unsync(vid);
   }
 
-  void save(graphlab::oarchive& oarc) const {
-    size_t num = bitmask1.size();
-    oarc << num;
-    for (size_t a = 0; a < num; ++a) {
-      size_t size = bitmask1[a].size();
-      oarc << size;
-      for (size_t i = 0; i < size; ++i)
-        oarc << (bool)bitmask1[a][i];
-      for (size_t i = 0; i < size; ++i)
-        oarc << (bool)bitmask2[a][i];
-    }
-    oarc << odd_iteration;
-  }
-  void load(graphlab::iarchive& iarc) {
-    bitmask1.clear();
-    bitmask2.clear();
-    size_t num = 0;
-    iarc >> num;
-    for (size_t a = 0; a < num; ++a) {
-      size_t size = 0;
-      iarc >> size;
-      std::vector<bool> mask1;
-      for (size_t i = 0; i < size; ++i) {
-        bool element = true;
-        iarc >> element;
-        mask1.push_back(element);
-      }
-      bitmask1.push_back(mask1);
-      std::vector<bool> mask2;
-      for (size_t i = 0; i < size; ++i) {
-        bool element = true;
-        iarc >> element;
-        mask2.push_back(element);
-      }
-      bitmask2.push_back(mask2);
-    }
-    iarc >> odd_iteration;
+  exact_counter& operator+=(const exact_counter& other) {
+    if (other.bits.size() == 0) return *this;
+    if (bits.size() == 0) bits = other.bits;
+    else bits |= other.bits;
+    return *this;
   }
+
+  double estimate() const { return bits.popcount(); }
+
+  void save(graphlab::oarchive& oarc) const { oarc << bits; }
+  void load(graphlab::iarchive& iarc) { iarc >> bits; }
 };
 
-typedef graphlab::distributed_graph<vdata, graphlab::empty> graph_type;
 
-//initialize bitmask
-void initialize_vertex(graph_type::vertex_type& v) {
-  v.data().create_bitmask(v.id());
-}
-//initialize bitmask
-void initialize_vertex_with_hash(graph_type::vertex_type& v) {
-  v.data().create_hashed_bitmask(v.id());
-}
+/*
+ * The largest vertex id, used to size the exact counters.
+ */
+struct max_vid : public graphlab::IS_POD_TYPE {
+  graphlab::vertex_id_type vid;
+  max_vid(graphlab::vertex_id_type vid = 0): vid(vid) { }
+  max_vid& operator+=(const max_vid& other) {
+    vid = std::max(vid, other.vid);
+    return *this;
+  }
+};
+
 
-//helper function to compute bitwise-or
-void bitwise_or(std::vector<std::vector<bool> >& v1,
-    const std::vector<std::vector<bool> >& v2) {
-  for (size_t a = 0; a < v1.size(); ++a) {
-    while (v1[a].size() < v2[a].size()) {
-      v1[a].push_back(false);
+/*
+ * Computes the neighborhood function with counters of type Counter,
+ * which must provide add(vertex id), operator+= (the union) and
+ * estimate().
+ */
+template <typename Counter>
+struct neighborhood_function {
+  typedef graphlab::distributed_graph<Counter, graphlab::empty> graph_type;
+  typedef typename graph_type::vertex_type vertex_type;
+
+  // The next counter of each vertex is the union of its counter and the
+  // counters of its out-neighbors.
+  class one_hop :
+    public graphlab::ivertex_program<graph_type, Counter>,
+    public graphlab::IS_POD_TYPE {
+  public:
+    typedef graphlab::ivertex_program<graph_type, Counter> base;
+    typedef typename base::icontext_type icontext_type;
+    typedef typename base::edge_type edge_type;
+    typedef typename base::edge_dir_type edge_dir_type;
+
+    //gather on out edges
+    edge_dir_type gather_edges(icontext_type& context,
+                               const vertex_type& vertex) const {
+      return graphlab::OUT_EDGES;
     }
-    for (size_t i = 0; i < v2[a].size(); ++i) {
-      v1[a][i] = v1[a][i] || v2[a][i];
+
+    //for each edge gather the counter of the target
+    Counter gather(icontext_type& context, const vertex_type& vertex,
+                   edge_type& edge) const {
+      return edge.target().data();
     }
-  }
-}
 
-struct bitmask_gatherer {
-  std::vector<std::vector<bool> > bitmask;
+    // Every gather of the synchronous engine completes before any
+    // apply, so the counters are updated in place.
+    void apply(icontext_type& context, vertex_type& vertex,
+               const Counter& total) {
+      vertex.data() += total;
+    }
 
-  bitmask_gatherer() :
-    bitmask() {
-  }
-  explicit bitmask_gatherer(const std::vector<std::vector<bool> > & in_b) :
-    bitmask(){
-    for(size_t i=0;i<in_b.size();++i){
-      bitmask.push_back(in_b[i]);
+    edge_dir_type scatter_edges(icontext_type& context,
+                                const vertex_type& vertex) const {
+      return graphlab::NO_EDGES;
     }
+  };
+
+  static void initialize_vertex(vertex_type& v) {
+    v.data().add(v.id());
   }
 
-  //bitwise-or
-  bitmask_gatherer& operator+=(const bitmask_gatherer& other) {
-    bitwise_or(bitmask, other.bitmask);
-    return *this;
+  static double vertex_count(const vertex_type& v) {
+    return v.data().estimate();
   }
 
-  void save(graphlab::oarchive& oarc) const {
-    size_t num = bitmask.size();
-    oarc << num;
-    for (size_t a = 0; a < num; ++a) {
-      size_t size = bitmask[a].size();
-      oarc << size;
-      for (size_t i = 0; i < size; ++i)
-        oarc << (bool)bitmask[a][i];
-    }
+  static max_vid get_vid(const vertex_type& v) {
+    return max_vid(v.id());
   }
-  void load(graphlab::iarchive& iarc) {
-    bitmask.clear();
-    size_t num = 0;
-    iarc >> num;
-    for (size_t a = 0; a < num; ++a) {
-      size_t size = 0;
-      iarc >> size;
-      std::vector<bool> mask1;
-      for (size_t i = 0; i < size; ++i) {
-        bool element = true;
-        iarc >> element;
-        mask1.push_back(element);
+
+  /*
+   * Returns N(0), N(1), ... until N grows by less than the tolerance,
+   * or until max_hops.
+   */
+  static std::vector<double> run(graphlab::distributed_control& dc,
+                                 graphlab::command_line_options& clopts,
+                                 const std::string& graph_dir,
+                                 const std::string& format,
+                                 float termination_criteria,
+                                 size_t max_hops) {
+    graph_type graph(dc, clopts);
+    dc.cout() << "Loading graph in format: "<< format << std::endl;
+    graph.load_format(graph_dir, format);
+    graph.finalize();
+    NUM_IDS = graph.template map_reduce_vertices<max_vid>(get_vid).vid + 1;
+
+    time_t start, end;
+    //initialize vertices
+    time(&start);
+    graph.transform_vertices(initialize_vertex);
+    graphlab::omni_engine<one_hop> engine(dc, graph, "synchronous", clopts);
+
+    std::vector<double> nf;
+    nf.push_back(graph.template map_reduce_vertices<double>(vertex_count));
+    for (size_t iter = 0; iter < max_hops; ++iter) {
+      engine.signal_all();
+      engine.start();
+      const double current_count =
+        graph.template map_reduce_vertices<double>(vertex_count);
+      dc.cout() << iter + 1 << "-th hop: " << size_t(current_count)
+                << " vertex pairs are reached\n";
+      if (iter > 0 &&
+          current_count < nf.back() * (1.0 + termination_criteria)) {
+        dc.cout() << "converge\n";
+        break;
       }
-      bitmask.push_back(mask1);
+      nf.push_back(current_count);
     }
+    time(&end);
+    dc.cout() << "graph calculation time is " << (end - start) << " sec\n";
+    return nf;
   }
 };
 
-//The next bitmask b(h + 1; i) of i at the hop h + 1 is given as:
-//b(h + 1; i) = b(h; i) BITWISE-OR {b(h; k) | source = i & target = k}.
-class one_hop: public graphlab::ivertex_program<graph_type, bitmask_gatherer>,
-    public graphlab::IS_POD_TYPE {
-public:
-  //gather on out edges
-  edge_dir_type gather_edges(icontext_type& context,
-      const vertex_type& vertex) const {
-    return graphlab::OUT_EDGES;
-  }
 
-  //for each edge gather the bitmask of the edge
-  bitmask_gatherer gather(icontext_type& context, const vertex_type& vertex,
-      edge_type& edge) const {
-    if (vertex.data().odd_iteration) {
-      return bitmask_gatherer(edge.target().data().bitmask2);
-    } else {
-      return bitmask_gatherer(edge.target().data().bitmask1);
-    }
-  }
-
-  //get bitwise-ORed bitmask and switch bitmasks
-  void apply(icontext_type& context, vertex_type& vertex,
-      const gather_type& total) {
-    if (vertex.data().odd_iteration) {
-      if (total.bitmask.size() > 0)
-        bitwise_or(vertex.data().bitmask1, total.bitmask);
-      vertex.data().odd_iteration = false;
-    } else {
-      if (total.bitmask.size() > 0)
-        bitwise_or(vertex.data().bitmask2, total.bitmask);
-      vertex.data().odd_iteration = true;
+/*
+ * The smallest (interpolated) number of hops within which the given
+ * fraction of the reachable pairs are reached.
+ */
+double effective_diameter(const std::vector<double>& nf, double fraction) {
+  const double target = fraction * nf.back();
+  if (nf.front() >= target) return 0;
+  for (size_t h = 1; h < nf.size(); ++h) {
+    if (nf[h] >= target) {
+      return (h - 1) + (target - nf[h - 1]) / (nf[h] - nf[h - 1]);
     }
   }
+  return nf.size() - 1;
+}
 
-  edge_dir_type scatter_edges(icontext_type& context,
-      const vertex_type& vertex) const {
-    return graphlab::NO_EDGES;
-  }
-  void scatter(icontext_type& context, const vertex_type& vertex,
-      edge_type& edge) const {
-  }
-};
-
-//copy the updated bitmask to the other
-void copy_bitmasks(graph_type::vertex_type& vdata) {
-  if (vdata.data().odd_iteration == false) { //odd_iteration has just finished
-    vdata.data().bitmask2 = vdata.data().bitmask1;
-  } else {
-    vdata.data().bitmask1 = vdata.data().bitmask2;
+/*
+ * The average distance between pairs of distinct reachable vertices.
+ */
+double average_distance(const std::vector<double>& nf) {
+  double sum = 0;
+  for (size_t h = 1; h < nf.size(); ++h) {
+    sum += h * std::max(nf[h] - nf[h - 1], 0.0);
   }
+  const double pairs = nf.back() - nf.front();
+  return pairs > 0 ? sum / pairs : 0;
 }
 
-//count the number of vertices reached in the current hop
-size_t absolute_vertex_data(const graph_type::vertex_type& vertex) {
-    size_t count = 0;
-    for (size_t i = 0; i < vertex.data().bitmask1[0].size(); ++i)
-      if (vertex.data().bitmask1[0][i])
-        count++;
-    return count;
-}
 
-//count the number of vertices reached in the current hop with Flajolet & Martin counting method
-size_t approximate_pair_number(std::vector<std::vector<bool> > bitmask) {
-  float sum = 0.0;
-  for (size_t a = 0; a < bitmask.size(); ++a) {
-    for (size_t i = 0; i < bitmask[a].size(); ++i) {
-      if (bitmask[a][i] == 0) {
-        sum += (float) i;
-        break;
-      }
-    }
-  }
-  return (size_t) (pow(2.0, sum / (float) (bitmask.size())) / 0.77351);
-}
-//count the number of notes reached in the current hop
-size_t absolute_vertex_data_with_hash(
-    const graph_type::vertex_type& vertex) {
-    size_t count = approximate_pair_number(vertex.data().bitmask1);
-    return count;
+template <size_t Precision>
+std::vector<double> run_hyperanf(graphlab::distributed_control& dc,
+                                 graphlab::command_line_options& clopts,
+                                 const std::string& graph_dir,
+                                 const std::string& format,
+                                 float termination_criteria,
+                                 size_t max_hops) {
+  return neighborhood_function<graphlab::hyperloglog<Precision> >::run(
+      dc, clopts, graph_dir, format, termination_criteria, max_hops);
 }
 
+
 int main(int argc, char** argv) {
   std::cout << "Approximate graph diameter\n\n";
   graphlab::mpi_tools::init(argc, argv);
@@ -284,8 +251,10 @@ int main(int argc, char** argv) {
                 "Directions of edges are considered.");
   std::string graph_dir;
   std::string format = "adj";
+  std::string output;
   bool use_sketch = true;
-  std::string exec_type = "synchronous";
+  size_t precision = 6;
+  size_t max_hops = 100;
   clopts.attach_option("graph", graph_dir,
                        "The graph file. This is not optional");
   clopts.add_positional("graph");
@@ -294,8 +263,17 @@ int main(int argc, char** argv) {
   clopts.attach_option("tol", termination_criteria,
                        "The permissible change at convergence.");
   clopts.attach_option("use-sketch", use_sketch,
-                       "If true, will use Flajolet & Martin bitmask, "
-                       "which is more compact and faster.");
+                       "If true, will use HyperLogLog counters, "
+                       "which are more compact and faster.");
+  clopts.attach_option("precision", precision,
+                       "Use 2^precision registers per HyperLogLog counter, "
+                       "from 4 to 10. The relative standard error of a "
+                       "counter is 1.04 / sqrt(2^precision).");
+  clopts.attach_option("max_hops", max_hops,
+                       "The maximum number of hops.");
+  clopts.attach_option("output", output,
+                       "If set, the neighborhood function is written to "
+                       "this file, one hop per line.");
 
   if (!clopts.parse(argc, argv)){
     dc.cout() << "Error in parsing command line arguments." << std::endl;
@@ -305,56 +283,46 @@ int main(int argc, char** argv) {
     std::cout << "--graph is not optional\n";
     return EXIT_FAILURE;
   }
+  if (use_sketch && (precision < 4 || precision > 10)) {
+    std::cout << "--precision must be between 4 and 10\n";
+    return EXIT_FAILURE;
+  }
 
-  //load graph
-  graph_type graph(dc, clopts);
-  dc.cout() << "Loading graph in format: "<< format << std::endl;
-  graph.load_format(graph_dir, format);
-  graph.finalize();
-
-  time_t start, end;
-  //initialize vertices
-  time(&start);
-  if (use_sketch == false)
-    graph.transform_vertices(initialize_vertex);
-  else
-    graph.transform_vertices(initialize_vertex_with_hash);
-
-  graphlab::omni_engine<one_hop> engine(dc, graph, exec_type, clopts);
-
-  //main iteration
-  size_t previous_count = 0;
-  size_t diameter = 0;
-  for (size_t iter = 0; iter < 100; ++iter) {
-    engine.signal_all();
-    engine.start();
-
-    graph.transform_vertices(copy_bitmasks);
-
-    size_t current_count = 0;
-    if (use_sketch == false)
-      current_count = graph.map_reduce_vertices<size_t>(absolute_vertex_data);
-    else
-      current_count = graph.map_reduce_vertices<size_t>(
-          absolute_vertex_data_with_hash);
-    dc.cout() << iter + 1 << "-th hop: " << current_count
-        << " vertex pairs are reached\n";
-    if (iter > 0
-        && (float) current_count
-            < (float) previous_count * (1.0 + termination_criteria)) {
-      diameter = iter;
-      dc.cout() << "converge\n";
-      break;
+  std::vector<double> nf;
+  if (use_sketch == false) {
+    nf = neighborhood_function<exact_counter>::run(
+        dc, clopts, graph_dir, format, termination_criteria, max_hops);
+  } else {
+    switch (precision) {
+      case 4: nf = run_hyperanf<4>(dc, clopts, graph_dir, format,
+                                   termination_criteria, max_hops); break;
+      case 5: nf = run_hyperanf<5>(dc, clopts, graph_dir, format,
+                                   termination_criteria, max_hops); break;
+      case 6: nf = run_hyperanf<6>(dc, clopts, graph_dir, format,
+                                   termination_criteria, max_hops); break;
+      case 7: nf = run_hyperanf<7>(dc, clopts, graph_dir, format,
+                                   termination_criteria, max_hops); break;
+      case 8: nf = run_hyperanf<8>(dc, clopts, graph_dir, format,
+                                   termination_criteria, max_hops); break;
+      case 9: nf = run_hyperanf<9>(dc, clopts, graph_dir, format,
+                                   termination_criteria, max_hops); break;
+      default: nf = run_hyperanf<10>(dc, clopts, graph_dir, format,
+                                     termination_criteria, max_hops); break;
+    }
+  }
+  dc.cout() << "The approximate diameter is " << nf.size() - 1 << "\n";
+  dc.cout() << "The effective diameter is " << effective_diameter(nf, 0.9)
+            << "\n";
+  dc.cout() << "The average distance is " << average_distance(nf) << "\n";
+
+  if (output != "" && dc.procid() == 0) {
+    std::ofstream fout(output.c_str());
+    for (size_t h = 0; h < nf.size(); ++h) {
+      fout << h << "\t" << nf[h] << "\n";
     }
-    previous_count = current_count;
   }
-  time(&end);
-
-  dc.cout() << "graph calculation time is " << (end - start) << " sec\n";
-  dc.cout() << "The approximate diameter is " << diameter << "\n";
 
   graphlab::mpi_tools::finalize();
 
   return EXIT_SUCCESS;
 }
-
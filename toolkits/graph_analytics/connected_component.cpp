@@ -30,6 +30,8 @@
 
 #include <graphlab.hpp>
 #include <graphlab/graph/distributed_graph.hpp>
+#include <graphlab/util/union_find.hpp>
+#include <graphlab/macros_def.hpp>
 
 struct vdata {
   uint64_t labelid;
@@ -134,6 +136,185 @@ public:
   }
 };
 
+/*
+ * Finds the components without propagating labels along paths, which
+ * takes as many supersteps as the diameter of the graph.
+ *
+ * Each machine first finds the components of its own edges with a
+ * union find, and labels each with the smallest vertex id in it.  A
+ * vertex with mirrors then links the labels of its local components on
+ * the different machines, and the smallest vertex id of each component
+ * is found over these links only, following
+ *
+ *    Y. Shiloach and U. Vishkin. An O(log n) Parallel Connectivity
+ *    Algorithm. Journal of Algorithms, 1982.
+ *
+ * Every label has a parent, which is kept by the machine label %
+ * numprocs and is the label itself if it is not stored.  In each round
+ * the root of each label is at most one hop away.  For every link
+ * joining two trees, the larger root is hooked under the smaller, so
+ * that the parent of a label is never larger than the label and at
+ * least half the trees are hooked.  Pointer jumping then flattens the
+ * trees for the next round.
+ */
+class union_find_components {
+ private:
+  typedef graphlab::vertex_id_type vertex_id_type;
+  typedef boost::unordered_map<vertex_id_type, vertex_id_type> parent_map;
+
+  graphlab::dc_dist_object<union_find_components> rmi;
+  graph_type& graph;
+  // the parents of the labels owned by this machine
+  parent_map parent;
+  // the label of the local component of each local vertex
+  std::vector<vertex_id_type> local_label;
+  // (vertex, label) for each vertex with mirrors in another component
+  std::vector<std::pair<vertex_id_type, vertex_id_type> > links;
+
+  graphlab::procid_t owner(vertex_id_type label) const {
+    return label % rmi.numprocs();
+  }
+
+  vertex_id_type get_parent(vertex_id_type label) const {
+    parent_map::const_iterator iter = parent.find(label);
+    return iter == parent.end() ? label : iter->second;
+  }
+
+  /*
+   * Replaces each label by its parent, asking the machines which own
+   * the labels.
+   */
+  void lookup(std::vector<vertex_id_type>& labels) {
+    std::vector<std::vector<vertex_id_type> > requests(rmi.numprocs());
+    for (size_t i = 0; i < labels.size(); ++i) {
+      requests[owner(labels[i])].push_back(labels[i]);
+    }
+    rmi.all_to_all(requests);
+    for (size_t p = 0; p < requests.size(); ++p) {
+      for (size_t i = 0; i < requests[p].size(); ++i) {
+        requests[p][i] = get_parent(requests[p][i]);
+      }
+    }
+    rmi.all_to_all(requests);
+    std::vector<size_t> next(rmi.numprocs(), 0);
+    for (size_t i = 0; i < labels.size(); ++i) {
+      const graphlab::procid_t p = owner(labels[i]);
+      labels[i] = requests[p][next[p]++];
+    }
+  }
+
+  // Finds the local components and their labels
+  void contract_local_edges() {
+    const size_t nverts = graph.num_local_vertices();
+    graphlab::concurrent_union_find uf;
+    uf.init(nverts);
+#ifdef _OPENMP
+    #pragma omp parallel for
+#endif
+    for (int i = 0; i < (int)nverts; ++i) {
+      foreach(const graph_type::local_edge_type& e,
+              graph.l_vertex(i).out_edges()) {
+        uf.merge(e.source().id(), e.target().id());
+      }
+    }
+    std::vector<vertex_id_type> min_vid(nverts,
+        std::numeric_limits<vertex_id_type>::max());
+    for (size_t i = 0; i < nverts; ++i) {
+      vertex_id_type& m = min_vid[uf.find(i)];
+      m = std::min(m, graph.l_vertex(i).global_id());
+    }
+    local_label.resize(nverts);
+    for (size_t i = 0; i < nverts; ++i) {
+      graph_type::local_vertex_type lvertex = graph.l_vertex(i);
+      local_label[i] = min_vid[uf.find(i)];
+      const bool replicated = !lvertex.owned() || lvertex.num_mirrors() > 0;
+      if (replicated && local_label[i] != lvertex.global_id()) {
+        links.push_back(std::make_pair(lvertex.global_id(), local_label[i]));
+      }
+    }
+  }
+
+  // Hooks the larger root of each link under the smaller. Returns the
+  // number of hooks.
+  size_t hook() {
+    std::vector<vertex_id_type> roots(2 * links.size());
+    for (size_t i = 0; i < links.size(); ++i) {
+      roots[2 * i] = links[i].first;
+      roots[2 * i + 1] = links[i].second;
+    }
+    lookup(roots);
+    std::vector<std::vector<std::pair<vertex_id_type, vertex_id_type> > >
+        hooks(rmi.numprocs());
+    for (size_t i = 0; i < links.size(); ++i) {
+      const vertex_id_type a = roots[2 * i], b = roots[2 * i + 1];
+      if (a != b) {
+        hooks[owner(std::max(a, b))].push_back(
+            std::make_pair(std::max(a, b), std::min(a, b)));
+      }
+    }
+    rmi.all_to_all(hooks);
+    size_t nhooks = 0;
+    for (size_t p = 0; p < hooks.size(); ++p) {
+      for (size_t i = 0; i < hooks[p].size(); ++i) {
+        const vertex_id_type root = hooks[p][i].first;
+        if (hooks[p][i].second < get_parent(root)) {
+          parent[root] = hooks[p][i].second;
+          ++nhooks;
+        }
+      }
+    }
+    rmi.all_reduce(nhooks);
+    return nhooks;
+  }
+
+  // Points every label at its grandparent until the trees are stars
+  void pointer_jump() {
+    while (true) {
+      std::vector<vertex_id_type> grandparents;
+      grandparents.reserve(parent.size());
+      for (parent_map::const_iterator iter = parent.begin();
+           iter != parent.end(); ++iter) {
+        grandparents.push_back(iter->second);
+      }
+      lookup(grandparents);
+      size_t nchanged = 0, i = 0;
+      for (parent_map::iterator iter = parent.begin();
+           iter != parent.end(); ++iter, ++i) {
+        if (grandparents[i] != iter->second) {
+          iter->second = grandparents[i];
+          ++nchanged;
+        }
+      }
+      rmi.all_reduce(nchanged);
+      if (nchanged == 0) break;
+    }
+  }
+
+ public:
+  union_find_components(graphlab::distributed_control& dc, graph_type& graph):
+    rmi(dc, this), graph(graph) { }
+
+  /*
+   * Sets the label of every vertex to the smallest vertex id in its
+   * component. Returns the number of hooking rounds.
+   */
+  size_t run() {
+    contract_local_edges();
+    size_t rounds = 0;
+    while (hook() > 0) {
+      pointer_jump();
+      ++rounds;
+    }
+    std::vector<vertex_id_type> roots(local_label);
+    lookup(roots);
+    for (size_t i = 0; i < roots.size(); ++i) {
+      graph.l_vertex(i).data().labelid = roots[i];
+    }
+    rmi.full_barrier();
+    return rounds;
+  }
+};
+
 class graph_writer {
 public:
   std::string save_vertex(graph_type::vertex_type v) {
@@ -158,11 +339,15 @@ int main(int argc, char** argv) {
   std::string saveprefix;
   std::string format = "adj";
   std::string exec_type = "synchronous";
+  std::string algorithm = "union_find";
   clopts.attach_option("graph", graph_dir,
                        "The graph file. This is not optional");
   clopts.add_positional("graph");
   clopts.attach_option("format", format,
                        "The graph file format");
+  clopts.attach_option("algorithm", algorithm,
+                       "union_find, or label_propagation which takes as "
+                       "many supersteps as the diameter of the graph");
   clopts.attach_option("saveprefix", saveprefix,
                        "If set, will save the pairs of a vertex id and "
                        "a component id to a sequence of files with prefix "
@@ -175,6 +360,10 @@ int main(int argc, char** argv) {
     std::cout << "--graph is not optional\n";
     return EXIT_FAILURE;
   }
+  if (algorithm != "union_find" && algorithm != "label_propagation") {
+    std::cout << "--algorithm must be union_find or label_propagation\n";
+    return EXIT_FAILURE;
+  }
 
   graph_type graph(dc, clopts);
 
@@ -184,14 +373,22 @@ int main(int argc, char** argv) {
   graphlab::timer ti;
   graph.finalize();
   dc.cout() << "Finalization in " << ti.current_time() << std::endl;
-  graph.transform_vertices(initialize_vertex);
-
-  //running the engine
-  time_t start, end;
-  graphlab::omni_engine<label_propagation> engine(dc, graph, exec_type, clopts);
-  engine.signal_all();
-  time(&start);
-  engine.start();
+
+  ti.start();
+  if (algorithm == "union_find") {
+    union_find_components components(dc, graph);
+    const size_t rounds = components.run();
+    dc.cout() << "Hooking rounds: " << rounds << std::endl;
+  } else {
+    graph.transform_vertices(initialize_vertex);
+    //running the engine
+    graphlab::omni_engine<label_propagation> engine(dc, graph, exec_type,
+                                                    clopts);
+    engine.signal_all();
+    engine.start();
+  }
+  dc.cout() << "Connected components in " << ti.current_time()
+            << " seconds" << std::endl;
 
   //write results
   if (saveprefix.size() > 0) {
@@ -0,0 +1,480 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <algorithm>
+#include <graphlab.hpp>
+#include <graphlab/ui/metrics_server.hpp>
+#include <graphlab/macros_def.hpp>
+/**
+ *
+ * In this program we implement the "forward" algorithm described in
+ *
+ *    T. Schank. Algorithmic Aspects of Triangle-Based Network Analysis.
+ *    Phd in computer science, University Karlsruhe, 2007.
+ *
+ * over a degree ordering of the vertices.
+ *
+ * Vertices are ranked by (degree, vertex id) and every edge is oriented
+ * from the lower to the higher ranked endpoint, giving a DAG.  Each
+ * vertex keeps only its out-neighbors in the DAG as a sorted vector.
+ * A triangle a < b < c (in rank) is then found exactly once, on the
+ * edge (a, b), as the element c of the intersection of the lists of a
+ * and b.
+ *
+ * Ranking by degree bounds the length of every list by O(sqrt(|E|)):
+ * a high degree vertex only keeps its neighbors of even higher degree,
+ * of which there are few.  Hubs therefore never gather, store or
+ * synchronize to their mirrors their full adjacency, which is what
+ * dominates memory and network in undirected_triangle_count when per
+ * vertex counts are requested.
+ *
+ * Lists of similar length are intersected with a merge.  When one list
+ * is much longer than the other, each element of the shorter list is
+ * located in the longer one by galloping (exponential then binary
+ * search) instead, which takes O(n log(m / n)) time.
+ *
+ * Per vertex counts credit a triangle a < b < c found on edge (a, b) to
+ * a and b through the count on the edge, and to c through a message.
+ */
+
+
+/*
+ * The ordering of the vertices.  Ties between vertices of the same
+ * degree are broken by vertex id.
+ */
+inline bool rank_less(size_t degree_a, graphlab::vertex_id_type a,
+                      size_t degree_b, graphlab::vertex_id_type b) {
+  return degree_a < degree_b || (degree_a == degree_b && a < b);
+}
+
+
+typedef std::vector<graphlab::vertex_id_type> vid_list;
+
+/*
+ * When the longer list is more than GALLOP_RATIO times longer than
+ * the shorter one, the intersection gallops instead of merging.
+ */
+size_t GALLOP_RATIO = 32;
+
+/*
+ * Returns the first position in [begin, end) which is not less than
+ * val, probing positions begin, begin + 1, begin + 3, ... before
+ * binary searching the last step.
+ */
+inline const graphlab::vertex_id_type*
+gallop(const graphlab::vertex_id_type* begin,
+       const graphlab::vertex_id_type* end,
+       graphlab::vertex_id_type val) {
+  size_t step = 1;
+  const graphlab::vertex_id_type* lo = begin;
+  while (lo + step < end && lo[step] < val) {
+    lo += step;
+    step *= 2;
+  }
+  return std::lower_bound(lo, std::min(lo + step + 1, end), val);
+}
+
+/*
+ * Calls visit(v) for each vertex v in both sorted lists and returns
+ * the number of such vertices.
+ */
+template <typename Visitor>
+size_t sorted_intersect(const vid_list& a, const vid_list& b,
+                        Visitor& visit) {
+  const vid_list& small = a.size() <= b.size() ? a : b;
+  const vid_list& large = a.size() <= b.size() ? b : a;
+  if (small.empty()) return 0;
+  size_t count = 0;
+  const graphlab::vertex_id_type* s = &small[0];
+  const graphlab::vertex_id_type* s_end = s + small.size();
+  const graphlab::vertex_id_type* l = &large[0];
+  const graphlab::vertex_id_type* l_end = l + large.size();
+  if (large.size() > GALLOP_RATIO * small.size()) {
+    for (; s != s_end; ++s) {
+      l = gallop(l, l_end, *s);
+      if (l == l_end) break;
+      if (*l == *s) { visit(*s); ++count; ++l; }
+    }
+  } else {
+    // advance both sides without branching on which one is smaller
+    while (s != s_end && l != l_end) {
+      const graphlab::vertex_id_type x = *s, y = *l;
+      if (x == y) { visit(x); ++count; }
+      s += (x <= y);
+      l += (y <= x);
+    }
+  }
+  return count;
+}
+
+
+/*
+ * Each vertex maintains its sorted out-neighbors in the degree
+ * ordering, and a final count for the number of triangles it is
+ * involved in.
+ */
+struct vertex_data_type {
+  vertex_data_type(): num_triangles(0){ }
+  // The neighbors of higher rank
+  vid_list out_list;
+  // The number of triangles this vertex is involved it.
+  // only used if "per vertex counting" is used
+  size_t num_triangles;
+  void save(graphlab::oarchive &oarc) const {
+    oarc << out_list << num_triangles;
+  }
+  void load(graphlab::iarchive &iarc) {
+    iarc >> out_list >> num_triangles;
+  }
+};
+
+
+/*
+ * Each edge is simply a counter of triangles
+ */
+typedef uint32_t edge_data_type;
+
+bool PER_VERTEX_COUNT = false;
+
+
+/*
+ * This is the gathering type which accumulates the out-neighbors of a
+ * vertex.  The gather of a single edge holds at most one vertex, which
+ * is kept inline to avoid allocating a vector per edge.  operator+=
+ * appends into the vector.
+ */
+struct out_list_gather {
+  static const graphlab::vertex_id_type NONE = graphlab::vertex_id_type(-1);
+  graphlab::vertex_id_type v;
+  vid_list vid_vec;
+
+  out_list_gather(): v(NONE) { }
+
+  out_list_gather& operator+=(const out_list_gather& other) {
+    if (v != NONE) {
+      vid_vec.push_back(v);
+      v = NONE;
+    }
+    if (other.v != NONE) vid_vec.push_back(other.v);
+    vid_vec.insert(vid_vec.end(), other.vid_vec.begin(), other.vid_vec.end());
+    return *this;
+  }
+
+  void save(graphlab::oarchive& oarc) const { oarc << v << vid_vec; }
+  void load(graphlab::iarchive& iarc) { iarc >> v >> vid_vec; }
+};
+
+
+/*
+ * The message sent to the highest ranked vertex of each triangle when
+ * per vertex counts are requested: the number of triangles found in
+ * which it is the highest ranked vertex.
+ */
+struct triangle_message : public graphlab::IS_POD_TYPE {
+  size_t count;
+  triangle_message(size_t count = 0): count(count) { }
+  triangle_message& operator+=(const triangle_message& other) {
+    count += other.count;
+    return *this;
+  }
+};
+
+
+/*
+ * Define the type of the graph
+ */
+typedef graphlab::distributed_graph<vertex_data_type,
+                                    edge_data_type> graph_type;
+
+
+
+/*
+ * This class implements the triangle counting algorithm as described in
+ * the header. In the first iteration every vertex gathers its out-list
+ * and then counts the triangles on each of its out edges.  If per
+ * vertex counts are requested, the highest ranked vertices of the
+ * triangles are signaled with their counts, which they add to their
+ * data in the second iteration.
+ */
+class triangle_count :
+      public graphlab::ivertex_program<graph_type, out_list_gather,
+                                       triangle_message>,
+      /* I have no data. Just force it to POD */
+      public graphlab::IS_POD_TYPE  {
+  size_t top_triangles;
+  bool do_not_scatter;
+
+  // Credits the highest ranked vertex of each triangle found
+  struct top_credit {
+    icontext_type& context;
+    top_credit(icontext_type& context): context(context) { }
+    void operator()(graphlab::vertex_id_type vid) {
+      context.signal_vid(vid, triangle_message(1));
+    }
+  };
+
+  struct no_credit {
+    void operator()(graphlab::vertex_id_type) { }
+  };
+
+public:
+  void init(icontext_type& context, const vertex_type& vertex,
+            const message_type& msg) {
+    top_triangles = msg.count;
+  }
+
+  // Gather on all edges in the first iteration
+  edge_dir_type gather_edges(icontext_type& context,
+                             const vertex_type& vertex) const {
+    return context.iteration() == 0 ? graphlab::ALL_EDGES : graphlab::NO_EDGES;
+  }
+
+  /*
+   * For each edge, keep the ID of the "other" vertex if it has higher
+   * rank.
+   */
+  gather_type gather(icontext_type& context,
+                     const vertex_type& vertex,
+                     edge_type& edge) const {
+    gather_type gather;
+    const vertex_type other = edge.target().id() == vertex.id() ?
+                              edge.source() : edge.target();
+    if (rank_less(vertex.num_in_edges() + vertex.num_out_edges(), vertex.id(),
+                  other.num_in_edges() + other.num_out_edges(), other.id())) {
+      gather.v = other.id();
+    }
+    return gather;
+  }
+
+  /*
+   * Sort the out-list and store it on the vertex, or add the triangles
+   * this vertex tops.
+   */
+  void apply(icontext_type& context, vertex_type& vertex,
+             const gather_type& neighborhood) {
+    if (context.iteration() > 0) {
+      vertex.data().num_triangles += top_triangles;
+      do_not_scatter = true;
+      return;
+    }
+    vid_list& out_list = vertex.data().out_list;
+    out_list = neighborhood.vid_vec;
+    if (neighborhood.v != out_list_gather::NONE) {
+      out_list.push_back(neighborhood.v);
+    }
+    std::sort(out_list.begin(), out_list.end());
+    out_list.erase(std::unique(out_list.begin(), out_list.end()),
+                   out_list.end());
+    vid_list(out_list).swap(out_list);
+    do_not_scatter = out_list.empty();
+  } // end of apply
+
+  /*
+   * Scatter over all edges to compute the intersection.  I only need
+   * to touch each edge once, so if I scatter just on the out edges,
+   * that is sufficient.
+   */
+  edge_dir_type scatter_edges(icontext_type& context,
+                              const vertex_type& vertex) const {
+    if (do_not_scatter) return graphlab::NO_EDGES;
+    else return graphlab::OUT_EDGES;
+  }
+
+
+  /*
+   * For each edge, count the intersection of the out-lists of the
+   * adjacent vertices.  This is the number of triangles in which the
+   * edge joins the two lowest ranked vertices.
+   */
+  void scatter(icontext_type& context,
+              const vertex_type& vertex,
+              edge_type& edge) const {
+    const vid_list& srclist = edge.source().data().out_list;
+    const vid_list& targetlist = edge.target().data().out_list;
+    if (PER_VERTEX_COUNT) {
+      top_credit visit(context);
+      edge.data() += sorted_intersect(srclist, targetlist, visit);
+    } else {
+      no_credit visit;
+      edge.data() += sorted_intersect(srclist, targetlist, visit);
+    }
+  }
+};
+
+/*
+ * This class is used in a second engine call if per vertex counts are
+ * needed.  Every triangle is counted on exactly one edge, that of its
+ * two lowest ranked vertices, so summing the counts on the adjacent
+ * edges credits the triangles in which the vertex is not the highest
+ * ranked.  The others were added by triangle_count.
+ */
+class get_per_vertex_count :
+      public graphlab::ivertex_program<graph_type, size_t>,
+      /* I have no data. Just force it to POD */
+      public graphlab::IS_POD_TYPE  {
+public:
+  // Gather on all edges
+  edge_dir_type gather_edges(icontext_type& context,
+                             const vertex_type& vertex) const {
+    return graphlab::ALL_EDGES;
+  }
+  // We gather the number of triangles each edge is involved in
+  size_t gather(icontext_type& context,
+                     const vertex_type& vertex,
+                     edge_type& edge) const {
+    return edge.data();
+  }
+
+  void apply(icontext_type& context, vertex_type& vertex,
+             const gather_type& num_triangles) {
+    vid_list().swap(vertex.data().out_list);
+    vertex.data().num_triangles += num_triangles;
+  }
+
+  // No scatter
+  edge_dir_type scatter_edges(icontext_type& context,
+                             const vertex_type& vertex) const {
+    return graphlab::NO_EDGES;
+  }
+
+
+};
+
+typedef graphlab::synchronous_engine<triangle_count> engine_type;
+
+/* Used to sum over all the edges in the graph in a
+ * map_reduce_edges call
+ * to get the total number of triangles
+ */
+size_t get_edge_data(const graph_type::edge_type& e) {
+  return e.data();
+}
+
+/*
+ * A saver which saves a file where each line is a vid / # triangles pair
+ */
+struct save_triangle_count{
+  std::string save_vertex(graph_type::vertex_type v) {
+    return graphlab::tostr(v.id()) + "\t" +
+           graphlab::tostr(v.data().num_triangles) + "\n";
+  }
+  std::string save_edge(graph_type::edge_type e) {
+    return "";
+  }
+};
+
+
+int main(int argc, char** argv) {
+  std::cout << "This program counts the exact number of triangles in the "
+            "provided graph.\n\n";
+
+  graphlab::command_line_options clopts("Exact Triangle Counting. "
+    "Given a graph, this program computes the total number of triangles "
+    "in the graph over a degree ordering of the vertices. An option "
+    "(per_vertex) is also provided which computes for each vertex, the "
+    "number of triangles it is involved in. "
+    "The algorithm assumes that each undirected edge appears exactly once "
+    "in the graph input. If edges may appear more than once, this procedure "
+    "will over count.");
+  std::string prefix, format;
+  std::string per_vertex;
+  size_t powerlaw = 0;
+  double alpha = 2.1;
+  clopts.attach_option("graph", prefix,
+                       "Graph input. reads all graphs matching prefix*");
+  clopts.attach_option("format", format,
+                       "The graph format");
+  clopts.attach_option("powerlaw", powerlaw,
+                       "Generate a synthetic powerlaw out-degree graph "
+                       "with this many vertices instead of loading one.");
+  clopts.attach_option("alpha", alpha,
+                       "Alpha in powerlaw distrubution");
+  clopts.attach_option("gallop_ratio", GALLOP_RATIO,
+                       "Intersect by galloping when one list is more than "
+                       "this many times longer than the other");
+  clopts.attach_option("per_vertex", per_vertex,
+                       "If not empty, will count the number of "
+                       "triangles each vertex belongs to and "
+                       "save to file with prefix \"[per_vertex]\".");
+  if(!clopts.parse(argc, argv)) return EXIT_FAILURE;
+  if (powerlaw == 0 && prefix == "") {
+    std::cout << "--graph is not optional\n";
+    clopts.print_description();
+    return EXIT_FAILURE;
+  }
+  else if (powerlaw == 0 && format == "") {
+    std::cout << "--format is not optional\n";
+    clopts.print_description();
+    return EXIT_FAILURE;
+  }
+
+
+  if (per_vertex != "") PER_VERTEX_COUNT = true;
+  // Initialize control plane using mpi
+  graphlab::mpi_tools::init(argc, argv);
+  graphlab::distributed_control dc;
+
+  graphlab::launch_metric_server();
+  // load graph
+  graph_type graph(dc, clopts);
+  if(powerlaw > 0) { // make a synthetic graph
+    dc.cout() << "Loading synthetic Powerlaw graph." << std::endl;
+    graph.load_synthetic_powerlaw(powerlaw, false, alpha, 100000000);
+  } else {
+    graph.load_format(prefix, format);
+  }
+  graph.finalize();
+  dc.cout() << "Number of vertices: " << graph.num_vertices() << std::endl
+            << "Number of edges:    " << graph.num_edges() << std::endl;
+
+  graphlab::timer ti;
+
+  // create engine to count the number of triangles
+  dc.cout() << "Counting Triangles..." << std::endl;
+  engine_type engine(dc, graph, clopts);
+  engine.signal_all();
+  engine.start();
+
+  dc.cout() << "Counted in " << ti.current_time() << " seconds" << std::endl;
+
+  size_t count = graph.map_reduce_edges<size_t>(get_edge_data);
+  dc.cout() << count << " Triangles"  << std::endl;
+
+  if (PER_VERTEX_COUNT) {
+    graphlab::synchronous_engine<get_per_vertex_count> engine(dc, graph, clopts);
+    engine.signal_all();
+    engine.start();
+    graph.save(per_vertex,
+            save_triangle_count(),
+            false, /* no compression */
+            true, /* save vertex */
+            false, /* do not save edge */
+            clopts.get_ncpus()); /* one file per machine */
+
+  }
+
+  graphlab::stop_metric_server();
+
+  graphlab::mpi_tools::finalize();
+  return EXIT_SUCCESS;
+} // End of main
@@ -0,0 +1,490 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <graphlab.hpp>
+#include <graphlab/macros_def.hpp>
+/**
+ *
+ * In this program we compute the core number of every vertex: the
+ * largest K such that the vertex is in the K-core.  We peel the graph
+ * with degree buckets, following
+ *
+ * L. Dhulipala, G. Blelloch and J. Shun, Julienne: A Framework for
+ * Parallel Graph Algorithms using Work-efficient Bucketing, SPAA 2017.
+ *
+ *  - K is the smallest degree of a remaining vertex
+ *  - Every remaining vertex of degree at most K has core number K and
+ *    is removed, in rounds, until every remaining vertex has degree
+ *    above K
+ *  - Then K moves to the next non-empty bucket
+ *
+ * Unlike the kcore toolkit, which scans every vertex for every K, only
+ * the vertices removed in a round and their neighbors are touched.
+ */
+
+/*
+ * Each vertex maintains the number of adjacent edges to remaining
+ * vertices, and its core number once it is removed.
+ */
+struct vertex_data_type : public graphlab::IS_POD_TYPE {
+  int degree;
+  int core;
+  vertex_data_type() : degree(0), core(-1) { }
+  bool removed() const { return core >= 0; }
+};
+
+/*
+ * Don't need any edges
+ */
+typedef graphlab::empty edge_data_type;
+
+/*
+ * Define the type of the graph
+ */
+typedef graphlab::distributed_graph<vertex_data_type,
+                                    edge_data_type> graph_type;
+
+// The core number of the current round
+int CURRENT_K;
+
+
+/*
+ * The remaining master vertices of this machine, bucketed by degree.
+ * A vertex is added to a bucket each time its degree drops, so an
+ * entry is only valid if the vertex is still remaining and its degree,
+ * or CURRENT_K if that is larger, is the bucket.  Stale entries are
+ * dropped when a bucket is scanned, and the buckets below CURRENT_K
+ * are never filled again.  Each machine moves to its own smallest
+ * bucket, which may be above the global K, so take() moves back down.
+ */
+class degree_buckets {
+ private:
+  std::vector<std::vector<graphlab::lvid_type> > buckets;
+  std::vector<graphlab::simple_spinlock> locks;
+  // every bucket below this is empty
+  size_t first;
+
+  static bool valid(const graph_type::vertex_type& v, size_t d) {
+    return !v.data().removed() &&
+      size_t(std::max(v.data().degree, CURRENT_K)) == d;
+  }
+
+ public:
+  void init(size_t max_degree) {
+    buckets.clear();
+    buckets.resize(max_degree + 1);
+    locks.resize(max_degree + 1);
+    first = 0;
+  }
+
+  // Concurrent with other calls to insert
+  void insert(size_t d, graphlab::lvid_type lvid) {
+    locks[d].lock();
+    buckets[d].push_back(lvid);
+    locks[d].unlock();
+  }
+
+  /*
+   * Returns the smallest bucket with a valid entry, dropping the stale
+   * entries of the buckets below it, or (size_t)(-1) if there is none.
+   */
+  size_t next(graph_type& graph) {
+    for (; first < buckets.size(); ++first) {
+      std::vector<graphlab::lvid_type>& b = buckets[first];
+      size_t j = 0;
+      for (size_t i = 0; i < b.size(); ++i) {
+        if (valid(graph_type::vertex_type(graph.l_vertex(b[i])), first)) {
+          b[j++] = b[i];
+        }
+      }
+      b.resize(j);
+      if (!b.empty()) return first;
+      std::vector<graphlab::lvid_type>().swap(b);
+    }
+    return (size_t)(-1);
+  }
+
+  /*
+   * Moves the valid entries of bucket d, the global K, into the vertex
+   * set.  next() may have moved past d on this machine, so the buckets
+   * from d up are scanned again by the following calls to next().
+   */
+  void take(size_t d, graph_type& graph, graphlab::vertex_set& vset) {
+    first = std::min(first, d);
+    if (d >= buckets.size()) return;
+    foreach(graphlab::lvid_type lvid, buckets[d]) {
+      if (valid(graph_type::vertex_type(graph.l_vertex(lvid)), d)) {
+        vset.set_lvid_unsync(lvid);
+      }
+    }
+    std::vector<graphlab::lvid_type>().swap(buckets[d]);
+  }
+};
+
+degree_buckets BUCKETS;
+
+
+/*
+ * The number of vertices removed in each round of the current K.
+ * Summing two counts adds them round by round.
+ */
+struct round_sizes {
+  std::vector<size_t> counts;
+  graphlab::simple_spinlock lock;
+
+  round_sizes() { }
+  round_sizes(const round_sizes& other) : counts(other.counts) { }
+  round_sizes& operator=(const round_sizes& other) {
+    counts = other.counts;
+    return *this;
+  }
+
+  // Concurrent with other calls to add
+  void add(size_t round) {
+    lock.lock();
+    if (counts.size() <= round) counts.resize(round + 1, 0);
+    ++counts[round];
+    lock.unlock();
+  }
+
+  round_sizes& operator+=(const round_sizes& other) {
+    if (counts.size() < other.counts.size()) {
+      counts.resize(other.counts.size(), 0);
+    }
+    for (size_t i = 0; i < other.counts.size(); ++i) {
+      counts[i] += other.counts[i];
+    }
+    return *this;
+  }
+
+  void save(graphlab::oarchive& oarc) const { oarc << counts; }
+  void load(graphlab::iarchive& iarc) { iarc >> counts; }
+};
+
+round_sizes ROUND_SIZES;
+
+
+/*
+ * Each iteration of the engine is a round of peeling. The message is
+ * the number of adjacent edges removed in the last round. A vertex
+ * whose degree falls to at most K is removed with core number K, and
+ * signals each remaining neighbor with a message of 1, so that the
+ * decrements of a round reach each neighbor combined.  A vertex whose
+ * degree is still above K moves to its new bucket.
+ */
+class peel :
+  public graphlab::ivertex_program<graph_type,
+                                   graphlab::empty, // gathers are integral
+                                   int>,   // messages are integral
+  public graphlab::IS_POD_TYPE  {
+public:
+  // the last received message
+  int msg;
+  bool just_removed;
+
+  peel():msg(0),just_removed(false) { }
+
+  void init(icontext_type& context, const vertex_type& vertex,
+            const message_type& message) {
+    msg = message;
+    just_removed = false;
+  }
+
+  // gather is never invoked
+  edge_dir_type gather_edges(icontext_type& context,
+                             const vertex_type& vertex) const {
+    return graphlab::NO_EDGES;
+  }
+
+  void apply(icontext_type& context, vertex_type& vertex,
+             const gather_type& unused) {
+    vertex_data_type& vdata = vertex.data();
+    if (vdata.removed()) return;
+    vdata.degree -= msg;
+    if (vdata.degree <= CURRENT_K) {
+      vdata.core = CURRENT_K;
+      just_removed = true;
+      ROUND_SIZES.add(context.iteration());
+    } else if (msg > 0) {
+      BUCKETS.insert(vdata.degree, vertex.local_id());
+    }
+  }
+
+  edge_dir_type scatter_edges(icontext_type& context,
+                              const vertex_type& vertex) const {
+    return just_removed ?
+      graphlab::ALL_EDGES : graphlab::NO_EDGES;
+  }
+
+  void scatter(icontext_type& context,
+               const vertex_type& vertex,
+               edge_type& edge) const {
+    vertex_type other = edge.source().id() == vertex.id() ?
+      edge.target() : edge.source();
+    if (!other.data().removed()) {
+      context.signal(other, 1);
+    }
+  }
+};
+
+// type of the synchronous_engine
+typedef graphlab::synchronous_engine<peel> engine_type;
+
+
+/*
+ * Initializes the vertex data to the number of adjacent edges.
+ */
+void initialize_vertex_values(graph_type::vertex_type& v) {
+  v.data() = vertex_data_type();
+  v.data().degree = v.num_in_edges() + v.num_out_edges();
+}
+
+/*
+ * The smallest bucket over all the machines.
+ */
+struct min_bucket : public graphlab::IS_POD_TYPE {
+  size_t d;
+  min_bucket(size_t d = (size_t)(-1)) : d(d) { }
+  min_bucket& operator+=(const min_bucket& other) {
+    d = std::min(d, other.d);
+    return *this;
+  }
+};
+
+struct max_degree : public graphlab::IS_POD_TYPE {
+  size_t d;
+  max_degree(size_t d = 0) : d(d) { }
+  max_degree& operator+=(const max_degree& other) {
+    d = std::max(d, other.d);
+    return *this;
+  }
+};
+
+max_degree get_max_degree(const graph_type::vertex_type& v) {
+  return max_degree(v.data().degree);
+}
+
+
+/*
+ * Saves the core number of each vertex
+ */
+struct save_core_number {
+  std::string save_vertex(graph_type::vertex_type v) {
+    return graphlab::tostr(v.id()) + "\t" +
+      graphlab::tostr(v.data().core) + "\n";
+  }
+  std::string save_edge(graph_type::edge_type e) { return ""; }
+};
+
+
+/*
+ * Gathers the graph and the core numbers on machine 0, and compares
+ * them with a sequential peel that removes a vertex of smallest degree
+ * at a time.  Returns true on every machine if they all match.
+ */
+bool check_core_numbers(graphlab::distributed_control& dc, graph_type& graph) {
+  typedef std::pair<graphlab::vertex_id_type, graphlab::vertex_id_type> pair_type;
+  std::vector<std::vector<pair_type> > edges(dc.numprocs());
+  std::vector<std::vector<std::pair<graphlab::vertex_id_type, int> > >
+    cores(dc.numprocs());
+  for (size_t i = 0; i < graph.num_local_vertices(); ++i) {
+    graph_type::local_vertex_type v = graph.l_vertex(i);
+    foreach(graph_type::local_edge_type e, v.out_edges()) {
+      edges[dc.procid()].push_back(pair_type(e.source().global_id(),
+                                             e.target().global_id()));
+    }
+    if (v.owned()) {
+      cores[dc.procid()].push_back(std::make_pair(v.global_id(),
+                                                  v.data().core));
+    }
+  }
+  dc.gather(edges, 0);
+  dc.gather(cores, 0);
+
+  bool match = true;
+  if (dc.procid() == 0) {
+    boost::unordered_map<graphlab::vertex_id_type, size_t> index;
+    std::vector<int> expected, found;
+    for (size_t p = 0; p < cores.size(); ++p) {
+      for (size_t i = 0; i < cores[p].size(); ++i) {
+        index[cores[p][i].first] = found.size();
+        found.push_back(cores[p][i].second);
+      }
+    }
+    std::vector<std::vector<size_t> > adj(found.size());
+    std::vector<size_t> degree(found.size(), 0);
+    for (size_t p = 0; p < edges.size(); ++p) {
+      for (size_t i = 0; i < edges[p].size(); ++i) {
+        const size_t s = index[edges[p][i].first];
+        const size_t t = index[edges[p][i].second];
+        adj[s].push_back(t);
+        adj[t].push_back(s);
+        degree[s]++;
+        degree[t]++;
+      }
+    }
+    // remaining vertices ordered by degree
+    std::set<std::pair<size_t, size_t> > queue;
+    for (size_t i = 0; i < degree.size(); ++i) {
+      queue.insert(std::make_pair(degree[i], i));
+    }
+    expected.resize(found.size(), -1);
+    size_t k = 0;
+    while (!queue.empty()) {
+      const size_t v = queue.begin()->second;
+      queue.erase(queue.begin());
+      k = std::max(k, degree[v]);
+      expected[v] = k;
+      foreach(size_t u, adj[v]) {
+        if (expected[u] >= 0) continue;
+        queue.erase(std::make_pair(degree[u], u));
+        queue.insert(std::make_pair(--degree[u], u));
+      }
+    }
+    size_t mismatches = 0;
+    for (size_t i = 0; i < found.size(); ++i) {
+      mismatches += (expected[i] != found[i]);
+    }
+    dc.cout() << "Sequential peel: " << mismatches
+              << " vertices with a different core number" << std::endl;
+    match = (mismatches == 0);
+  }
+  dc.broadcast(match, dc.procid() == 0);
+  return match;
+}
+
+
+int main(int argc, char** argv) {
+  std::cout << "Computes the core number of every vertex.\n\n";
+
+  graphlab::command_line_options clopts
+    ("K-Core decomposition by bucketed peeling. This program computes "
+     "the core number of every vertex in one run. The number of vertices "
+     "removed in each round is printed.");
+  std::string prefix, format;
+  std::string saveprefix;
+  size_t powerlaw = 0;
+  bool check = false;
+  clopts.attach_option("graph", prefix,
+                       "Graph input. reads all graphs matching prefix*");
+  clopts.attach_option("format", format,
+                       "The graph format");
+  clopts.attach_option("powerlaw", powerlaw,
+                       "Generate a synthetic powerlaw out-degree graph "
+                       "with this many vertices instead of loading one");
+  clopts.attach_option("saveprefix", saveprefix,
+                       "If set, will save the pairs of a vertex id and "
+                       "its core number to a sequence of files with prefix "
+                       "saveprefix");
+  clopts.attach_option("check", check,
+                       "If true, gathers the graph on one machine and "
+                       "compares the core numbers with a sequential peel. "
+                       "Fails if any differs.");
+
+  if(!clopts.parse(argc, argv)) return EXIT_FAILURE;
+  if (powerlaw == 0 && prefix == "") {
+    std::cout << "--graph is not optional\n";
+    clopts.print_description();
+    return EXIT_FAILURE;
+  }
+  else if (powerlaw == 0 && format == "") {
+    std::cout << "--format is not optional\n";
+    clopts.print_description();
+    return EXIT_FAILURE;
+  }
+  // Initialize control plane using mpi
+  graphlab::mpi_tools::init(argc, argv);
+  graphlab::distributed_control dc;
+  // load graph
+  graph_type graph(dc, clopts);
+  if (powerlaw > 0) {
+    dc.cout() << "Loading synthetic Powerlaw graph." << std::endl;
+    graph.load_synthetic_powerlaw(powerlaw, false, 2.1, 100000000);
+  } else {
+    graph.load_format(prefix, format);
+  }
+  graph.finalize();
+  dc.cout() << "Number of vertices: " << graph.num_vertices() << std::endl
+            << "Number of edges:    " << graph.num_edges() << std::endl;
+
+  graphlab::timer ti;
+
+  engine_type engine(dc, graph, clopts);
+
+  // initialize the vertex data with the degree, and bucket the masters
+  graph.transform_vertices(initialize_vertex_values);
+  CURRENT_K = 0;
+  BUCKETS.init(graph.map_reduce_vertices<max_degree>(get_max_degree).d);
+  for (size_t i = 0; i < graph.num_local_vertices(); ++i) {
+    if (graph.l_is_master(i)) {
+      BUCKETS.insert(graph.l_vertex(i).data().degree, i);
+    }
+  }
+
+  size_t total_rounds = 0;
+  while (true) {
+    min_bucket next(BUCKETS.next(graph));
+    dc.all_reduce(next);
+    if (next.d == (size_t)(-1)) break;
+    CURRENT_K = next.d;
+    // remove every vertex of the bucket, then round by round every
+    // vertex whose degree falls to at most K
+    graphlab::vertex_set frontier(false);
+    frontier.make_explicit(graph);
+    BUCKETS.take(CURRENT_K, graph, frontier);
+    ROUND_SIZES.counts.clear();
+    engine.signal_vset(frontier, 0);
+    engine.start();
+    round_sizes sizes = ROUND_SIZES;
+    dc.all_reduce(sizes);
+
+    size_t removed = 0;
+    std::stringstream strm;
+    for (size_t i = 0; i < sizes.counts.size(); ++i) {
+      removed += sizes.counts[i];
+      strm << " " << sizes.counts[i];
+    }
+    total_rounds += sizes.counts.size();
+    dc.cout() << "K=" << CURRENT_K << ":  #V removed = " << removed
+              << "   rounds = " << sizes.counts.size()
+              << "   per round:" << strm.str() << std::endl;
+  }
+  dc.cout() << "Max core number: " << CURRENT_K << std::endl
+            << "Total rounds: " << total_rounds << std::endl
+            << "Core numbers in " << ti.current_time() << " seconds"
+            << std::endl;
+
+  if (saveprefix != "") {
+    graph.save(saveprefix, save_core_number(),
+               false, /* no compression */
+               true, /* save vertex */
+               false, /* do not save edge */
+               clopts.get_ncpus()); /* one file per machine */
+  }
+
+  bool success = true;
+  if (check) success = check_core_numbers(dc, graph);
+
+  graphlab::mpi_tools::finalize();
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+} // End of main
@@ -145,6 +145,15 @@ public:
 
 }; // end of factorized_pagerank update functor
 
+/*
+ * pagerank always gathers on in edges and sums doubles starting from 0,
+ * so the synchronous engine can inline gather into its edge loop.
+ */
+namespace graphlab {
+  template <>
+  struct static_edge_traits<pagerank> : public static_gather_dir<IN_EDGES> { };
+}
+
 
 /*
  * We want to save the final graph so we define a write which will be
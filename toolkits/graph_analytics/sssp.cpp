@@ -87,6 +87,15 @@ struct min_distance_type : graphlab::IS_POD_TYPE {
     dist = std::min(dist, other.dist);
     return *this;
   }
+  /**
+   * Shorter distances first. Used by the priority schedulers, and to
+   * pick the bucket with the delta_stepping scheduler
+   * (--scheduler=delta_stepping --scheduler_opts="delta=...") or in
+   * the synchronous engine's bucket mode (--engine_opts="delta=...").
+   */
+  double priority() const {
+    return -dist;
+  }
 };
 
 
@@ -165,6 +174,39 @@ public:
 }; // end of shortest path vertex program
 
 
+/**
+ * \brief sssp never gathers, which lets the synchronous engine skip
+ * gather_edges() and call scatter without virtual dispatch.
+ */
+namespace graphlab {
+  template <>
+  struct static_edge_traits<sssp> : public static_gather_dir<NO_EDGES> { };
+}
+
+
+
+
+/**
+ * \brief Parses "source target weight" lines separated by whitespace.
+ * Used for --format=weighted_tsv. The weight defaults to 1.
+ */
+bool weighted_edge_parser(graph_type& graph, const std::string& filename,
+                          const std::string& line) {
+  if (line.empty() || line[0] == '#') return true;
+  const char* str = line.c_str();
+  char* end;
+  const graphlab::vertex_id_type source = strtoul(str, &end, 10);
+  if (end == str) return false;
+  str = end;
+  const graphlab::vertex_id_type target = strtoul(str, &end, 10);
+  if (end == str) return false;
+  str = end;
+  distance_type weight = strtod(str, &end);
+  if (end == str) weight = 1;
+  if (source != target) graph.add_edge(source, target, edge_data(weight));
+  return true;
+} // end of weighted_edge_parser
+
 
 
 /**
@@ -220,7 +262,8 @@ int main(int argc, char** argv) {
                        "then a toy graph will be created");
   clopts.add_positional("graph");
   clopts.attach_option("format", format,
-                       "graph format");
+                       "graph format. weighted_tsv reads \"source target "
+                       "weight\" lines");
   clopts.attach_option("source", sources,
                        "The source vertices");
   clopts.attach_option("max_degree_source", max_degree_source,
@@ -255,7 +298,8 @@ int main(int argc, char** argv) {
     graph.load_synthetic_powerlaw(powerlaw, false, 2, 100000000);
   } else if (graph_dir.length() > 0) { // Load the graph from a file
     dc.cout() << "Loading graph in format: "<< format << std::endl;
-    graph.load_format(graph_dir, format);
+    if (format == "weighted_tsv") graph.load(graph_dir, weighted_edge_parser);
+    else graph.load_format(graph_dir, format);
   } else {
     dc.cout() << "graph or powerlaw option must be specified" << std::endl;
     clopts.print_description();
@@ -899,17 +899,7 @@ void SolveMAP_dense(vertex_type& vertex,const gather_type& total,
             vec& variable_posteriors, vec& additional_posteriors, double& value){
      vertex_data& vdata = vertex.data();
      vec beliefs = vdata.potentials;         
-     int num_configurations = vdata.potentials.size();
-     for (int index_configuration = 0;
-           index_configuration < num_configurations;
-            ++index_configuration) {
-        vector<int> states(vdata.nvars, -1);
-        get_configuration_states(vertex, index_configuration, &states);
-        int offset = 0;
-        for (int k = 0; k < vdata.nvars; ++k) {
-             beliefs[index_configuration] += total.messages[offset + states[k]];
-             offset += vdata.cards[k];}
-    } 
+     add_messages(vertex, total.messages, beliefs);
             
         value = beliefs.maxCoeff();
  
@@ -1179,15 +1169,7 @@ struct bethe_admm_vertex_program:public admm_vertex_program {
             vec& variable_posteriors, vec& additional_posteriors, double& value){
              vertex_data& vdata = vertex.data();
              vec beliefs = vdata.potentials;
-             vector<int> states(vdata.nvars);
-             for(int i=0; i< vdata.potentials.size(); i++) {
-                 get_configuration_states(vertex, i, &states);
-                 int offset = 0;
-                 for(int j=0; j< vdata.nvars; j++){
-                     beliefs[i] += total.messages[offset + states[j]];
-                     offset += vdata.cards[j];
-                 }
-             }
+             add_messages(vertex, total.messages, beliefs);
              value = beliefs.maxCoeff();  
          };
  
@@ -316,6 +316,36 @@ public graphlab::IS_POD_TYPE
        
     }
 
+    /////////////////////////////////////////////////////////////////////////
+    // Add to each configuration of a factor the messages of its states.
+    // The states of variable k repeat in blocks of the product of the 
+    // cardinalities of the later variables, so each message is added to
+    // a contiguous block of configurations.
+    /////////////////////////////////////////////////////////////////////////
+    void add_messages(const graph_type::vertex_type& vertex,
+                      const vec& messages, vec& beliefs) const 
+    {
+        const vertex_data& vdata = vertex.data();
+        const int num_configurations = beliefs.size();
+        int block = num_configurations;
+        int offset = 0;
+        for (int k = 0; k < vdata.nvars; ++k) 
+        {
+            const int card = vdata.cards[k];
+            block /= card;
+            for (int start = 0; start < num_configurations; start += block * card) 
+            {
+                for (int state = 0; state < card; ++state) 
+                {
+                    const double message = messages[offset + state];
+                    double* belief = beliefs.data() + start + state * block;
+                    for (int i = 0; i < block; ++i) belief[i] += message;
+                }
+            }
+            offset += card;
+        }
+    }
+
     ///////////////////////////////////////////////////////////
     // Updates stepsize according to different stepsize rules. 
     ///////////////////////////////////////////////////////////
@@ -514,22 +544,7 @@ struct dd_vertex_program_symmetric : public dd_vertex_program {
         {
             // General factor.
             vec belief = vdata.potentials;
-            int num_configurations = vdata.potentials.size();
-            for (int index_configuration = 0;
-                 index_configuration < num_configurations;
-                 ++index_configuration) 
-            {
-                vector<int> states(vdata.nvars, -1);
-                // This could be made more efficient by defining an iterator over factor
-                // configurations.
-                get_configuration_states(vertex, index_configuration, &states);
-                int offset = 0;
-                for (int k = 0; k < vdata.nvars; ++k) 
-                {
-                    belief[index_configuration] += total.messages[offset + states[k]];
-                    offset += vdata.cards[k];
-                }
-            }
+            add_messages(vertex, total.messages, belief);
             // Save the best configuration for this factor and find dual contrib
             vdata.dual_contrib = belief.maxCoeff(&vdata.best_configuration);
             //Find primal contrib
@@ -774,20 +789,7 @@ struct dd_vertex_program_projected : public dd_vertex_program {
           if(context.iteration()%2 == 0){
             // General factor.
             vec beliefs = vdata.potentials;
-            int num_configurations = vdata.potentials.size();
-            for (int index_configuration = 0;
-                 index_configuration < num_configurations;
-                 ++index_configuration) {
-                vector<int> states(vdata.nvars, -1);
-                // This could be made more efficient by defining an iterator over factor
-                // configurations.
-                get_configuration_states(vertex, index_configuration, &states);
-                int offset = 0;
-                for (int k = 0; k < vdata.nvars; ++k) {
-                    beliefs[index_configuration] += total.messages[offset + states[k]];
-                    offset += vdata.cards[k];
-                }
-            }
+            add_messages(vertex, total.messages, beliefs);
             // Save the best configuration for this factor and find dual contrib             
             vdata.dual_contrib = beliefs.maxCoeff(&vdata.best_configuration);
             //Find primal contrib
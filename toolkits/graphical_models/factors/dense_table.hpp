@@ -56,6 +56,7 @@
 #include "discrete_domain.hpp"
 #include "discrete_assignment.hpp"
 #include "fast_discrete_assignment.hpp"
+#include "strided_index.hpp"
 #include "table_base.hpp"
 
 
@@ -432,11 +433,22 @@ namespace graphlab {
         // other domain must be a subset of this domain
         DCHECK_EQ((args() + other.args()).num_vars(), num_vars());
 
-        typename domain_type::const_iterator asg = args().begin();
-        typename domain_type::const_iterator end = args().end();
-        for( ; asg != end; ++asg) {
-          double val = f(logP(asg->linear_index()), other.logP(*asg));
-          set_logP( asg->linear_index(), val );
+        // broadcast other across each run of our entries
+        const double* x = &other._data[0];
+        for(strided_index<MAX_DIM> it(args(), other.args());
+            !it.done(); it.next_run()) {
+          double* y = &_data[it.index()];
+          const size_t n = it.run_length();
+          const size_t stride = it.run_stride();
+          if(stride == 0) {
+            const double xval = x[it.sub_index()];
+            for(size_t i = 0; i < n; ++i)
+              y[i] = std::max(f(y[i], xval), APPROX_LOG_ZERO());
+          } else {
+            const double* xrun = x + it.sub_index();
+            for(size_t i = 0; i < n; ++i)
+              y[i] = std::max(f(y[i], xrun[i * stride]), APPROX_LOG_ZERO());
+          }
         }
       }
       //ASSERT_TRUE(is_finite());
@@ -525,6 +537,8 @@ namespace graphlab {
     using table_base_t::marginalize;
     
     //! msg(x) = sum_y this(x,y) 
+    // computed as max_y this(x,y) + log(sum_y exp(this(x,y) - max_y this(x,y)))
+    // so that the sum does not underflow
     void marginalize(dense_table_impl& msg) const {
       // No need to marginalize
       if(args() == msg.args()) {
@@ -532,30 +546,35 @@ namespace graphlab {
         msg = *this;
         return;
       }
-      // Compute the domain to remove
-      domain_type ydom = args() - msg.args();
-      DCHECK_GT(ydom.num_vars(), 0);
-          
-      fast_discrete_assignment<MAX_DIM> fastyasg(args());
-      fastyasg.transpose_to_start(ydom);
-      // count the number of elements in ydom
-      size_t numel = ydom.size();
-      // Loop over x
-      typename domain_type::const_iterator xasg = msg.args().begin(); 
-      typename domain_type::const_iterator end = msg.args().end();
-      for( ; xasg != end; ++xasg) {
-        double sum = 0;
-        for(size_t i = 0;i < numel; ++i) {
-          sum += exp(logP(fastyasg.linear_index()));
-          ++fastyasg;
+      DCHECK_GT((args() - msg.args()).num_vars(), 0);
+
+      // msg(x) = max_y this(x,y)
+      MAP(msg);
+      std::vector<double> sums(msg.size(), 0.0);
+      const double* maxvals = &msg._data[0];
+      for(strided_index<MAX_DIM> it(args(), msg.args());
+          !it.done(); it.next_run()) {
+        const double* y = &_data[it.index()];
+        const size_t n = it.run_length();
+        const size_t stride = it.run_stride();
+        if(stride == 0) {
+          const double maxval = maxvals[it.sub_index()];
+          double sum = 0;
+          for(size_t i = 0; i < n; ++i) sum += exp(y[i] - maxval);
+          sums[it.sub_index()] += sum;
+        } else {
+          const double* maxrun = maxvals + it.sub_index();
+          double* sumrun = &sums[it.sub_index()];
+          for(size_t i = 0; i < n; ++i)
+            sumrun[i * stride] += exp(y[i] - maxrun[i * stride]);
         }
-        DASSERT_FALSE( std::isinf(sum) );
-        DASSERT_FALSE( std::isnan(sum) );
-        DCHECK_GE(sum, 0.0);
-        if(sum == 0) 
-          msg.set_logP( xasg->linear_index(), APPROX_LOG_ZERO() );
-        else 
-          msg.set_logP( xasg->linear_index(), log(sum) );
+      }
+      for(size_t i = 0; i < msg.size(); ++i) {
+        DASSERT_FALSE( std::isinf(sums[i]) );
+        DASSERT_FALSE( std::isnan(sums[i]) );
+        // the entries are all zero
+        if(maxvals[i] <= APPROX_LOG_ZERO()) continue;
+        msg.set_logP( i, maxvals[i] + log(sums[i]) );
       }
     }
       
@@ -570,24 +589,24 @@ namespace graphlab {
         msg = *this;
         return;
       }
-      // Compute the domain to remove
-      domain_type ydom = args() - msg.args();
-      DCHECK_GT(ydom.num_vars(), 0);
-        
-      fast_discrete_assignment<MAX_DIM> fastyasg(args());
-      fastyasg.transpose_to_start(ydom);
-      // count the number of elements in ydom
-      size_t numel = ydom.size();
-      // Loop over x
-      typename domain_type::const_iterator xasg = msg.args().begin();
-      typename domain_type::const_iterator end = msg.args().end();
-      for( ; xasg != end; ++xasg) {
-        double maxval = APPROX_LOG_ZERO();
-        for(size_t i = 0;i < numel; ++i) {
-          maxval = std::max(maxval, logP(fastyasg.linear_index()));
-          ++fastyasg;
+      DCHECK_GT((args() - msg.args()).num_vars(), 0);
+
+      msg.uniform(APPROX_LOG_ZERO());
+      double* x = &msg._data[0];
+      for(strided_index<MAX_DIM> it(args(), msg.args());
+          !it.done(); it.next_run()) {
+        const double* y = &_data[it.index()];
+        const size_t n = it.run_length();
+        const size_t stride = it.run_stride();
+        if(stride == 0) {
+          double maxval = x[it.sub_index()];
+          for(size_t i = 0; i < n; ++i) maxval = std::max(maxval, y[i]);
+          x[it.sub_index()] = maxval;
+        } else {
+          double* xrun = x + it.sub_index();
+          for(size_t i = 0; i < n; ++i)
+            xrun[i * stride] = std::max(xrun[i * stride], y[i]);
         }
-        msg.set_logP( xasg->linear_index(), maxval );
       }
       //ASSERT_TRUE(is_finite());
     }
@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ *
+ */
+
+
+#ifndef STRIDED_INDEX_HPP
+#define STRIDED_INDEX_HPP
+
+#include "discrete_variable.hpp"
+#include "discrete_domain.hpp"
+
+
+namespace graphlab {
+
+  /**
+   * Walks the linear indices of a domain together with the matching
+   * linear indices of a sub-domain, a run of consecutive indices at a
+   * time. Within a run the index in the domain increases by one and
+   * the index in the sub-domain by run_stride(), which is 0 when the
+   * run spans only variables outside of the sub-domain.
+   *
+   * The leading variables are merged into a single run whenever their
+   * sub-domain indices are also laid out consecutively, so that the
+   * inner loops over a run are long, have no branches, and can be
+   * vectorized by the compiler. e.g.,
+   *
+   *   for(strided_index<MAX_DIM> it(args(), msg.args());
+   *       !it.done(); it.next_run()) {
+   *     for(size_t i = 0; i < it.run_length(); ++i)
+   *       out[it.sub_index() + i * it.run_stride()] += in[it.index() + i];
+   *   }
+   */
+  template<size_t MAX_DIM>
+  class strided_index {
+  public:
+    //! sub_domain must be a subset of domain
+    strided_index(const discrete_domain<MAX_DIM>& domain,
+                  const discrete_domain<MAX_DIM>& sub_domain) :
+        _num_dims(0), _index(0), _sub_index(0), _size(domain.size()) {
+      // the stride of each variable in the sub-domain, or 0
+      size_t strides[MAX_DIM];
+      size_t multiple = 1;
+      size_t j = 0;
+      for(size_t i = 0; i < domain.num_vars(); ++i) {
+        strides[i] = 0;
+        if(j < sub_domain.num_vars() &&
+           domain.var(i).id() == sub_domain.var(j).id()) {
+          strides[i] = multiple;
+          multiple *= sub_domain.var(j).size();
+          ++j;
+        }
+      }
+      DCHECK_EQ(j, sub_domain.num_vars());
+
+      _run_length = 1;
+      _run_stride = domain.num_vars() > 0 ? strides[0] : 0;
+      size_t i = 0;
+      // merge the leading variables that continue the run
+      for( ; i < domain.num_vars() &&
+             strides[i] == _run_stride * _run_length; ++i) {
+        _run_length *= domain.var(i).size();
+      }
+      for( ; i < domain.num_vars(); ++i) {
+        _sizes[_num_dims] = domain.var(i).size();
+        _strides[_num_dims] = strides[i];
+        _asgs[_num_dims] = 0;
+        ++_num_dims;
+      }
+    }
+
+    //! the index in the domain of the start of the run
+    size_t index() const { return _index; }
+
+    //! the index in the sub-domain of the start of the run
+    size_t sub_index() const { return _sub_index; }
+
+    //! the number of indices in each run
+    size_t run_length() const { return _run_length; }
+
+    //! the step of the sub-domain index within a run
+    size_t run_stride() const { return _run_stride; }
+
+    bool done() const { return _index >= _size; }
+
+    //! Move to the next run
+    void next_run() {
+      _index += _run_length;
+      for(size_t d = 0; d < _num_dims; ++d) {
+        if(++_asgs[d] < _sizes[d]) {
+          _sub_index += _strides[d];
+          return;
+        }
+        _sub_index -= (_sizes[d] - 1) * _strides[d];
+        _asgs[d] = 0;
+      }
+    }
+
+  private:
+    // the variables that are not merged into the run
+    size_t _num_dims;
+    size_t _sizes[MAX_DIM];
+    size_t _strides[MAX_DIM];
+    size_t _asgs[MAX_DIM];
+
+    size_t _run_length;
+    size_t _run_stride;
+
+    size_t _index;
+    size_t _sub_index;
+    size_t _size;
+  }; // end of strided_index
+
+} // end of namespace graphlab
+
+#endif // STRIDED_INDEX_HPP
@@ -202,6 +202,49 @@ void multiplyTest(unsigned v0_id, unsigned v1_id, unsigned v2_id)
   }
 }
 
+// compare marginalize and MAP over a sub-domain to sums and maxes over
+// the restricted assignments
+void marginalizeTest(unsigned v0_id, unsigned v1_id, unsigned v2_id,
+                     const std::vector<unsigned>& msg_ids)
+{
+  dense_table_t dt = create_dense_table(v0_id, v1_id, v2_id);
+  std::vector<variable_t> msg_vars;
+  for(size_t i = 0; i < msg_ids.size(); ++i) {
+    msg_vars.push_back(dt.var(dt.domain().var_location(msg_ids[i])));
+  }
+  domain_t msg_domain(msg_vars);
+  dense_table_t sum_msg(msg_domain);
+  dense_table_t max_msg(msg_domain);
+  dt.marginalize(sum_msg);
+  dt.MAP(max_msg);
+
+  std::vector<double> sums(msg_domain.size(), 0.0);
+  std::vector<double> maxes(msg_domain.size(), -1e300);
+  for(size_t i=0; i < dt.size(); ++i) {
+    assignment_t dt_asg(dt.domain(), i);
+    size_t j = dt_asg.restrict(msg_domain).linear_index();
+    sums[j] += exp(dt.logP(dt_asg));
+    maxes[j] = std::max(maxes[j], dt.logP(dt_asg));
+  }
+  for(size_t j=0; j < msg_domain.size(); ++j) {
+    assignment_t msg_asg(msg_domain, j);
+    ASSERT_EQ(max_msg.logP(msg_asg), maxes[j]);
+    // the sum of entries which are far below the max is 0 in linear space
+    if(sums[j] > 0) ASSERT_LT(fabs(sum_msg.logP(msg_asg) - log(sums[j])), 1e-9);
+    else ASSERT_LE(sum_msg.logP(msg_asg), maxes[j] + log(double(dt.size())));
+  }
+
+  // broadcast the message back across the table
+  dense_table_t dt_gm = dt;
+  dt *= max_msg;
+  for(size_t i=0; i < dt.size(); ++i) {
+    assignment_t dt_asg(dt.domain(), i);
+    assignment_t msg_asg = dt_asg.restrict(msg_domain);
+    ASSERT_EQ(dt.logP(dt_asg), 
+        std::max(dt_gm.logP(dt_asg)+max_msg.logP(msg_asg), -1e6));
+  }
+}
+
 int main() {
   // create a table 
   dense_table_t dt_gm = create_dense_table(2, 0, 1);
@@ -239,5 +282,18 @@ int main() {
   multiplyTest(4, 2, 3);
   multiplyTest(4, 3, 2);
 
+  // marginalize test - over every sub-domain of one and two variables
+  unsigned ids[3] = {2, 3, 4};
+  for(size_t i = 0; i < 3; ++i) {
+    for(size_t j = i; j < 3; ++j) {
+      std::vector<unsigned> msg_ids;
+      msg_ids.push_back(ids[i]);
+      if(j != i) msg_ids.push_back(ids[j]);
+      marginalizeTest(2, 3, 4, msg_ids);
+      marginalizeTest(3, 4, 2, msg_ids);
+      marginalizeTest(4, 2, 3, msg_ids);
+    }
+  }
+
   std::cout << "All tests passed" << std::endl;
 }
@@ -91,6 +91,7 @@
 
 #include <Eigen/Dense>
 #include "eigen_serialization.hpp"
+#include "potts_convolution.hpp"
 
 
 
@@ -154,6 +155,21 @@ double DAMPING = 0.1;
  */
 double TOLERANCE = 0.01;
 
+/**
+ * \brief If set, each vertex caches the product of its inbound
+ * messages across updates, and a new message is folded into the cache
+ * of its target by posting the change (a difference in log-space),
+ * instead of the target recomputing the product over all its edges.
+ *
+ * Scatter records the posted message on the edge, where the target
+ * reads it back for its cavity.  This requires the edge locks of the
+ * asynchronous engine, so the cache is turned off for the synchronous
+ * engine, which scatters adjacent vertices concurrently.
+ *
+ * This parameter is set as a command line argument.
+ */
+bool USE_CACHE = true;
+
 
 /**
  * \brief The vertex data contains the vertex potential as well as the
@@ -367,7 +383,14 @@ struct bp_vertex_program :
     // Compute message residual
     const double residual = 
       (new_out_message - old_out_message).cwiseAbs().sum();
-    context.clear_gather_cache(other_vertex);
+    if(USE_CACHE) {
+      // Fold the change into the cached product of the target and
+      // record the message as received
+      context.post_delta(other_vertex, new_out_message - old_out_message);
+      edata.update_old(vertex.id(), other_vertex.id());
+    } else {
+      context.clear_gather_cache(other_vertex);
+    }
     // Schedule the adjacent vertex
     if(residual > TOLERANCE) context.signal(other_vertex, residual);
  }; // end of scatter
@@ -385,16 +408,7 @@ private:
    */
   inline void convolve(const factor_type& cavity, const double& weight, 
                        factor_type& message) const {
-    for(int i = 0; i < message.size(); ++i) {
-      double sum = 0;
-      for(int j = 0; j < cavity.size(); ++j) {
-        sum += std::exp( cavity(j)  + ( i == j? 0 : -(SMOOTHING*weight) ) ); 
-      }
-      // To try and ensure numerical stability we do not allow
-      // messages to underflow in log-space
-      message(i) = (sum > 0)? std::log(sum) : 
-        std::numeric_limits<double>::min();
-    }
+    potts_convolve(cavity, SMOOTHING*weight, message);
   } // end of convolve
   
   /**
@@ -614,11 +628,25 @@ int main(int argc, char** argv) {
                        "Return maximizing assignment instead of the posterior distribution.");
   clopts.attach_option("engine", exec_type,
                        "The type of engine to use {async, sync}.");
+  clopts.attach_option("cache", USE_CACHE,
+                       "Cache the product of the inbound messages of each vertex.");
   if(!clopts.parse(argc, argv)) {
     graphlab::mpi_tools::finalize();
     return clopts.is_set("help")? EXIT_SUCCESS : EXIT_FAILURE;
   }
 
+  if(USE_CACHE && (exec_type == "sync" || exec_type == "synchronous")) {
+    logstream(LOG_WARNING) 
+      << "The message cache requires the asynchronous engine. "
+      << "Running without it." << std::endl;
+    USE_CACHE = false;
+  }
+  clopts.get_engine_args().set_option("use_cache", USE_CACHE);
+  // Residual belief propagation: the async engine runs the vertex with
+  // the largest sum of inbound message residuals first
+  if(clopts.get_scheduler_type().empty()) 
+    clopts.set_scheduler_type("multiqueue");
+
   if(prior_dir.empty()) {
     logstream(LOG_ERROR) << "No prior was provided." << std::endl;
     clopts.print_description();
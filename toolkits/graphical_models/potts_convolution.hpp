@@ -0,0 +1,63 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ *
+ */
+
+#ifndef POTTS_CONVOLUTION_HPP
+#define POTTS_CONVOLUTION_HPP
+
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include <Eigen/Dense>
+
+
+/**
+ * \brief Compute the convolution of a log-space cavity with the
+ * Ising-Potts potential exp(-smoothing * [i != j]) and store the result
+ * in the log-space message.
+ *
+ * Every state but the matching one is scaled by the same factor
+ * exp(-smoothing), so with S the sum of exp(cavity):
+ *
+ * \code
+ * message(i) = log( exp(cavity(i)) + 
+ *                   exp(-smoothing) * (S - exp(cavity(i))) )
+ * \endcode
+ *
+ * which takes linear rather than quadratic time in the number of
+ * states.  The cavity is shifted by its maximum before taking the
+ * exponent, so the sums cannot overflow.  States of the message beyond
+ * the size of the cavity match none of its states.
+ */
+inline void potts_convolve(const Eigen::VectorXd& cavity, double smoothing,
+                           Eigen::VectorXd& message) {
+  const double shift = cavity.maxCoeff();
+  const Eigen::ArrayXd expcavity = (cavity.array() - shift).exp();
+  const double sum = expcavity.sum();
+  const double scale = std::exp(-smoothing);
+  const int nmatched = std::min(message.size(), cavity.size());
+  message.head(nmatched).array() = 
+    (expcavity.head(nmatched) + 
+     scale * (sum - expcavity.head(nmatched)))
+    .max(std::numeric_limits<double>::min()).log() + shift;
+  message.tail(message.size() - nmatched).setConstant(
+    std::log(scale * sum) + shift);
+} // end of potts_convolve
+
+#endif
@@ -47,6 +47,7 @@
 
 #include <Eigen/Dense>
 #include "eigen_serialization.hpp"
+#include "potts_convolution.hpp"
 
 
 
@@ -342,16 +343,7 @@ private:
    */
   inline void convolve(const factor_type& cavity, const double& weight, 
                        factor_type& message) const {
-    for(int i = 0; i < message.size(); ++i) {
-      double sum = 0;
-      for(int j = 0; j < cavity.size(); ++j) {
-        sum += std::exp( cavity(j)  + ( i == j? 0 : -(SMOOTHING*weight) ) ); 
-      }
-      // To try and ensure numerical stability we do not allow
-      // messages to underflow in log-space
-      message(i) = (sum > 0)? std::log(sum) : 
-        std::numeric_limits<double>::min();
-    }
+    potts_convolve(cavity, SMOOTHING*weight, message);
   } // end of convolve
   
   /**
@@ -0,0 +1,445 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ *
+ */
+
+
+/**
+ * Functionality: The code solves the linear system AX = B using the
+ * preconditioned conjugate gradient method, for one or more right hand
+ * sides (the columns of B) at once. A is assumed to be symmetric
+ * positive definite. Algorithm is described
+ * http://en.wikipedia.org/wiki/Conjugate_gradient_method
+ *
+ * Each vertex is a row of the system and keeps the values of all the
+ * right hand sides. A matrix vector product is a single
+ * graph_gather_apply over the stored off diagonal entries, and the dot
+ * products of all the columns are summed with one all-reduce.
+ *
+ * The block Jacobi preconditioner is the diagonal block of A over the
+ * rows owned by each machine, restricted to the entries stored on that
+ * machine, and is factored once with a sparse Cholesky decomposition.
+ */
+#include "../collaborative_filtering/eigen_wrapper.hpp"
+#include "../collaborative_filtering/eigen_serialization.hpp"
+#include <boost/algorithm/string/predicate.hpp>
+#include <graphlab.hpp>
+#include <graphlab/macros_def.hpp>
+
+
+std::string rhsfile;
+int NRHS = 1;
+
+struct vertex_data {
+  double A_ii;
+  // the values of the rows of B, X, the residual R = B - AX, the
+  // preconditioned residual Z, the search direction P and AP
+  vec b, x, r, z, p, Ap;
+  vertex_data(): A_ii(0) { }
+  void save(graphlab::oarchive& arc) const {
+    arc << A_ii << b << x << r << z << p << Ap;
+  }
+  void load(graphlab::iarchive& arc) {
+    arc >> A_ii >> b >> x >> r >> z >> p >> Ap;
+  }
+}; // end of vertex_data
+
+struct edge_data : public graphlab::IS_POD_TYPE {
+  double A_ij;
+  edge_data(double A_ij = 0) : A_ij(A_ij) { }
+}; // end of edge data
+
+typedef graphlab::distributed_graph<vertex_data, edge_data> graph_type;
+typedef graph_type::lvid_type lvid_type;
+
+/**
+ * \brief A value for each right hand side. The values of the replicas
+ * of a vertex are summed, and an empty block adds nothing.
+ */
+struct rhs_block {
+  vec v;
+  rhs_block() { }
+  explicit rhs_block(const vec& v) : v(v) { }
+  rhs_block& operator+=(const rhs_block& other) {
+    if (v.size() == 0) v = other.v;
+    else if (other.v.size() > 0) v += other.v;
+    return *this;
+  }
+  void save(graphlab::oarchive& arc) const { arc << v; }
+  void load(graphlab::iarchive& arc) { arc >> v; }
+}; // end of rhs_block
+
+// the step sizes of each right hand side
+vec ALPHA, BETA;
+
+// the rows owned by this machine
+std::vector<lvid_type> MASTERS;
+
+
+/**
+ * \brief The graph loader function is a line parser used for
+ * distributed graph construction. Each line is an entry of A,
+ * "row col val", and both A_ij and A_ji must be listed.
+ */
+inline bool graph_loader(graph_type& graph,
+    const std::string& filename,
+    const std::string& line) {
+
+  //no need to parse
+  if (rhsfile.size() > 0 && boost::algorithm::ends_with(filename, rhsfile))
+    return true;
+
+  ASSERT_FALSE(line.empty());
+  std::stringstream strm(line);
+  graph_type::vertex_id_type source_id(-1), target_id(-1);
+  double obs(0);
+  strm >> source_id >> target_id >> obs;
+  source_id--; target_id--;
+
+  if (source_id == target_id){
+    vertex_data data;
+    data.A_ii = obs;
+    graph.add_vertex(source_id, data);
+  }
+  else graph.add_edge(source_id, target_id, edge_data(obs));
+  return true; // successful load
+} // end of graph_loader
+
+
+/**
+ * \brief AP: each replica sums its stored entries of the row, and the
+ * owner adds the diagonal.
+ */
+rhs_block matvec_gather(lvid_type lvid, graph_type& graph) {
+  graph_type::local_vertex_type vertex = graph.l_vertex(lvid);
+  vec sum = vec::Zero(NRHS);
+  if (vertex.owned()) sum = vertex.data().A_ii * vertex.data().p;
+  foreach(graph_type::local_edge_type edge, vertex.out_edges()) {
+    sum += edge.data().A_ij * edge.target().data().p;
+  }
+  return rhs_block(sum);
+}
+
+void matvec_apply(lvid_type lvid, const rhs_block& Ap, graph_type& graph) {
+  graph.l_vertex(lvid).data().Ap = Ap.v;
+}
+
+/**
+ * \brief P = Z + BETA P: the owner sends Z, which is only computed on
+ * the owner, to the mirrors.
+ */
+rhs_block direction_gather(lvid_type lvid, graph_type& graph) {
+  if (!graph.l_is_master(lvid)) return rhs_block();
+  return rhs_block(graph.l_vertex(lvid).data().z);
+}
+
+void direction_apply(lvid_type lvid, const rhs_block& z, graph_type& graph) {
+  vertex_data& vdata = graph.l_vertex(lvid).data();
+  vdata.z = z.v;
+  vdata.p = z.v + BETA.cwiseProduct(vdata.p);
+}
+
+
+/**
+ * \brief The dot products of the columns of two fields over the rows
+ * owned by this machine, e.g. the fields &vertex_data::r and
+ * &vertex_data::z.
+ */
+void local_dot(graph_type& graph, vec vertex_data::* a, vec vertex_data::* b,
+               vec& ret) {
+  ret = vec::Zero(NRHS);
+  for (size_t i = 0; i < MASTERS.size(); ++i) {
+    const vertex_data& vdata = graph.l_vertex(MASTERS[i]).data();
+    ret += (vdata.*a).cwiseProduct(vdata.*b);
+  }
+}
+
+// the dot products over the whole system
+vec dot(graphlab::distributed_control& dc, graph_type& graph,
+        vec vertex_data::* a, vec vertex_data::* b) {
+  rhs_block ret;
+  local_dot(graph, a, b, ret.v);
+  dc.all_reduce(ret);
+  return ret.v;
+}
+
+
+/**
+ * \brief Z = M^{-1} R on the rows owned by this machine. M is the
+ * diagonal of A, the block of A over the rows of this machine, or I.
+ */
+class block_jacobi {
+ private:
+  std::string type;
+  // the row in the block of each local vertex, or -1
+  std::vector<int> index;
+  vec inv_diag;
+  SparseMatrix<double> block;
+  SimplicialLLT<SparseMatrix<double> > llt;
+
+ public:
+  void init(graph_type& graph, const std::string& precond) {
+    type = precond;
+    index.assign(graph.num_local_vertices(), -1);
+    inv_diag.resize(MASTERS.size());
+    for (size_t i = 0; i < MASTERS.size(); ++i) {
+      index[MASTERS[i]] = i;
+      const double A_ii = graph.l_vertex(MASTERS[i]).data().A_ii;
+      if (A_ii <= 0)
+        logstream(LOG_FATAL) << "Row " << graph.global_vid(MASTERS[i]) + 1
+          << " has a diagonal entry of " << A_ii
+          << ", A is not positive definite" << std::endl;
+      inv_diag[i] = 1.0 / A_ii;
+    }
+    if (type != "block") return;
+
+    // an entry stored on this machine is used for both A_ij and A_ji,
+    // so that the block is symmetric
+    std::map<std::pair<int, int>, double> entries;
+    for (size_t i = 0; i < MASTERS.size(); ++i) {
+      entries[std::make_pair(int(i), int(i))] =
+        graph.l_vertex(MASTERS[i]).data().A_ii;
+      foreach(graph_type::local_edge_type edge,
+              graph.l_vertex(MASTERS[i]).out_edges()) {
+        const int j = index[edge.target().id()];
+        if (j < 0) continue;
+        entries[std::make_pair(int(i), j)] = edge.data().A_ij;
+        entries[std::make_pair(j, int(i))] = edge.data().A_ij;
+      }
+    }
+    std::vector<Triplet<double> > triplets;
+    triplets.reserve(entries.size());
+    typedef std::pair<const std::pair<int, int>, double> entry_type;
+    foreach(const entry_type& entry, entries) {
+      triplets.push_back(Triplet<double>(entry.first.first,
+                                         entry.first.second, entry.second));
+    }
+    block.resize(MASTERS.size(), MASTERS.size());
+    block.setFromTriplets(triplets.begin(), triplets.end());
+    llt.compute(block);
+    if (llt.info() != Success) {
+      logstream(LOG_WARNING) << "The local block of A is not positive "
+        "definite, using the diagonal preconditioner" << std::endl;
+      type = "jacobi";
+    }
+  }
+
+  void solve(graph_type& graph) {
+    if (type == "none") {
+      for (size_t i = 0; i < MASTERS.size(); ++i) {
+        vertex_data& vdata = graph.l_vertex(MASTERS[i]).data();
+        vdata.z = vdata.r;
+      }
+    } else if (type == "jacobi") {
+      for (size_t i = 0; i < MASTERS.size(); ++i) {
+        vertex_data& vdata = graph.l_vertex(MASTERS[i]).data();
+        vdata.z = inv_diag[i] * vdata.r;
+      }
+    } else {
+      mat R(MASTERS.size(), NRHS);
+      for (size_t i = 0; i < MASTERS.size(); ++i) {
+        R.row(i) = graph.l_vertex(MASTERS[i]).data().r.transpose();
+      }
+      const mat Z = llt.solve(R);
+      for (size_t i = 0; i < MASTERS.size(); ++i) {
+        graph.l_vertex(MASTERS[i]).data().z = Z.row(i).transpose();
+      }
+    }
+  }
+}; // end of block_jacobi
+
+
+/**
+ * \brief Reads the right hand sides, a line of NRHS values for each row.
+ */
+std::vector<vec> read_rhs(const std::string& filename) {
+  std::ifstream fin(filename.c_str());
+  if (!fin.good())
+    logstream(LOG_FATAL) << "Failed to open right hand sides "
+      << filename << std::endl;
+  std::vector<vec> rows;
+  std::string line;
+  while (std::getline(fin, line)) {
+    if (line.empty()) continue;
+    std::stringstream strm(line);
+    std::vector<double> values;
+    double val;
+    while (strm >> val) values.push_back(val);
+    if (rows.empty()) NRHS = values.size();
+    if (values.size() != size_t(NRHS))
+      logstream(LOG_FATAL) << "Row " << rows.size() + 1 << " of " << filename
+        << " has " << values.size() << " values, expected " << NRHS << std::endl;
+    rows.push_back(Map<vec>(&values[0], NRHS));
+  }
+  return rows;
+}
+
+
+struct linear_model_saver {
+  typedef graph_type::vertex_type vertex_type;
+  typedef graph_type::edge_type   edge_type;
+
+  std::string save_vertex(const vertex_type& vertex) const {
+    std::string ret = boost::lexical_cast<std::string>(vertex.id() + 1);
+    for (int i = 0; i < vertex.data().x.size(); ++i) {
+      ret += " " + boost::lexical_cast<std::string>(vertex.data().x[i]);
+    }
+    return ret + "\n";
+  }
+  std::string save_edge(const edge_type& edge) const {
+    return "";
+  }
+};
+
+
+int main(int argc, char** argv) {
+  global_logger().set_log_to_console(true);
+
+  // Parse command line options -----------------------------------------------
+  const std::string description =
+    "Solve a symmetric positive definite linear system using the "
+    "preconditioned conjugate gradient method";
+  graphlab::command_line_options clopts(description);
+  std::string input_dir, output = "x.out";
+  std::string precond = "block";
+  int max_iter = 100;
+  double tol = 1e-6;
+  clopts.attach_option("matrix", input_dir,
+      "The directory containing the matrix file");
+  clopts.add_positional("matrix");
+  clopts.attach_option("rhs", rhsfile,
+      "optional file of right hand sides, with a line of values for each "
+      "row. Found in the matrix directory. Defaults to a vector of ones");
+  clopts.attach_option("precond", precond,
+      "preconditioner: block, jacobi or none");
+  clopts.attach_option("max_iter", max_iter, "max iterations");
+  clopts.attach_option("tol", tol,
+      "convergence threshold on the relative residual |b - Ax| / |b|");
+  clopts.attach_option("output", output, "output file prefix");
+  if(!clopts.parse(argc, argv) || input_dir == "") {
+    std::cout << "Error in parsing command line arguments." << std::endl;
+    clopts.print_description();
+    return EXIT_FAILURE;
+  }
+  if (precond != "block" && precond != "jacobi" && precond != "none") {
+    std::cout << "--precond must be block, jacobi or none" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  graphlab::mpi_tools::init(argc, argv);
+  graphlab::distributed_control dc;
+
+  dc.cout() << "Loading graph." << std::endl;
+  graphlab::timer timer;
+  graph_type graph(dc, clopts);
+  graph.load(input_dir, graph_loader);
+  graph.finalize();
+  dc.cout() << "Loading graph. Finished in "
+    << timer.current_time() << std::endl;
+  dc.cout() << "Num rows: " << graph.num_vertices()
+    << "  Num off diagonal entries: " << graph.num_edges() << std::endl;
+
+  std::vector<vec> rhs;
+  if (rhsfile.size() > 0) rhs = read_rhs(input_dir + rhsfile);
+
+  // X = 0, R = B and P = 0 on every replica
+  for (lvid_type lvid = 0; lvid < graph.num_local_vertices(); ++lvid) {
+    vertex_data& vdata = graph.l_vertex(lvid).data();
+    const size_t row = graph.global_vid(lvid);
+    if (rhsfile.size() == 0) vdata.b = vec::Ones(NRHS);
+    else if (row < rhs.size()) vdata.b = rhs[row];
+    else vdata.b = vec::Zero(NRHS);
+    vdata.x = vec::Zero(NRHS);
+    vdata.r = vdata.b;
+    vdata.p = vec::Zero(NRHS);
+    if (graph.l_is_master(lvid)) MASTERS.push_back(lvid);
+  }
+  rhs.clear();
+
+  timer.start();
+  block_jacobi preconditioner;
+  preconditioner.init(graph, precond);
+  dc.cout() << "Preconditioner set up in " << timer.current_time()
+    << std::endl;
+
+  graphlab::graph_gather_apply<graph_type, rhs_block>
+    matvec(graph, matvec_gather, matvec_apply, clopts);
+  graphlab::graph_gather_apply<graph_type, rhs_block>
+    direction(graph, direction_gather, direction_apply, clopts);
+
+  dc.cout() << "Running conjugate gradient" << std::endl;
+  const vec bnorm = dot(dc, graph, &vertex_data::b, &vertex_data::b).cwiseSqrt();
+  vec rz_old = vec::Zero(NRHS);
+  ALPHA = BETA = vec::Zero(NRHS);
+  int iter = 0;
+  vec residual;
+  for ( ; ; ++iter) {
+    preconditioner.solve(graph);
+    // |R|^2 and R.Z with one all-reduce
+    rhs_block dots;
+    dots.v.resize(2 * NRHS);
+    vec local;
+    local_dot(graph, &vertex_data::r, &vertex_data::r, local);
+    dots.v.head(NRHS) = local;
+    local_dot(graph, &vertex_data::r, &vertex_data::z, local);
+    dots.v.tail(NRHS) = local;
+    dc.all_reduce(dots);
+    const vec rz = dots.v.tail(NRHS);
+
+    residual = dots.v.head(NRHS).cwiseSqrt();
+    bool converged = true;
+    for (int i = 0; i < NRHS; ++i) {
+      if (bnorm[i] > 0) residual[i] /= bnorm[i];
+      const bool active = residual[i] > tol;
+      converged &= !active;
+      BETA[i] = (active && iter > 0) ? rz[i] / rz_old[i] : 0;
+    }
+    dc.cout() << "Iteration " << iter << " relative residual: "
+      << residual.maxCoeff() << std::endl;
+    if (converged || iter == max_iter) break;
+    rz_old = rz;
+
+    direction.exec();
+    matvec.exec();
+    const vec pAp = dot(dc, graph, &vertex_data::p, &vertex_data::Ap);
+    for (int i = 0; i < NRHS; ++i) {
+      ALPHA[i] = (residual[i] > tol && pAp[i] > 0) ? rz[i] / pAp[i] : 0;
+    }
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+    for (int i = 0; i < int(MASTERS.size()); ++i) {
+      vertex_data& vdata = graph.l_vertex(MASTERS[i]).data();
+      vdata.x += ALPHA.cwiseProduct(vdata.p);
+      vdata.r -= ALPHA.cwiseProduct(vdata.Ap);
+    }
+  }
+
+  const double runtime = timer.current_time();
+  dc.cout() << "Conjugate gradient finished in " << iter << " iterations"
+    << std::endl;
+  dc.cout() << "Solution converged to relative residual: "
+    << residual.maxCoeff() << std::endl;
+  dc.cout() << "----------------------------------------------------------"
+    << std::endl
+    << "Final Runtime (seconds):   " << runtime << std::endl;
+
+  graph.save(output, linear_model_saver(), false, true, false, 1);
+  graphlab::mpi_tools::finalize();
+
+  return EXIT_SUCCESS;
+}
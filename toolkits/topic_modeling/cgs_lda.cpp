@@ -43,6 +43,7 @@
 #include <boost/spirit/include/phoenix_operator.hpp>
 #include <boost/spirit/include/phoenix_stl.hpp>
 #include <graphlab/parallel/atomic.hpp>
+#include <boost/shared_ptr.hpp>
 
 
 
@@ -84,6 +85,16 @@ inline factor_type& operator+=(factor_type& lvalue,
 #include <graphlab.hpp>
 #include <graphlab/macros_def.hpp>
 
+/**
+ * \brief The operator+= above is an elementwise sum, so the topic
+ * count aggregator can sum the counts in place.
+ */
+namespace graphlab {
+  template <>
+  struct dense_reduction_traits<factor_type>
+    : public vector_dense_reduction_traits<atomic<count_type> > { };
+}
+
 
 
 
@@ -186,6 +197,27 @@ size_t MAX_COUNT = 100;
  */
 float BURNIN = -1;
 
+/**
+ * \brief The sampler used to draw topic assignments.  "gibbs"
+ * evaluates the conditional of every topic for each token.  "alias"
+ * takes Metropolis-Hastings steps with proposals drawn from cached
+ * per-doc and per-word alias tables, in amortized constant time per
+ * token.
+ */
+std::string SAMPLER = "gibbs";
+
+/**
+ * \brief The number of doc and word Metropolis-Hastings step pairs per
+ * token taken by the alias sampler.
+ */
+size_t MH_STEPS = 1;
+
+/**
+ * \brief The number of tokens sampled on this machine, used to report
+ * the sampling throughput.
+ */
+graphlab::atomic<size_t> TOKENS_SAMPLED;
+
 /**
  * \brief The json top word struct contains the current set of top
  * words for each topic encoded in the form of a json string.
@@ -400,6 +432,149 @@ get_other_vertex(const graph_type::edge_type& edge,
 
 
 
+/**
+ * \brief The unnormalized collapsed conditional of topic t for a token
+ * of the given doc and word, with the token itself removed from the
+ * counts.
+ */
+inline double topic_conditional(const factor_type& doc_topic_count,
+                                const factor_type& word_topic_count,
+                                size_t t) {
+  const double n_dt =
+    std::max(count_type(doc_topic_count[t]), count_type(0));
+  const double n_wt =
+    std::max(count_type(word_topic_count[t]), count_type(0));
+  const double n_t  =
+    std::max(count_type(GLOBAL_TOPIC_COUNT[t]), count_type(0));
+  return (ALPHA + n_dt) * (BETA + n_wt) / (BETA * NWORDS + n_t);
+} // end of topic_conditional
+
+
+/**
+ * \brief The word proposal of the alias sampler.
+ *
+ * The proposal of a word is q(t) proportional to
+ * (n_wt + beta) / (n_t + beta * W), the word half of the collapsed
+ * conditional, drawn from a dense alias table over all topics.  Each
+ * table takes about 12 bytes per topic.
+ */
+class word_proposal {
+public:
+  explicit word_proposal(const factor_type& word_topic_count) {
+    std::vector<double> weights(NTOPICS);
+    for(size_t t = 0; t < NTOPICS; ++t) {
+      const double n_wt =
+        std::max(count_type(word_topic_count[t]), count_type(0));
+      const double n_t  =
+        std::max(count_type(GLOBAL_TOPIC_COUNT[t]), count_type(0));
+      weights[t] = (BETA + n_wt) / (BETA * NWORDS + n_t);
+    }
+    table.build(weights);
+  }
+  size_t sample() const { return table.sample(); }
+  double weight(size_t t) const { return table.weight(t); }
+private:
+  graphlab::alias_table table;
+}; // end of word_proposal
+
+
+/**
+ * \brief The document proposal of the alias sampler.
+ *
+ * The proposal of a document is q(t) proportional to n_dt + alpha,
+ * the document half of the collapsed conditional.  Documents use few
+ * of the topics, so only the nonzero counts are kept in an alias
+ * table and the alpha part is drawn as a uniform topic.
+ */
+class doc_proposal {
+public:
+  explicit doc_proposal(const factor_type& doc_topic_count) : ntokens(0) {
+    std::vector<double> counts;
+    for(size_t t = 0; t < NTOPICS; ++t) {
+      const count_type n_dt = doc_topic_count[t];
+      if(n_dt > 0) {
+        topics.push_back(t);
+        counts.push_back(n_dt);
+        ntokens += n_dt;
+      }
+    }
+    if(!counts.empty()) table.build(counts);
+  }
+  size_t sample() const {
+    const double u =
+      graphlab::random::uniform<double>(0, ntokens + ALPHA * NTOPICS);
+    if(u < ntokens) return topics[table.sample()];
+    return graphlab::random::fast_uniform<size_t>(0, NTOPICS - 1);
+  }
+  double weight(size_t t) const {
+    const std::vector<topic_id_type>::const_iterator iter =
+      std::lower_bound(topics.begin(), topics.end(), t);
+    if(iter == topics.end() || *iter != t) return ALPHA;
+    return ALPHA + table.weight(iter - topics.begin());
+  }
+private:
+  std::vector<topic_id_type> topics;
+  graphlab::alias_table table;
+  double ntokens;
+}; // end of doc_proposal
+
+
+/**
+ * \brief Caches the proposals of the alias sampler for each local
+ * vertex.
+ *
+ * A proposal is built from the counts of the local replica of the
+ * vertex and reused until the vertex is updated again, so that its
+ * O(K) construction is amortized over the tokens of the vertex.
+ * Metropolis-Hastings corrects for the counts having changed since.
+ */
+template<typename Proposal>
+class proposal_cache {
+public:
+  typedef boost::shared_ptr<const Proposal> proposal_ptr;
+
+  /** Allocates an empty entry for each local vertex */
+  void resize(size_t nlocal_vertices) {
+    entries.clear();
+    entries.resize(nlocal_vertices);
+  }
+
+  /**
+   * Returns the proposal of the vertex, rebuilding it if the vertex
+   * was updated since, or NULL if the vertex is not a local vertex.
+   */
+  proposal_ptr get(const graph_type::vertex_type& vertex) {
+    const size_t lvid = vertex.local_id();
+    if(lvid >= entries.size()) return proposal_ptr();
+    const vertex_data& vdata = vertex.data();
+    entry& e = entries[lvid];
+    e.lock.lock();
+    if(!e.is_set || e.nupdates != vdata.nupdates) {
+      e.proposal.reset(new Proposal(vdata.factor));
+      e.nupdates = vdata.nupdates;
+      e.is_set = true;
+    }
+    const proposal_ptr ret = e.proposal;
+    e.lock.unlock();
+    return ret;
+  }
+
+private:
+  struct entry {
+    graphlab::simple_spinlock lock;
+    bool is_set;
+    uint32_t nupdates;
+    proposal_ptr proposal;
+    entry() : is_set(false), nupdates(0) { }
+  };
+  std::vector<entry> entries;
+}; // end of proposal_cache
+
+proposal_cache<word_proposal> WORD_PROPOSALS;
+proposal_cache<doc_proposal> DOC_PROPOSALS;
+
+
+
 // ========================================================
 // The Collapsed Gibbs Sampler Function
 
@@ -411,16 +586,36 @@ get_other_vertex(const graph_type::edge_type& edge,
  * function can compute the correct topic counts for the center
  * vertex.
  *
+ * The gather of a single edge only holds the topics of its tokens,
+ * which are far fewer than the topics, and is added into a dense
+ * count when it is summed.
  */
 struct gather_type {
   factor_type factor;
+  assignment_type assignment;
   uint32_t nchanges;
   gather_type() : nchanges(0) { };
-  gather_type(uint32_t nchanges) : factor(NTOPICS), nchanges(nchanges) { };
-  void save(graphlab::oarchive& arc) const { arc << factor << nchanges; }
-  void load(graphlab::iarchive& arc) { arc >> factor >> nchanges; }
+  gather_type(uint32_t nchanges) : nchanges(nchanges) { };
+  void save(graphlab::oarchive& arc) const {
+    arc << factor << assignment << nchanges;
+  }
+  void load(graphlab::iarchive& arc) {
+    arc >> factor >> assignment >> nchanges;
+  }
+  /** \brief Adds the topics of the tokens into the dense count */
+  void densify() {
+    if(factor.empty()) factor.resize(NTOPICS);
+    foreach(topic_id_type asg, assignment) {
+      if(asg != NULL_TOPIC) ++factor[asg];
+    }
+    assignment.clear();
+  }
   gather_type& operator+=(const gather_type& other) {
-    factor += other.factor;
+    densify();
+    if(!other.factor.empty()) factor += other.factor;
+    foreach(topic_id_type asg, other.assignment) {
+      if(asg != NULL_TOPIC) ++factor[asg];
+    }
     nchanges += other.nchanges;
     return *this;
   }
@@ -461,10 +656,7 @@ public:
   gather_type gather(icontext_type& context, const vertex_type& vertex,
                      edge_type& edge) const {
     gather_type ret(edge.data().nchanges);
-    const assignment_type& assignment = edge.data().assignment;
-    foreach(topic_id_type asg, assignment) {
-      if(asg != NULL_TOPIC) ++ret.factor[asg];
-    }
+    ret.assignment = edge.data().assignment;
     return ret;
   } // end of gather
 
@@ -480,11 +672,13 @@ public:
     ASSERT_GT(num_neighbors, 0);
     // There should be no new edge data since the vertex program has been cleared
     vertex_data& vdata = vertex.data();
-    ASSERT_EQ(sum.factor.size(), NTOPICS);
+    gather_type total(sum);
+    total.densify();
+    ASSERT_EQ(total.factor.size(), NTOPICS);
     ASSERT_EQ(vdata.factor.size(), NTOPICS);
     vdata.nupdates++;
-    vdata.nchanges = sum.nchanges;
-    vdata.factor = sum.factor;
+    vdata.nchanges = total.nchanges;
+    vdata.factor = total.factor;
   } // end of apply
 
 
@@ -522,8 +716,20 @@ public:
       edge.source().data().factor : edge.target().data().factor;
     ASSERT_EQ(doc_topic_count.size(), NTOPICS);
     ASSERT_EQ(word_topic_count.size(), NTOPICS);
+    // use the cached proposals of the doc and word if there are any
+    proposal_cache<doc_proposal>::proposal_ptr doc_prop;
+    proposal_cache<word_proposal>::proposal_ptr word_prop;
+    if(SAMPLER == "alias") {
+      const bool source_is_doc = is_doc(edge.source());
+      doc_prop = DOC_PROPOSALS.get(source_is_doc ?
+                                   edge.source() : edge.target());
+      word_prop = WORD_PROPOSALS.get(source_is_doc ?
+                                     edge.target() : edge.source());
+    }
+    const bool use_mh = doc_prop != NULL && word_prop != NULL;
     // run the actual gibbs sampling
-    std::vector<double> prob(NTOPICS);
+    std::vector<double> prob;
+    if(!use_mh) prob.resize(NTOPICS);
     assignment_type& assignment = edge.data().assignment;
     edge.data().nchanges = 0;
     foreach(topic_id_type& asg, assignment) {
@@ -533,16 +739,34 @@ public:
         --word_topic_count[asg];
         --GLOBAL_TOPIC_COUNT[asg];
       }
-      for(size_t t = 0; t < NTOPICS; ++t) {
-        const double n_dt =
-          std::max(count_type(doc_topic_count[t]), count_type(0));
-        const double n_wt =
-          std::max(count_type(word_topic_count[t]), count_type(0));
-        const double n_t  =
-          std::max(count_type(GLOBAL_TOPIC_COUNT[t]), count_type(0));
-        prob[t] = (ALPHA + n_dt) * (BETA + n_wt) / (BETA * NWORDS + n_t);
+      if(use_mh) {
+        // Metropolis-Hastings steps starting from the old assignment
+        // which alternate between the doc and the word proposal
+        size_t current = asg != NULL_TOPIC ? asg : doc_prop->sample();
+        double current_prob =
+          topic_conditional(doc_topic_count, word_topic_count, current);
+        for(size_t i = 0; i < 2 * MH_STEPS; ++i) {
+          const bool doc_step = i % 2 == 0;
+          const size_t t = doc_step? doc_prop->sample() : word_prop->sample();
+          if(t == current) continue;
+          const double prob_t =
+            topic_conditional(doc_topic_count, word_topic_count, t);
+          const double ratio = doc_step?
+            (prob_t * doc_prop->weight(current)) /
+            (current_prob * doc_prop->weight(t)) :
+            (prob_t * word_prop->weight(current)) /
+            (current_prob * word_prop->weight(t));
+          if(ratio >= 1 || graphlab::random::rand01() < ratio) {
+            current = t; current_prob = prob_t;
+          }
+        }
+        asg = current;
+      } else {
+        for(size_t t = 0; t < NTOPICS; ++t) {
+          prob[t] = topic_conditional(doc_topic_count, word_topic_count, t);
+        }
+        asg = graphlab::random::multinomial(prob);
       }
-      asg = graphlab::random::multinomial(prob);
       // asg = std::max_element(prob.begin(), prob.end()) - prob.begin();
       ++doc_topic_count[asg];
       ++word_topic_count[asg];
@@ -552,6 +776,7 @@ public:
         INCREMENT_EVENT(TOKEN_CHANGES,1);
       }
     } // End of loop over each token
+    TOKENS_SAMPLED += assignment.size();
     // singla the other vertex
     context.signal(get_other_vertex(edge, vertex));
   } // end of scatter function
@@ -1117,6 +1342,14 @@ int main(int argc, char** argv) {
                        "The maximum number of occurences of a word in a document.");
   clopts.attach_option("format", format,
                        "Formats: matrix,json,json-gzip");
+  clopts.attach_option("sampler", SAMPLER,
+                       "The topic sampler: gibbs or alias. The alias sampler "
+                       "takes Metropolis-Hastings steps from cached per-doc "
+                       "and per-word alias tables and is faster for many "
+                       "topics.");
+  clopts.attach_option("mh_steps", MH_STEPS,
+                       "The number of doc and word Metropolis-Hastings step "
+                       "pairs per token of the alias sampler.");
   clopts.attach_option("burnin", BURNIN, 
                        "The time in second to run until a sample is collected. "
                        "If less than zero the sampler runs indefinitely.");
@@ -1162,6 +1395,12 @@ int main(int argc, char** argv) {
     return EXIT_FAILURE;
   }
 
+  if(SAMPLER != "gibbs" && SAMPLER != "alias") {
+    logstream(LOG_ERROR) 
+      << "Unknown sampler " << SAMPLER << std::endl;
+    return EXIT_FAILURE;
+  }
+
   if(BETA <= 0) {
     logstream(LOG_ERROR) 
       << "Beta must be positive (beta=" << BETA << ")!"  << std::endl;
@@ -1187,6 +1426,8 @@ int main(int argc, char** argv) {
 
   const size_t ntokens = graph.map_reduce_edges<size_t>(count_tokens);
   dc.cout() << "Total tokens: " << ntokens << std::endl;
+  WORD_PROPOSALS.resize(graph.num_local_vertices());
+  DOC_PROPOSALS.resize(graph.num_local_vertices());
 
 
 
@@ -1228,6 +1469,7 @@ int main(int argc, char** argv) {
   cgs_lda_vertex_program::DISABLE_SAMPLING = false;
   // Run the engine
   engine.start();
+  const double sampling_runtime = timer.current_time();
   // Finalize the counts
   cgs_lda_vertex_program::DISABLE_SAMPLING = true;
   engine.signal_all();
@@ -1241,6 +1483,14 @@ int main(int argc, char** argv) {
     << "Updates executed: " << engine.num_updates() << std::endl
     << "Update Rate (updates/second): "
     << engine.num_updates() / runtime << std::endl;
+  size_t tokens_sampled = TOKENS_SAMPLED.value;
+  dc.all_reduce(tokens_sampled);
+  dc.cout()
+    << "Tokens sampled: " << tokens_sampled << std::endl
+    << "Sampling Rate (tokens/second/core): "
+    << tokens_sampled / 
+       (sampling_runtime * clopts.get_ncpus() * dc.numprocs())
+    << std::endl;
   
   
   